@@ -9,6 +9,7 @@ namespace Overseer{
 
 	ChokePoint::ChokePoint(Graph *graph, const Region* region1, const Region* region2, std::vector<TilePosition> tilePositions){
 	    p_graph = graph;
+	    m_rampId = 0;
 	    m_regions.first = region1;
 	    m_regions.second = region2;
 	    m_tilePositions = tilePositions;
@@ -48,6 +49,15 @@ namespace Overseer{
 	    return points;
 	}
 
+	size_t ChokePoint::getRampId() const {
+
+		return m_rampId;
+	}
+
+	void ChokePoint::setRampId(size_t rampId) {
+		m_rampId = rampId;
+	}
+
 	/*
 	***************************
 	*** Public members stop ***
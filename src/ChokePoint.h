@@ -62,6 +62,20 @@ namespace Overseer{
             */
             std::vector<sc2::Point2D> getPoints();
 
+            /**
+            * \brief Gets the id of the ramp the chokepoint lies on.
+            *
+            * \return the ramp id, 0 if the chokepoint is not a ramp.
+            */
+            size_t getRampId() const;
+
+            /**
+            * \brief Set the id of the ramp the chokepoint lies on.
+            *
+            * \param rampId the ramp id.
+            */
+            void setRampId(size_t rampId);
+
         private:
             /**
             * \brief Get the graph of the chokepoint
@@ -74,6 +88,7 @@ namespace Overseer{
             std::vector<UnitPosition> m_neutralUnitPositions;
             std::vector<TilePosition> m_tilePositions;
             TilePosition m_center;
+            size_t m_rampId;
 
             Graph *p_graph;
     };
@@ -2,10 +2,49 @@
 #ifndef _OVERSEER_DEFINITIONS_H_
 #define _OVERSEER_DEFINITIONS_H_
 
+#include <cstddef>
+
+// SSE2 is part of every x86-64 target, MSVC does not define __SSE2__ for it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OVERSEER_SSE2
+#endif
+
 namespace Overseer{
 	namespace constants {
 		// ChockePoint defined size.
 	    const size_t min_cluster_distance = 17;
+
+	    // Terrain heights decoded from the height image span [min_terrain_height, min_terrain_height + terrain_height_range].
+	    const float min_terrain_height = -16.0f;
+	    const float terrain_height_range = 32.0f;
+
+	    // ObservationInterface::TerrainHeight maps the same image bytes to [-100, 100].
+	    const float api_min_terrain_height = -100.0f;
+	    const float api_terrain_height_range = 200.0f;
+
+	    // Terrain height between two height levels.
+	    const float level_height = 2.0f;
+
+	    // Tiles further than this from a height level, as a fraction of level_height, are sloping.
+	    const float ramp_tolerance = 0.25f;
+
+	    // Smallest height difference between neighboring tiles that is a slope.
+	    const float min_slope = 0.1f;
+
+	    // Height difference between neighboring tiles that is a cliff rather than a slope.
+	    const float cliff_height = 1.0f;
+
+	    // Smallest number of tiles in a ramp.
+	    const size_t min_ramp_area = 4;
+
+	    // Largest fraction of mismatching tiles for a map to still count as symmetric.
+	    const float max_symmetry_mismatch = 0.005f;
+
+	    // Largest range handled by Map::getVisibleArea.
+	    const int max_sight_range = 31;
+
+	    // Largest building footprint handled by WallPlanner::Plan.
+	    const size_t max_footprint = 8;
 	}
 }
 
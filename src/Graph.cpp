@@ -1,5 +1,7 @@
 #include "Graph.h"
 
+#include <limits>
+
 namespace Overseer{
 	/*
 	****************************
@@ -21,6 +23,32 @@ namespace Overseer{
         return m_ChokePointsMatrix[region_id_b][region_id_a];
     }
 
+    ChokePoint* Graph::getChokePoint(size_t region_id_a, size_t region_id_b, sc2::Point2D pos) {
+
+        if (region_id_a > region_id_b) {
+            std::swap(region_id_a, region_id_b);
+        }
+
+        if (!region_id_a || region_id_a == region_id_b || region_id_b >= m_ChokePointsMatrix.size()) {
+
+            return nullptr;
+        }
+
+        ChokePoint* closest = nullptr;
+        float closestDistance = std::numeric_limits<float>::max();
+
+        for(auto & chokePoint : m_ChokePointsMatrix[region_id_b][region_id_a]) {
+            float distance = sc2::Distance2D(chokePoint.getMidPoint(), pos);
+
+            if(distance < closestDistance) {
+                closestDistance = distance;
+                closest = &chokePoint;
+            }
+        }
+
+        return closest;
+    }
+
     void Graph::CreateChokePoints() {
         num_regions = p_map->getRegions().size();
 
@@ -38,6 +38,16 @@ namespace Overseer{
             */
             std::vector<ChokePoint> getChokePoints(size_t region_id_a, size_t region_id_b) const;
 
+            /**
+            * \brief Gets the chokepoint between two adjacent regions that is closest to a position.
+            *
+            * \param region_id_a a region which is adjacent to region_id_b
+            * \param region_id_b a region which is adjacent to region_id_a
+            * \param pos The position to search from.
+            * \return pointer to the chokepoint, nullptr if the regions share no chokepoint.
+            */
+            ChokePoint* getChokePoint(size_t region_id_a, size_t region_id_b, sc2::Point2D pos);
+
             /**
             * \brief find and create the chokepoint on the map.
             */
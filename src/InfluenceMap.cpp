@@ -0,0 +1,225 @@
+#include "InfluenceMap.h"
+#include "Definitions.h"
+#include "Map.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef OVERSEER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Overseer{
+    /*
+    ****************************
+    *** Public members start ***
+    ****************************
+    */
+
+    InfluenceMap::InfluenceMap():m_plane(0),m_stride(0),m_width(0),m_height(0),m_numRegions(0) {}
+
+    InfluenceMap::InfluenceMap(Map* map):InfluenceMap() {
+        setMap(map);
+    }
+
+    void InfluenceMap::setMap(Map* map) {
+        m_width = map->getWidth();
+        m_height = map->getHeight();
+        m_stride = (m_width + alignment - 1) / alignment * alignment;
+        m_plane = m_stride * m_height;
+        //Room for all layers plus the slack needed to align the first one
+        m_data.assign(m_plane * influence_layers + alignment, 0.0f);
+        m_regions.assign(m_plane, 0);
+        m_numRegions = 0;
+
+        for(size_t y(0); y < m_height; ++y) {
+
+            for(size_t x(0); x < m_width; ++x) {
+                //Tiles missing from the map, as before it is initialized, are in no region
+                std::shared_ptr<Tile> tile = map->GetTile(sc2::Point2D(x, y));
+                size_t regionId = tile ? tile->getRegionId() : 0;
+                m_regions[y * m_stride + x] = regionId;
+                m_numRegions = std::max(m_numRegions, regionId);
+            }
+        }
+    }
+
+    void InfluenceMap::Stamp(InfluenceLayer layer, sc2::Point2D pos, float radius, float value) {
+
+        if(radius <= 0 || m_data.empty()) {
+            return;
+        }
+
+        int minX = std::max(0, (int) std::floor(pos.x - radius));
+        int maxX = std::min((int) m_width - 1, (int) std::ceil(pos.x + radius));
+        int minY = std::max(0, (int) std::floor(pos.y - radius));
+        int maxY = std::min((int) m_height - 1, (int) std::ceil(pos.y + radius));
+        float inverse = 1.0f / radius;
+        float* raster = Layer(layer);
+
+        for(int y = minY; y <= maxY; ++y) {
+            //Distances are taken from the tile centers
+            float dy = y + 0.5f - pos.y;
+            float dy2 = dy * dy;
+
+            if(dy2 >= radius * radius) {
+                continue;
+            }
+
+            float* row = raster + y * m_stride;
+            int x = minX;
+
+#ifdef OVERSEER_SSE2
+            __m128 vdy2 = _mm_set1_ps(dy2);
+            __m128 vinverse = _mm_set1_ps(inverse);
+            __m128 vvalue = _mm_set1_ps(value);
+            __m128 vone = _mm_set1_ps(1.0f);
+            __m128 vzero = _mm_setzero_ps();
+            __m128 vstep = _mm_set1_ps(4.0f);
+            float dx = x + 0.5f - pos.x;
+            __m128 vdx = _mm_setr_ps(dx, dx + 1.0f, dx + 2.0f, dx + 3.0f);
+
+            for(; x + 4 <= maxX + 1; x += 4) {
+                __m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vdx, vdx), vdy2));
+                __m128 falloff = _mm_max_ps(vzero, _mm_sub_ps(vone, _mm_mul_ps(distance, vinverse)));
+                _mm_storeu_ps(row + x, _mm_add_ps(_mm_loadu_ps(row + x), _mm_mul_ps(falloff, vvalue)));
+                vdx = _mm_add_ps(vdx, vstep);
+            }
+#endif
+
+            for(; x <= maxX; ++x) {
+                float dx = x + 0.5f - pos.x;
+                float falloff = 1.0f - std::sqrt(dx * dx + dy2) * inverse;
+
+                if(falloff > 0) {
+                    row[x] += falloff * value;
+                }
+            }
+        }
+    }
+
+    void InfluenceMap::Decay(InfluenceLayer layer, float factor) {
+        float* raster = Layer(layer);
+        size_t i = 0;
+
+        if(!raster) {
+            return;
+        }
+
+#ifdef OVERSEER_SSE2
+        //Layers are aligned and a multiple of the alignment long, padding included
+        __m128 vfactor = _mm_set1_ps(factor);
+
+        for(; i + 4 <= m_plane; i += 4) {
+            _mm_store_ps(raster + i, _mm_mul_ps(_mm_load_ps(raster + i), vfactor));
+        }
+#endif
+
+        for(; i < m_plane; ++i) {
+            raster[i] *= factor;
+        }
+    }
+
+    void InfluenceMap::Decay(float factor) {
+
+        for(int layer(0); layer < influence_layers; ++layer) {
+            Decay((InfluenceLayer) layer, factor);
+        }
+    }
+
+    void InfluenceMap::Clear(InfluenceLayer layer) {
+        float* raster = Layer(layer);
+
+        if(raster) {
+            std::fill(raster, raster + m_plane, 0.0f);
+        }
+    }
+
+    float InfluenceMap::getInfluence(InfluenceLayer layer, sc2::Point2D pos) const {
+        int x = pos.x;
+        int y = pos.y;
+
+        if(m_data.empty() || x < 0 || y < 0 || x >= (int) m_width || y >= (int) m_height) {
+
+            return 0;
+        }
+
+        return Layer(layer)[y * m_stride + x];
+    }
+
+    std::vector<float> InfluenceMap::getRegionInfluence(InfluenceLayer layer) const {
+        std::vector<float> influence(m_numRegions + 1, 0.0f);
+
+        if(m_data.empty()) {
+
+            return influence;
+        }
+
+        const float* raster = Layer(layer);
+
+        for(size_t y(0); y < m_height; ++y) {
+            const float* row = raster + y * m_stride;
+            const uint32_t* regions = m_regions.data() + y * m_stride;
+
+            for(size_t x(0); x < m_width; ++x) {
+                influence[regions[x]] += row[x];
+            }
+        }
+
+        return influence;
+    }
+
+    float InfluenceMap::getCost(sc2::Point2D pos, bool air, float threatWeight) const {
+
+        return 1.0f + threatWeight * getInfluence(air ? airThreat : groundThreat, pos);
+    }
+
+    const float* InfluenceMap::getLayer(InfluenceLayer layer) const {
+
+        return Layer(layer);
+    }
+
+    size_t InfluenceMap::getStride() const {
+
+        return m_stride;
+    }
+
+    /*
+    ***************************
+    *** Public members stop ***
+    ***************************
+
+    ***************************
+    ***************************
+    ***************************
+
+    *****************************
+    *** Priavte members start ***
+    *****************************
+    */
+
+    float* InfluenceMap::Layer(InfluenceLayer layer) {
+
+        return m_data.empty() ? nullptr : m_data.data() + LayerOffset(layer);
+    }
+
+    const float* InfluenceMap::Layer(InfluenceLayer layer) const {
+
+        return m_data.empty() ? nullptr : m_data.data() + LayerOffset(layer);
+    }
+
+    size_t InfluenceMap::LayerOffset(InfluenceLayer layer) const {
+
+        //The buffer is over allocated, skip ahead to the first 32 byte boundary
+        size_t misalignment = (reinterpret_cast<uintptr_t>(m_data.data()) / sizeof(float)) % alignment;
+        size_t offset = misalignment ? alignment - misalignment : 0;
+
+        return offset + layer * m_plane;
+    }
+
+    /*
+    ****************************
+    *** Priavte members stop ***
+    ****************************
+    */
+}
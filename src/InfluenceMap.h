@@ -0,0 +1,149 @@
+#ifndef _OVERSEER_INFLUENCEMAP_H_
+#define _OVERSEER_INFLUENCEMAP_H_
+
+#include "Region.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Overseer{
+
+    class Map;
+
+    /**
+    * \enum InfluenceLayer InfluenceMap.h "InfluenceMap.h"
+    *
+    * \brief The layers held by the influence map.
+    */
+    enum InfluenceLayer {
+        groundThreat,
+        airThreat,
+        vision,
+        creep,
+        influence_layers
+    };
+
+    /**
+    * \class InfluenceMap InfluenceMap.h "InfluenceMap.h"
+    * \brief Layered influence rasters over the tile grid.
+    *
+    * Every layer is a contiguous float raster, one value per tile, with rows padded to 32 bytes and
+    * aligned so whole rows can be processed with SIMD instructions. A raster of region ids, taken from
+    * the tiles, is used to aggregate the layers per region.
+    */
+    class InfluenceMap {
+        public:
+
+            /**
+            * \brief empty constructor
+            */
+            InfluenceMap();
+
+            /**
+            * \brief constructor.
+            *
+            * \param map The map to build the rasters for, regions should already be computed.
+            */
+            InfluenceMap(Map* map);
+
+            /**
+            * \brief set the map, allocates the layers and builds the region raster.
+            *
+            * Tiles the map does not hold yet, before Map::Initialize(), are in no region.
+            *
+            * \param map is a pointer to the map.
+            */
+            void setMap(Map* map);
+
+            /**
+            * \brief Add influence around a position, falling off linearly to 0 at the radius.
+            *
+            * \param layer The layer to add influence to.
+            * \param pos The position of the source, usually a unit position.
+            * \param radius The radius of the influence in tiles.
+            * \param value The influence at the source.
+            */
+            void Stamp(InfluenceLayer layer, sc2::Point2D pos, float radius, float value);
+
+            /**
+            * \brief Multiply a layer by a factor, used to let influence fade between steps.
+            *
+            * \param layer The layer to decay.
+            * \param factor The factor to multiply with, 0 clears the layer.
+            */
+            void Decay(InfluenceLayer layer, float factor);
+
+            /**
+            * \brief Multiply all layers by a factor.
+            *
+            * \param factor The factor to multiply with.
+            */
+            void Decay(float factor);
+
+            /**
+            * \brief Reset a layer to 0.
+            *
+            * \param layer The layer to clear.
+            */
+            void Clear(InfluenceLayer layer);
+
+            /**
+            * \brief Get the influence on a tile.
+            *
+            * \param layer The layer to read.
+            * \param pos The position of the tile.
+            * \return the influence, 0 outside the map.
+            */
+            float getInfluence(InfluenceLayer layer, sc2::Point2D pos) const;
+
+            /**
+            * \brief Get the sum of a layer over every region.
+            *
+            * \param layer The layer to aggregate.
+            * \return vector indexed by region id, index 0 holds the tiles outside any region.
+            */
+            std::vector<float> getRegionInfluence(InfluenceLayer layer) const;
+
+            /**
+            * \brief Get the cost of walking (or flying) over a tile, for threat aware pathfinding.
+            *
+            * \param pos The position of the tile.
+            * \param air True to use the air threat layer, the ground threat layer otherwise.
+            * \param threatWeight How much one unit of threat adds to the base cost of 1.
+            * \return the cost of the tile.
+            */
+            float getCost(sc2::Point2D pos, bool air, float threatWeight) const;
+
+            /**
+            * \brief Get the raw raster of a layer.
+            *
+            * \param layer The layer.
+            * \return pointer to the first row, rows are getStride() floats apart.
+            */
+            const float* getLayer(InfluenceLayer layer) const;
+
+            /**
+            * \brief Get the distance between two rows in the rasters.
+            *
+            * \return the stride in floats.
+            */
+            size_t getStride() const;
+
+        private:
+            float* Layer(InfluenceLayer layer);
+            const float* Layer(InfluenceLayer layer) const;
+            size_t LayerOffset(InfluenceLayer layer) const;
+
+            std::vector<float> m_data;
+            std::vector<uint32_t> m_regions;
+            size_t m_plane;
+            size_t m_stride;
+            size_t m_width;
+            size_t m_height;
+            size_t m_numRegions;
+
+            static const size_t alignment = 8;  // floats, 32 bytes
+    };
+}
+
+#endif /* _OVERSEER_INFLUENCEMAP_H_ */
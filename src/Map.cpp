@@ -1,5 +1,12 @@
 #include "Map.h"
 
+#include <bitset>
+#include <limits>
+
+#ifdef OVERSEER_SSE2
+#include <emmintrin.h>
+#endif
+
 namespace Overseer{
 
 	int point2d_accessor::operator() (spatial::dimension_type dim, const sc2::Point2D p) const {
@@ -21,9 +28,9 @@ namespace Overseer{
 	****************************
 	*/
 
-	Map::Map(){}
+	Map::Map():m_tileIndex(m_tilePositions),m_symmetry(no_symmetry){}
 
-	Map::Map(sc2::Agent* bot){
+	Map::Map(sc2::Agent* bot):m_tileIndex(m_tilePositions),m_symmetry(no_symmetry){
         m_bot = bot;
         m_width  = m_bot->Observation()->GetGameInfo().width;
         m_height = m_bot->Observation()->GetGameInfo().height;
@@ -57,7 +64,9 @@ namespace Overseer{
     const Region* Map::getNearestRegion(sc2::Point2D pos){
         Region *region = nullptr;
         
-        for(spatial::neighbor_iterator<TilePositionContainer> iter = neighbor_begin(m_tilePositions, pos); iter != neighbor_end(m_tilePositions, pos); iter++) {
+        spatial::best_first_neighbor_iterator<TilePositionContainer> end = best_first_neighbor_end(m_tilePositions, pos);
+
+        for(spatial::best_first_neighbor_iterator<TilePositionContainer> iter = best_first_neighbor_begin(m_tilePositions, pos); iter != end; ++iter) {
             
             if(iter->second->getRegionId()){
                 
@@ -68,8 +77,9 @@ namespace Overseer{
         return region;
     }
 
-    void Map::addTile(sc2::Point2D& pos, std::shared_ptr<Tile> tile){
-        m_tilePositions.insert(std::make_pair(pos, tile));
+    void Map::addTiles(const std::vector<TilePosition>& tilePositions) {
+        m_tilePositions.insert_rebalance(tilePositions.begin(), tilePositions.end());
+        m_tileIndex.rebuild();
     }
 
     bool Map::Valid(sc2::Point2D pos) const {
@@ -90,7 +100,11 @@ namespace Overseer{
 
     std::shared_ptr<Tile> Map::GetTile(sc2::Point2D pos) {
 
-    	return m_tilePositions.find(pos)->second;
+    	TilePositionContainer::iterator tile = m_tileIndex.find(pos);
+    	if (tile == m_tilePositions.end()) {
+    		return std::shared_ptr<Tile>();
+    	}
+    	return tile->second;
     }
 
     size_t Map::size() {
@@ -98,7 +112,7 @@ namespace Overseer{
     	return m_tilePositions.size();
     }
 
-    TilePositionContainer Map::getTilePositions() {
+    const TilePositionContainer& Map::getTilePositions() const {
 
     	return m_tilePositions;
     }
@@ -119,6 +133,234 @@ namespace Overseer{
     	return m_rawFrontier;
     }
 
+    float Map::getTerrainHeight(sc2::Point2D pos) const {
+        int x = pos.x;
+        int y = pos.y;
+
+        if(m_terrainHeight.empty() || x < 0 || y < 0 || x >= (int) m_width || y >= (int) m_height) {
+
+            return 0;
+        }
+
+        return m_terrainHeight[y * m_width + x];
+    }
+
+    int Map::getGroundHeight(sc2::Point2D pos) const {
+        int x = pos.x;
+        int y = pos.y;
+
+        if(m_groundHeights.empty() || x < 0 || y < 0 || x >= (int) m_width || y >= (int) m_height) {
+
+            return 0;
+        }
+
+        return m_groundHeights[y * m_width + x];
+    }
+
+    bool Map::LineOfSight(sc2::Point2D from, sc2::Point2D to) const {
+        int x = from.x;
+        int y = from.y;
+        int toX = to.x;
+        int toY = to.y;
+        int level = getGroundHeight(from);
+
+        //Bresenham, every tile on the line including the target has to be at or below the viewer
+        int dx = std::abs(toX - x);
+        int dy = -std::abs(toY - y);
+        int stepX = x < toX ? 1 : -1;
+        int stepY = y < toY ? 1 : -1;
+        int error = dx + dy;
+
+        while(x != toX || y != toY) {
+            int error2 = 2 * error;
+
+            if(error2 >= dy) {
+                error += dy;
+                x += stepX;
+            }
+
+            if(error2 <= dx) {
+                error += dx;
+                y += stepY;
+            }
+
+            if(getGroundHeight(sc2::Point2D(x, y)) > level) {
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t Map::getVisibleArea(sc2::Point2D pos, float range) const {
+        int r = std::min((int) std::ceil(range), constants::max_sight_range);
+        int side = 2 * r + 1;
+        int centerX = pos.x;
+        int centerY = pos.y;
+        int x0 = centerX - r;
+        int level = getGroundHeight(pos);
+
+        if(m_groundHeights.empty() || r < 0) {
+
+            return 0;
+        }
+
+        //One bit per tile of the square around the viewer, set when the tile is not above the viewer
+        uint64_t low[2 * constants::max_sight_range + 1];
+        uint64_t visible[2 * constants::max_sight_range + 1];
+
+        for(int row(0); row < side; ++row) {
+            int y = centerY - r + row;
+            low[row] = 0;
+            visible[row] = 0;
+
+            if(y < 0 || y >= (int) m_height) {
+                continue;
+            }
+
+            const uint8_t* levels = m_groundHeights.data() + y * m_width;
+            int i = 0;
+
+            while(i < side) {
+                int x = x0 + i;
+#ifdef OVERSEER_SSE2
+                if(x >= 0 && x + 16 <= (int) m_width && i + 16 <= 64) {
+                    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(levels + x));
+                    uint64_t higher = _mm_movemask_epi8(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(level)));
+                    low[row] |= (~higher & 0xFFFF) << i;
+                    i += 16;
+
+                    continue;
+                }
+#endif
+                if(x >= 0 && x < (int) m_width && levels[x] <= level) {
+                    low[row] |= uint64_t(1) << i;
+                }
+                ++i;
+            }
+            low[row] &= (uint64_t(1) << side) - 1;
+        }
+
+        //Cast a ray to every tile on the border of the square, stopping at the first higher tile
+        float range2 = range * range;
+        visible[r] |= uint64_t(1) << r;
+
+        for(int border(0); border < 4 * (side - 1); ++border) {
+            int edge = border / (side - 1);
+            int offset = border % (side - 1) - r;
+            int toX = edge == 0 ? offset : edge == 1 ? r : edge == 2 ? -offset : -r;
+            int toY = edge == 0 ? -r : edge == 1 ? offset : edge == 2 ? r : -offset;
+            int x = 0;
+            int y = 0;
+            int dx = std::abs(toX);
+            int dy = -std::abs(toY);
+            int stepX = toX > 0 ? 1 : -1;
+            int stepY = toY > 0 ? 1 : -1;
+            int error = dx + dy;
+
+            while(x != toX || y != toY) {
+                int error2 = 2 * error;
+
+                if(error2 >= dy) {
+                    error += dy;
+                    x += stepX;
+                }
+
+                if(error2 <= dx) {
+                    error += dx;
+                    y += stepY;
+                }
+
+                uint64_t bit = uint64_t(1) << (x + r);
+
+                if(x * x + y * y > range2 || !(low[y + r] & bit)) {
+                    break;
+                }
+                visible[y + r] |= bit;
+            }
+        }
+
+        size_t area = 0;
+
+        for(int row(0); row < side; ++row) {
+            area += std::bitset<64>(visible[row]).count();
+        }
+
+        return area;
+    }
+
+    const std::vector<Ramp>& Map::getRamps() const {
+
+        return m_ramps;
+    }
+
+    const Ramp* Map::getRamp(size_t id) const {
+
+        return (id && id <= m_ramps.size()) ? &m_ramps[id - 1] : nullptr;
+    }
+
+    const Ramp* Map::getRampAt(sc2::Point2D pos) const {
+        int x = pos.x;
+        int y = pos.y;
+
+        if(m_rampIds.empty() || x < 0 || y < 0 || x >= (int) m_width || y >= (int) m_height) {
+
+            return nullptr;
+        }
+
+        return getRamp(m_rampIds[y * m_width + x]);
+    }
+
+    const Ramp* Map::getMainRamp(sc2::Point2D startLocation) const {
+        const Ramp* ramp = nullptr;
+        float closestDistance = std::numeric_limits<float>::max();
+
+        for(auto const & mainRamp : m_mainRamps) {
+            float distance = sc2::Distance2D(mainRamp.first, startLocation);
+
+            if(distance < closestDistance) {
+                closestDistance = distance;
+                ramp = getRamp(mainRamp.second);
+            }
+        }
+
+        return ramp;
+    }
+
+    Symmetry Map::getSymmetry() const {
+
+        return m_symmetry;
+    }
+
+    sc2::Point2D Map::Mirror(sc2::Point2D pos) const {
+        //Mirror within the playable area, whose bounds are whole tiles
+        float x0 = m_minPlayable.x;
+        float y0 = m_minPlayable.y;
+        float x1 = m_maxPlayable.x;
+        float y1 = m_maxPlayable.y;
+
+        switch(m_symmetry) {
+
+            case rotational: return sc2::Point2D(x0 + x1 - pos.x, y0 + y1 - pos.y);
+
+            case reflect_x: return sc2::Point2D(x0 + x1 - pos.x, pos.y);
+
+            case reflect_y: return sc2::Point2D(pos.x, y0 + y1 - pos.y);
+
+            case reflect_diagonal: return sc2::Point2D(x0 + (pos.y - y0), y0 + (pos.x - x0));
+
+            case reflect_anti_diagonal: return sc2::Point2D(x1 - (pos.y - y0), y1 - (pos.x - x0));
+
+            default: return pos;
+        }
+    }
+
+    size_t Map::Mirror(size_t regionId) const {
+
+        return regionId < m_mirrorRegions.size() ? m_mirrorRegions[regionId] : 0;
+    }
+
 	/*
 	***************************
 	*** Public members stop ***
@@ -139,7 +381,7 @@ namespace Overseer{
         for(sc2::Point2D delta: {sc2::Point2D(0,-1), sc2::Point2D(0,1), sc2::Point2D(-1,0), sc2::Point2D(1,0)}) {
             if(Valid(tilePosition->first + delta)) {
                 std::shared_ptr<Tile> deltaTile = GetTile(tilePosition->first + delta);
-                if(deltaTile->Buildable()) {
+                if(deltaTile && deltaTile->Buildable()) {
                     size_t regionId = deltaTile->getRegionId();
                     
                     if(regionId) {
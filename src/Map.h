@@ -2,11 +2,17 @@
 #define _OVERSEER_MAP_H_
 
 #include "ChokePoint.h"
+#include "Definitions.h"
 #include "Graph.h"
+#include "Ramp.h"
 #include "Region.h"
 
 #include "spatial/box_multimap.hpp"
+#include "spatial/frozen_box_multimap.hpp"
+#include "spatial/grid_multimap.hpp"
+#include "spatial/key_index.hpp"
 #include "spatial/neighbor_iterator.hpp"
+#include "spatial/best_first_neighbor_iterator.hpp"
 #include "spatial/ordered_iterator.hpp"
 
 #include <memory>
@@ -23,8 +29,23 @@ namespace Overseer{
         int operator() (spatial::dimension_type dim, const sc2::Point2D p) const;
     };
 
-    typedef spatial::box_multimap<2, sc2::Point2D, std::shared_ptr<Tile>, spatial::accessor_less<point2d_accessor, sc2::Point2D>> TilePositionContainer;
-    typedef spatial::box_multimap<2, sc2::Point2D, sc2::Unit*, spatial::accessor_less<point2d_accessor, sc2::Point2D>> UnitPositionContainer;
+    /**
+    * \enum Symmetry Map.h "Map.h"
+    *
+    * \brief The symmetry of the playable area, as found by MapImpl::Initialize().
+    */
+    enum Symmetry {
+        no_symmetry,
+        rotational,             //!< Point symmetric around the center.
+        reflect_x,              //!< Mirrored left to right.
+        reflect_y,              //!< Mirrored top to bottom.
+        reflect_diagonal,       //!< Mirrored over the diagonal, x and y swapped.
+        reflect_anti_diagonal   //!< Mirrored over the anti-diagonal.
+    };
+
+    typedef spatial::frozen_box_multimap<2, sc2::Point2D, std::shared_ptr<Tile>, spatial::accessor_less<point2d_accessor, sc2::Point2D>> TilePositionContainer;
+    typedef spatial::key_index<TilePositionContainer> TileIndex;
+    typedef spatial::grid_multimap<2, sc2::Point2D, sc2::Unit*, spatial::accessor_less<point2d_accessor, sc2::Point2D>> UnitPositionContainer;
     typedef std::map<size_t,std::shared_ptr<Region>> RegionMap;
     typedef std::map<std::pair<size_t,size_t>, std::vector<TilePosition>> RawFrontier;
 
@@ -44,6 +65,12 @@ namespace Overseer{
             * \param bot The Starcraft II bot.
             */
             Map(sc2::Agent* bot);
+
+            /**
+            * \brief Maps are not copyable: the tile index points into the tile container.
+            */
+            Map(const Map&) = delete;
+            Map& operator=(const Map&) = delete;
             
             /**
             * \Brief Gets the map height.
@@ -83,12 +110,14 @@ namespace Overseer{
             const Region* getNearestRegion(sc2::Point2D pos);
             
             /**
-            * \brief Apends a tile to container.
+            * \brief Apends many tiles to the container at once, then rebuilds it balanced.
             *
-            * \param pos The tile position.
-            * \param tile The tile to add.
+            * The container is read-only once built, every call rebuilds it around median tiles,
+            * in a flat layout without pointers between tiles. Add tiles in as few calls as possible.
+            *
+            * \param tilePositions The tiles to add.
             */
-            void addTile(sc2::Point2D& pos, std::shared_ptr<Tile> tile);
+            void addTiles(const std::vector<TilePosition>& tilePositions);
             
             /**
             * \brief Check if a position is on map
@@ -116,7 +145,7 @@ namespace Overseer{
             * \brief Gets a tile based on the position.
             *
             * \param pos The position of the tile.
-            * \return the found tile.
+            * \return the found tile, or an empty pointer if there is no tile at pos.
             */
             std::shared_ptr<Tile> GetTile(sc2::Point2D pos);
             
@@ -132,7 +161,8 @@ namespace Overseer{
             * 
             * \return the tile position container.
             */
-            TilePositionContainer getTilePositions();          
+            const TilePositionContainer& getTilePositions() const;
+
             /**
             * \brief set the bot into overseer
             *
@@ -154,6 +184,97 @@ namespace Overseer{
             */
             RawFrontier getRawFrontier();
             
+            /**
+            * \brief Get the terrain height at a position.
+            *
+            * \param pos The position.
+            * \return the terrain height, 0 outside the map.
+            */
+            float getTerrainHeight(sc2::Point2D pos) const;
+            
+            /**
+            * \brief Get the height level at a position, as in Tile::GroundHeight.
+            *
+            * \param pos The position.
+            * \return the height level, 0 outside the map.
+            */
+            int getGroundHeight(sc2::Point2D pos) const;
+            
+            /**
+            * \brief Check if a unit standing at from can see to, following the high ground rules.
+            *
+            * A tile can only be seen from the same height level or above, and any higher tile on the
+            * line between the two blocks the sight.
+            *
+            * \param from The position of the viewer.
+            * \param to The position to look at.
+            * \return True if to is in line of sight, false otherwise.
+            */
+            bool LineOfSight(sc2::Point2D from, sc2::Point2D to) const;
+            
+            /**
+            * \brief Count the tiles visible from a position within a sight range.
+            *
+            * \param pos The position of the viewer.
+            * \param range The sight range, clamped to constants::max_sight_range.
+            * \return the number of visible tiles.
+            */
+            size_t getVisibleArea(sc2::Point2D pos, float range) const;
+            
+            /**
+            * \brief Gets all the ramps found, a ramp with id n is at index n - 1.
+            *
+            * \return vector of ramps.
+            */
+            const std::vector<Ramp>& getRamps() const;
+            
+            /**
+            * \brief Get a specific ramp.
+            *
+            * \param id The id of the ramp.
+            * \return pointer to the ramp, nullptr if there is no such ramp.
+            */
+            const Ramp* getRamp(size_t id) const;
+            
+            /**
+            * \brief Get the ramp a position is on.
+            *
+            * \param pos The position.
+            * \return pointer to the ramp, nullptr if the position is not on a ramp.
+            */
+            const Ramp* getRampAt(sc2::Point2D pos) const;
+            
+            /**
+            * \brief Get the ramp leading out of the main base of a start location.
+            *
+            * \param startLocation The start location, the closest known start location is used.
+            * \return pointer to the ramp, nullptr if none was found.
+            */
+            const Ramp* getMainRamp(sc2::Point2D startLocation) const;
+            
+            /**
+            * \brief Gets the symmetry of the map.
+            *
+            * \return the symmetry, no_symmetry if none was found.
+            */
+            Symmetry getSymmetry() const;
+            
+            /**
+            * \brief Get the position mirroring a position, such as the enemy's equivalent of a base.
+            *
+            * \param pos The position, tile centers map to tile centers.
+            * \return the mirrored position, pos itself if the map has no symmetry.
+            */
+            sc2::Point2D Mirror(sc2::Point2D pos) const;
+            
+            /**
+            * \brief Get the region mirroring a region.
+            *
+            * \param regionId The id of the region.
+            * \return the id of the mirrored region, 0 if unknown.
+            */
+            size_t Mirror(size_t regionId) const;
+            
         protected:
             
             std::pair<size_t, size_t> findNeighboringRegions(std::shared_ptr<TilePosition> tilePosition);
@@ -163,11 +284,22 @@ namespace Overseer{
             
             UnitPositionContainer m_unitPositions;
             TilePositionContainer m_tilePositions;
+            TileIndex m_tileIndex;
             std::vector<std::shared_ptr<TilePosition>> m_buildableTiles;
             RegionMap m_regions;
             std::vector<std::shared_ptr<TilePosition>> m_frontierPositions;
             RawFrontier m_rawFrontier;
             
+            std::vector<float> m_terrainHeight;
+            std::vector<uint8_t> m_groundHeights;
+            
+            std::vector<Ramp> m_ramps;
+            std::vector<uint32_t> m_rampIds;
+            std::vector<std::pair<sc2::Point2D, size_t>> m_mainRamps;
+            
+            Symmetry m_symmetry;
+            std::vector<size_t> m_mirrorRegions;
+            
             sc2::Point2D m_maxPlayable;
             sc2::Point2D m_minPlayable;
             sc2::Point2D m_centerPlayable;
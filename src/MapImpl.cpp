@@ -1,5 +1,9 @@
 #include "MapImpl.h"
 
+#include <bitset>
+#include <cmath>
+#include <limits>
+
 namespace Overseer{
     /*
     ****************************
@@ -9,9 +13,9 @@ namespace Overseer{
 
     MapImpl::~MapImpl(){}
 
-    MapImpl::MapImpl(sc2::Agent* bot):Map(bot){}
+    MapImpl::MapImpl(sc2::Agent* bot):Map(bot),m_exactSymmetry(false){}
 
-    MapImpl::MapImpl():Map(){}
+    MapImpl::MapImpl():Map(),m_exactSymmetry(false){}
 
     void MapImpl::Initialize(){
         m_graph.setMap(this);
@@ -20,7 +24,12 @@ namespace Overseer{
         std::vector<Region> tmp_regions = ComputeTempRegions();
         CreateRegions(tmp_regions);
         CreateFrontiers();
+        MirrorRegions();
+        ComputeCliffEdges();
         m_graph.CreateChokePoints();
+        CreateRamps();
+        m_wallPlanner.setMap(this);
+        m_influenceMap.setMap(this);
     }
 
     Graph MapImpl::getGraph(){
@@ -28,6 +37,16 @@ namespace Overseer{
     	return m_graph; 
     }
 
+    const WallLayout& MapImpl::getWallLayout(ChokePoint& chokePoint, std::vector<size_t> footprints, bool gap){
+
+        return m_wallPlanner.Plan(chokePoint, footprints, gap);
+    }
+
+    InfluenceMap& MapImpl::getInfluenceMap(){
+
+        return m_influenceMap;
+    }
+
     /*
     ***************************
     *** Public members stop ***
@@ -43,15 +62,33 @@ namespace Overseer{
     */
 
     void MapImpl::CreateTiles() {
+        const sc2::ImageData& terrain = m_bot->Observation()->GetGameInfo().terrain_height;
+        bool decodeHeight = (terrain.data.size() == m_width * m_height);
+        std::vector<std::shared_ptr<Tile>> tiles(m_width * m_height);
+        std::vector<TilePosition> unbuildableTiles;
+        m_terrainHeight.assign(m_width * m_height, 0.0f);
 
         for (size_t x(0); x < m_width; ++x) {
 
             for (size_t y(0); y < m_height; ++y) {
                 sc2::Point2D pos(x,y);            
-                bool buildable = (m_bot->Observation()->IsPlacable(pos) || m_bot->Observation()->IsPathable(pos));
+                bool placeable = m_bot->Observation()->IsPlacable(pos);
+                bool pathable = m_bot->Observation()->IsPathable(pos);
+                bool buildable = (placeable || pathable);
                 std::shared_ptr<Tile> tile = std::make_shared<Tile>();
                 tile->setBuildable(buildable);
+                tile->setPlaceable(placeable);
+                tile->setPathable(pathable);
                 tile->setRegionId(0);
+
+                //The height image is stored top row first, one byte per tile,
+                //the fallback rescales the API height so both paths share one scale
+                float fraction = decodeHeight ? (unsigned char) terrain.data[x + (m_height - 1 - y) * m_width] / 255.0f
+                                              : (m_bot->Observation()->TerrainHeight(pos) - constants::api_min_terrain_height) / constants::api_terrain_height_range;
+                float height = constants::min_terrain_height + constants::terrain_height_range * fraction;
+                tile->setTerrainHeight(height);
+                m_terrainHeight[y * m_width + x] = height;
+                tiles[y * m_width + x] = tile;
                 
                 if(buildable) {
                     m_buildableTiles.push_back(std::shared_ptr<TilePosition>(new TilePosition(std::make_pair(pos, tile))));
@@ -59,19 +96,108 @@ namespace Overseer{
                 } else {
                     //Add ubuildable tiles to k-d tree, for rapid retrieval when it's time to compute altitudes
                     tile->setDistNearestUnpathable(0);
-                    addTile(pos, tile);
+                    unbuildableTiles.push_back(std::make_pair(pos, tile));
                 }
             }
         }
+
+        addTiles(unbuildableTiles);
+
+        ComputeGroundHeights(tiles);
+        DetectSymmetry(tiles);
+    }
+
+    void MapImpl::ComputeGroundHeights(const std::vector<std::shared_ptr<Tile>>& tiles) {
+        //Placeable tiles are flat, the lowest of them is height level 0
+        float base = std::numeric_limits<float>::max();
+
+        for(size_t i(0); i < tiles.size(); ++i) {
+            if(tiles[i]->Placeable() || tiles[i]->Pathable()) {
+                base = std::min(base, m_terrainHeight[i]);
+            }
+        }
+
+        //Padded so rows can be read 16 tiles at a time
+        m_groundHeights.assign(tiles.size() + 16, 0);
+        m_rampIds.assign(tiles.size(), 0);
+
+        for(size_t i(0); i < tiles.size(); ++i) {
+            float level = (m_terrainHeight[i] - base) / constants::level_height;
+            int groundHeight = std::max(0, std::min(3, (int) std::round(level)));
+            tiles[i]->setGroundHeight(groundHeight);
+            m_groundHeights[i] = groundHeight;
+
+            //Pathable but not placeable, and either between two height levels or sloping towards a walkable neighbor
+            bool ramp = tiles[i]->Pathable() && !tiles[i]->Placeable() &&
+                        (std::abs(level - std::round(level)) > constants::ramp_tolerance || Sloping(tiles, i));
+            tiles[i]->setRamp(ramp);
+            m_rampIds[i] = ramp;
+        }
+    }
+
+    bool MapImpl::Sloping(const std::vector<std::shared_ptr<Tile>>& tiles, size_t index) const {
+        int x = index % m_width;
+        int y = index / m_width;
+
+        for(sc2::Point2DI delta: {sc2::Point2DI(0,-1), sc2::Point2DI(0,1), sc2::Point2DI(-1,0), sc2::Point2DI(1,0)}) {
+            int nx = x + delta.x;
+            int ny = y + delta.y;
+
+            if(nx < 0 || ny < 0 || nx >= (int) m_width || ny >= (int) m_height || !tiles[ny * m_width + nx]->Pathable()) {
+                continue;
+            }
+
+            float slope = std::abs(m_terrainHeight[ny * m_width + nx] - m_terrainHeight[index]);
+
+            if(constants::min_slope < slope && slope < constants::cliff_height) {
+
+                return true;
+            }
+        }
+
+        return false;
     }
 
     void MapImpl::ComputeAltitudes() {
+        //On an exactly symmetric map only one half is searched, the other half copies its mirror
+        std::vector<std::shared_ptr<TilePosition>> mirrors;
+
+        if(m_exactSymmetry) {
+            std::vector<std::shared_ptr<TilePosition>> grid(m_width * m_height);
+
+            for(auto& buildableTile: m_buildableTiles) {
+                grid[buildableTile->first.y * m_width + buildableTile->first.x] = buildableTile;
+            }
+
+            mirrors.resize(m_buildableTiles.size());
+
+            for(size_t i(0); i < m_buildableTiles.size(); ++i) {
+                sc2::Point2D pos = m_buildableTiles[i]->first;
+                sc2::Point2D mirror = Mirror(sc2::Point2D(pos.x + 0.5f, pos.y + 0.5f));
+                int x = std::floor(mirror.x);
+                int y = std::floor(mirror.y);
+                size_t index = pos.y * m_width + pos.x;
+
+                if(0 <= x && x < (int) m_width && 0 <= y && y < (int) m_height && y * m_width + x < index) {
+                    mirrors[i] = grid[y * m_width + x];
+                }
+            }
+        }
         
         //For each buildable tile, find the distance to the nearest unbuildable tile
-        for(auto& buildableTile: m_buildableTiles) {
+        //One iterator is reset for every tile, so its queue is only allocated once
+        spatial::best_first_neighbor_iterator<TilePositionContainer> end = best_first_neighbor_end(m_tilePositions, sc2::Point2D());
+        spatial::best_first_neighbor_iterator<TilePositionContainer> iter = end;
+
+        for(size_t i(0); i < m_buildableTiles.size(); ++i) {
+            std::shared_ptr<TilePosition>& buildableTile = m_buildableTiles[i];
             sc2::Point2D pos = buildableTile->first;
+
+            if(!mirrors.empty() && mirrors[i]) {
+                continue;
+            }
             
-            for(spatial::neighbor_iterator<TilePositionContainer> iter = neighbor_begin(m_tilePositions, pos); iter != neighbor_end(m_tilePositions, pos); iter++) {
+            for(iter.reset(m_tilePositions, pos); iter != end; ++iter) {
                 
                 if(!(iter->second->Buildable())){
                     buildableTile->second->setDistNearestUnpathable(distance(iter));
@@ -80,13 +206,25 @@ namespace Overseer{
                 }
             }
         }
+
+        for(size_t i(0); i < mirrors.size(); ++i) {
+
+            if(mirrors[i]) {
+                m_buildableTiles[i]->second->setDistNearestUnpathable(mirrors[i]->second->getDistNearestUnpathable());
+            }
+        }
         
         std::sort(m_buildableTiles.begin(), m_buildableTiles.end(), GreaterTile());
         
-        //Push buildable tiles into k-d tree
+        //Push buildable tiles into k-d tree, the tree is rebuilt once with all tiles
+        std::vector<TilePosition> buildableTiles;
+        buildableTiles.reserve(m_buildableTiles.size());
+
         for(const auto& buildableTile: m_buildableTiles) {
-            addTile(buildableTile->first, buildableTile->second);
+            buildableTiles.push_back(*buildableTile);
         }
+
+        addTiles(buildableTiles);
     }
 
     std::vector<Region> MapImpl::ComputeTempRegions() {
@@ -170,6 +308,350 @@ namespace Overseer{
         }
     }
 
+    void MapImpl::DetectSymmetry(const std::vector<std::shared_ptr<Tile>>& tiles) {
+        const sc2::GameInfo& gameInfo = m_bot->Observation()->GetGameInfo();
+        int x0 = std::max(0, (int) gameInfo.playable_min.x);
+        int y0 = std::max(0, (int) gameInfo.playable_min.y);
+        int x1 = std::min((int) m_width, (int) gameInfo.playable_max.x);
+        int y1 = std::min((int) m_height, (int) gameInfo.playable_max.y);
+
+        if(x1 <= x0 || y1 <= y0) {
+            x0 = y0 = 0;
+            x1 = m_width;
+            y1 = m_height;
+        }
+
+        m_minPlayable = sc2::Point2D(x0, y0);
+        m_maxPlayable = sc2::Point2D(x1, y1);
+        m_centerPlayable = sc2::Point2D((x0 + x1) / 2.0f, (y0 + y1) / 2.0f);
+        m_symmetry = no_symmetry;
+        m_exactSymmetry = false;
+
+        //Pack the pathing and placement grids 64 tiles to a word: rows as they are, rows reversed,
+        //columns (the transposed grid) and columns reversed. Every symmetry then compares whole words.
+        int width = x1 - x0;
+        int height = y1 - y0;
+        int side = std::max(width, height);
+        size_t words = (side + 63) / 64;
+        std::vector<uint64_t> rows[2], reversedRows[2], columns[2], reversedColumns[2];
+
+        for(int grid(0); grid < 2; ++grid) {
+            rows[grid].assign(side * words, 0);
+            reversedRows[grid].assign(side * words, 0);
+            columns[grid].assign(side * words, 0);
+            reversedColumns[grid].assign(side * words, 0);
+        }
+
+        for(int y(0); y < height; ++y) {
+
+            for(int x(0); x < width; ++x) {
+                const std::shared_ptr<Tile>& tile = tiles[(y0 + y) * m_width + x0 + x];
+                bool set[2] = {tile->Pathable(), tile->Placeable()};
+
+                for(int grid(0); grid < 2; ++grid) {
+
+                    if(set[grid]) {
+                        rows[grid][y * words + x / 64] |= uint64_t(1) << (x % 64);
+                        reversedRows[grid][y * words + (width - 1 - x) / 64] |= uint64_t(1) << ((width - 1 - x) % 64);
+                        columns[grid][x * words + y / 64] |= uint64_t(1) << (y % 64);
+                        reversedColumns[grid][x * words + (height - 1 - y) / 64] |= uint64_t(1) << ((height - 1 - y) % 64);
+                    }
+                }
+            }
+        }
+
+        //Compare row y of the grid with the row holding its mirror image
+        auto mismatches = [&](const std::vector<uint64_t>* mirrored, bool flipRows) {
+            size_t count = 0;
+
+            for(int grid(0); grid < 2; ++grid) {
+
+                for(int y(0); y < height; ++y) {
+                    const uint64_t* row = rows[grid].data() + y * words;
+                    const uint64_t* mirror = mirrored[grid].data() + (flipRows ? height - 1 - y : y) * words;
+
+                    for(size_t word(0); word < words; ++word) {
+                        count += std::bitset<64>(row[word] ^ mirror[word]).count();
+                    }
+                }
+            }
+
+            return count;
+        };
+
+        std::vector<std::pair<Symmetry, size_t>> candidates;
+        candidates.push_back(std::make_pair(rotational, mismatches(reversedRows, true)));
+        candidates.push_back(std::make_pair(reflect_x, mismatches(reversedRows, false)));
+        candidates.push_back(std::make_pair(reflect_y, mismatches(rows, true)));
+
+        if(width == height) {
+            candidates.push_back(std::make_pair(reflect_diagonal, mismatches(columns, false)));
+            candidates.push_back(std::make_pair(reflect_anti_diagonal, mismatches(reversedColumns, true)));
+        }
+
+        //Rotational symmetry is the most common on ladder maps and wins ties
+        std::pair<Symmetry, size_t> best = candidates.front();
+
+        for(auto const & candidate : candidates) {
+            if(candidate.second < best.second) {
+                best = candidate;
+            }
+        }
+
+        if(best.second <= constants::max_symmetry_mismatch * 2 * width * height) {
+            m_symmetry = best.first;
+            m_exactSymmetry = (best.second == 0);
+        }
+    }
+
+    void MapImpl::MirrorRegions() {
+        m_mirrorRegions.assign(m_regions.size() + 1, 0);
+
+        if(m_symmetry == no_symmetry) {
+            return;
+        }
+
+        for(auto& region : m_regions) {
+            sc2::Point2D midPoint = region.second->getMidPoint();
+            const Region* mirror = getNearestRegion(Mirror(sc2::Point2D(midPoint.x + 0.5f, midPoint.y + 0.5f)));
+
+            if(region.first < m_mirrorRegions.size() && mirror) {
+                m_mirrorRegions[region.first] = mirror->getId();
+            }
+        }
+    }
+
+    void MapImpl::CreateRamps() {
+        //Label connected ramp tiles in a single scan, merging labels with a union-find
+        std::vector<uint32_t> parent(1, 0);
+        std::vector<size_t> rampTiles;
+        auto root = [&parent](uint32_t label) {
+            while(parent[label] != label) {
+                parent[label] = parent[parent[label]];
+                label = parent[label];
+            }
+
+            return label;
+        };
+
+        for(size_t y(0); y < m_height; ++y) {
+
+            for(size_t x(0); x < m_width; ++x) {
+                size_t i = y * m_width + x;
+
+                if(!m_rampIds[i]) {
+                    continue;
+                }
+
+                uint32_t label = 0;
+
+                //Only the neighbors already scanned: west, north west, north and north east
+                for(sc2::Point2DI delta: {sc2::Point2DI(-1,0), sc2::Point2DI(-1,-1), sc2::Point2DI(0,-1), sc2::Point2DI(1,-1)}) {
+                    int nx = x + delta.x;
+                    int ny = y + delta.y;
+
+                    if(nx < 0 || ny < 0 || nx >= (int) m_width || !m_rampIds[ny * m_width + nx]) {
+                        continue;
+                    }
+
+                    uint32_t neighbor = root(m_rampIds[ny * m_width + nx]);
+
+                    if(!label) {
+                        label = neighbor;
+
+                    } else if(neighbor != label) {
+                        parent[std::max(neighbor, label)] = std::min(neighbor, label);
+                        label = std::min(neighbor, label);
+                    }
+                }
+
+                if(!label) {
+                    label = parent.size();
+                    parent.push_back(label);
+                }
+
+                m_rampIds[i] = label;
+                rampTiles.push_back(i);
+            }
+        }
+
+        std::vector<std::vector<size_t>> components(parent.size());
+
+        for(size_t i : rampTiles) {
+            components[root(m_rampIds[i])].push_back(i);
+            m_rampIds[i] = 0;
+        }
+
+        for(auto const & component : components) {
+
+            if(component.size() < constants::min_ramp_area) {
+                continue;
+            }
+
+            std::vector<sc2::Point2D> points;
+
+            for(size_t i : component) {
+                points.push_back(sc2::Point2D(i % m_width, i / m_width));
+            }
+
+            Ramp ramp(m_ramps.size() + 1, points);
+
+            if(SetRampEnds(ramp, component)) {
+
+                for(size_t i : component) {
+                    m_rampIds[i] = ramp.getId();
+                }
+                m_ramps.push_back(ramp);
+            }
+        }
+
+        for(auto & ramp : m_ramps) {
+            size_t top = ramp.getTopRegion()->getId();
+            size_t bottom = ramp.getBottomRegion()->getId();
+            ChokePoint* chokePoint = m_graph.getChokePoint(top, bottom, ramp.getMidPoint());
+
+            if(chokePoint) {
+                ramp.setChokePoint(chokePoint);
+                chokePoint->setRampId(ramp.getId());
+            }
+
+            getRegion(top)->AddRamp(ramp.getId());
+            if(bottom != top) {
+                getRegion(bottom)->AddRamp(ramp.getId());
+            }
+        }
+
+        FindMainRamps();
+    }
+
+    bool MapImpl::SetRampEnds(Ramp& ramp, const std::vector<size_t>& component) {
+        //Pathable tiles around the ramp, with their terrain height
+        std::vector<std::pair<float, std::shared_ptr<TilePosition>>> border;
+        float minHeight = std::numeric_limits<float>::max();
+        float maxHeight = std::numeric_limits<float>::lowest();
+
+        for(size_t i : component) {
+            int x = i % m_width;
+            int y = i / m_width;
+
+            for(int dy(-1); dy <= 1; ++dy) {
+
+                for(int dx(-1); dx <= 1; ++dx) {
+                    int nx = x + dx;
+                    int ny = y + dy;
+
+                    if(nx < 0 || ny < 0 || nx >= (int) m_width || ny >= (int) m_height) {
+                        continue;
+                    }
+
+                    sc2::Point2D pos(nx, ny);
+                    std::shared_ptr<Tile> tile = GetTile(pos);
+
+                    if(tile && tile->Pathable() && !tile->Ramp() && tile->getRegionId()) {
+                        float height = m_terrainHeight[ny * m_width + nx];
+                        border.push_back(std::make_pair(height, std::make_shared<TilePosition>(pos, tile)));
+                        minHeight = std::min(minHeight, height);
+                        maxHeight = std::max(maxHeight, height);
+                    }
+                }
+            }
+        }
+
+        //A ramp has to join two height levels
+        if(border.empty() || maxHeight - minHeight < constants::level_height / 2) {
+
+            return false;
+        }
+
+        std::map<size_t, size_t> topVotes, bottomVotes;
+        sc2::Point2D topSum, bottomSum;
+        size_t topCount = 0, bottomCount = 0;
+        float tolerance = constants::ramp_tolerance * constants::level_height;
+
+        for(auto const & tile : border) {
+
+            if(tile.first >= maxHeight - tolerance) {
+                topSum = topSum + tile.second->first;
+                topVotes[tile.second->second->getRegionId()]++;
+                topCount++;
+
+            } else if(tile.first <= minHeight + tolerance) {
+                bottomSum = bottomSum + tile.second->first;
+                bottomVotes[tile.second->second->getRegionId()]++;
+                bottomCount++;
+            }
+        }
+
+        auto vote = [](const std::map<size_t, size_t>& votes) {
+            return std::max_element(votes.begin(), votes.end(),
+                [](const std::pair<const size_t, size_t>& a, const std::pair<const size_t, size_t>& b){ return a.second < b.second; })->first;
+        };
+
+        //Tile corners are shifted to the tile centers
+        ramp.setEnds(getRegion(vote(topVotes)), sc2::Point2D(topSum.x / topCount + 0.5f, topSum.y / topCount + 0.5f),
+                     getRegion(vote(bottomVotes)), sc2::Point2D(bottomSum.x / bottomCount + 0.5f, bottomSum.y / bottomCount + 0.5f));
+
+        return ramp.getTopRegion() && ramp.getBottomRegion();
+    }
+
+    void MapImpl::FindMainRamps() {
+        std::vector<sc2::Point2D> startLocations = m_bot->Observation()->GetGameInfo().enemy_start_locations;
+        startLocations.push_back(m_bot->Observation()->GetStartLocation());
+
+        for(auto const & startLocation : startLocations) {
+            const Region* main = getNearestRegion(startLocation);
+            const Ramp* mainRamp = nullptr;
+            float closestDistance = std::numeric_limits<float>::max();
+
+            //The closest ramp going down from the main, or any ramp touching it if there is none
+            for(int pass(0); pass < 2 && !mainRamp && main; ++pass) {
+
+                for(auto const & ramp : m_ramps) {
+                    bool candidate = pass ? (ramp.getTopRegion() == main || ramp.getBottomRegion() == main) : ramp.getTopRegion() == main;
+                    float distance = sc2::Distance2D(ramp.getMidPoint(), startLocation);
+
+                    if(candidate && distance < closestDistance) {
+                        closestDistance = distance;
+                        mainRamp = &ramp;
+                    }
+                }
+            }
+
+            if(mainRamp) {
+                m_mainRamps.push_back(std::make_pair(startLocation, mainRamp->getId()));
+            }
+        }
+    }
+
+    void MapImpl::ComputeCliffEdges() {
+        
+        for(auto& region : m_regions) {
+            std::vector<TilePosition> cliffPositions;
+            
+            for(auto& tilePosition : region.second->getTilePositions()) {
+                int x = tilePosition.first.x;
+                int y = tilePosition.first.y;
+                float height = m_terrainHeight[y * m_width + x];
+                
+                for(sc2::Point2DI delta: {sc2::Point2DI(0,-1), sc2::Point2DI(0,1), sc2::Point2DI(-1,0), sc2::Point2DI(1,0)}) {
+                    int nx = x + delta.x;
+                    int ny = y + delta.y;
+                    
+                    if(0 <= nx && nx < (int) m_width && 0 <= ny && ny < (int) m_height &&
+                       std::abs(m_terrainHeight[ny * m_width + nx] - height) >= constants::cliff_height) {
+                        cliffPositions.push_back(tilePosition);
+                        
+                        break;
+                    }
+                }
+            }
+            
+            if(!cliffPositions.empty()) {
+                region.second->AddEdge(RegionEdge(region.second.get(), nullptr, cliffPositions, cliff));
+            }
+        }
+    }
+
     /*
     ****************************
     *** Priavte members stop ***
@@ -2,9 +2,12 @@
 #define _MAPIMPL_H_
 
 #include "Graph.h"
+#include "InfluenceMap.h"
 #include "Map.h"
+#include "WallPlanner.h"
 #include "spatial/box_multimap.hpp"
 #include "spatial/neighbor_iterator.hpp"
+#include "spatial/best_first_neighbor_iterator.hpp"
 #include "spatial/ordered_iterator.hpp"
 
 namespace Overseer{
@@ -37,12 +40,57 @@ namespace Overseer{
             */
             Graph getGraph();
 
+            /**
+            * \brief Find a building layout that walls off a chokepoint, results are cached per chokepoint.
+            *
+            * \param chokePoint The chokepoint to wall.
+            * \param footprints Sizes of the buildings available for the wall (2, 3 or 5).
+            * \param gap If true, leave a one tile gap in the wall.
+            * \return The best layout found.
+            */
+            const WallLayout& getWallLayout(ChokePoint& chokePoint, std::vector<size_t> footprints, bool gap = false);
+
+            /**
+            * \brief get the influence layers of the map, allocated by Initialize().
+            *
+            * \return reference to the influence map.
+            */
+            InfluenceMap& getInfluenceMap();
+
         private:
             /**
             * \brief Create the tiles from the map.
             */
             void CreateTiles();
             
+            /**
+            * \brief Compute the height level of every tile from its terrain height, and flag ramp tiles.
+            *
+            * \param tiles All tiles of the map, indexed y * width + x.
+            */
+            void ComputeGroundHeights(const std::vector<std::shared_ptr<Tile>>& tiles);
+            
+            /**
+            * \brief Check if the terrain slopes between a tile and one of its pathable neighbors.
+            *
+            * \param tiles All tiles of the map, indexed y * width + x.
+            * \param index The index of the tile.
+            * \return True if the height changes by more than a step and less than a cliff.
+            */
+            bool Sloping(const std::vector<std::shared_ptr<Tile>>& tiles, size_t index) const;
+            
+            /**
+            * \brief Find rotational or reflective symmetry of the pathing and placement grids.
+            *
+            * \param tiles All tiles of the map, indexed y * width + x.
+            */
+            void DetectSymmetry(const std::vector<std::shared_ptr<Tile>>& tiles);
+            
+            /**
+            * \brief Find the mirror image of every region.
+            */
+            void MirrorRegions();
+            
             /**
             * \brief Iterate over the tiles and compute the distance to nearest unpathable tile
             */
@@ -58,8 +106,35 @@ namespace Overseer{
             
             
             void CreateFrontiers();
+            
+            /**
+            * \brief Add an edge to every region holding its tiles next to a cliff.
+            */
+            void ComputeCliffEdges();
+            
+            /**
+            * \brief Find the ramps in a single scan over the grid and link them to regions and chokepoints.
+            */
+            void CreateRamps();
+            
+            /**
+            * \brief Find the regions and centers at both ends of a ramp.
+            *
+            * \param ramp The ramp.
+            * \param component The tile indices (y * width + x) of the ramp.
+            * \return True if the ramp joins two height levels, false otherwise.
+            */
+            bool SetRampEnds(Ramp& ramp, const std::vector<size_t>& component);
+            
+            /**
+            * \brief Find the ramp out of the main base of every start location.
+            */
+            void FindMainRamps();
 
             Graph m_graph;
+            bool m_exactSymmetry;
+            WallPlanner m_wallPlanner;
+            InfluenceMap m_influenceMap;
             static const size_t min_region_area = 80;
     };
 }
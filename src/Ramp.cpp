@@ -0,0 +1,94 @@
+#include "Ramp.h"
+
+namespace Overseer{
+	/*
+	****************************
+	*** Public members start ***
+	****************************
+	*/
+
+	Ramp::Ramp(size_t rampId, std::vector<sc2::Point2D> points)
+		:m_id(rampId),m_points(points),p_topRegion(nullptr),p_bottomRegion(nullptr),p_chokePoint(nullptr){
+		sc2::Point2D sum;
+
+		for(auto const & point : m_points) {
+			sum = sum + point;
+		}
+
+		if(!m_points.empty()) {
+			m_midPoint = sc2::Point2D(sum.x / m_points.size(), sum.y / m_points.size());
+		}
+		m_topCenter = m_midPoint;
+		m_bottomCenter = m_midPoint;
+	}
+
+	size_t Ramp::getId() const {
+
+		return m_id;
+	}
+
+	const std::vector<sc2::Point2D>& Ramp::getPoints() const {
+
+		return m_points;
+	}
+
+	size_t Ramp::Size() const {
+
+		return m_points.size();
+	}
+
+	sc2::Point2D Ramp::getMidPoint() const {
+
+		return m_midPoint;
+	}
+
+	const Region* Ramp::getTopRegion() const {
+
+		return p_topRegion;
+	}
+
+	const Region* Ramp::getBottomRegion() const {
+
+		return p_bottomRegion;
+	}
+
+	sc2::Point2D Ramp::getTopCenter() const {
+
+		return m_topCenter;
+	}
+
+	sc2::Point2D Ramp::getBottomCenter() const {
+
+		return m_bottomCenter;
+	}
+
+	sc2::Point2D Ramp::getDirection() const {
+
+		return m_direction;
+	}
+
+	const ChokePoint* Ramp::getChokePoint() const {
+
+		return p_chokePoint;
+	}
+
+	void Ramp::setEnds(const Region* top, sc2::Point2D topCenter, const Region* bottom, sc2::Point2D bottomCenter) {
+		p_topRegion = top;
+		p_bottomRegion = bottom;
+		m_topCenter = topCenter;
+		m_bottomCenter = bottomCenter;
+
+		float length = sc2::Distance2D(topCenter, bottomCenter);
+		m_direction = length > 0 ? sc2::Point2D((topCenter.x - bottomCenter.x) / length, (topCenter.y - bottomCenter.y) / length) : sc2::Point2D();
+	}
+
+	void Ramp::setChokePoint(const ChokePoint* chokePoint) {
+		p_chokePoint = chokePoint;
+	}
+
+	/*
+	***************************
+	*** Public members stop ***
+	***************************
+	*/
+}
@@ -0,0 +1,125 @@
+#ifndef _OVERSEER_RAMP_H_
+#define _OVERSEER_RAMP_H_
+
+#include "Region.h"
+
+namespace Overseer{
+
+    class ChokePoint;
+
+    /**
+    * \class Ramp Ramp.h "Ramp.h"
+    * \brief A ramp, a group of pathable but not placeable tiles sloping between two height levels.
+    */
+    class Ramp {
+        public:
+
+            /**
+            * \brief constructor.
+            *
+            * \param rampId The id of the ramp, ramp ids start at 1.
+            * \param points The positions of the tiles on the ramp.
+            */
+            Ramp(size_t rampId, std::vector<sc2::Point2D> points);
+
+            /**
+            * \brief return ramp id.
+            *
+            * \return This ramp id
+            */
+            size_t getId() const;
+
+            /**
+            * \brief Gets the positions of the tiles on the ramp.
+            *
+            * \return vector containing the ramp positions
+            */
+            const std::vector<sc2::Point2D>& getPoints() const;
+
+            /**
+            * \brief Get the number of tiles on the ramp
+            *
+            * \return The size of the ramp
+            */
+            size_t Size() const;
+
+            /**
+            * \brief Gets the mid point of the ramp
+            *
+            * \return The mid point of the ramp
+            */
+            sc2::Point2D getMidPoint() const;
+
+            /**
+            * \brief Gets the region at the top of the ramp.
+            *
+            * \return pointer to the region, nullptr if none was found.
+            */
+            const Region* getTopRegion() const;
+
+            /**
+            * \brief Gets the region at the bottom of the ramp.
+            *
+            * \return pointer to the region, nullptr if none was found.
+            */
+            const Region* getBottomRegion() const;
+
+            /**
+            * \brief Gets the center of the tiles where the ramp meets the high ground.
+            *
+            * \return the top center.
+            */
+            sc2::Point2D getTopCenter() const;
+
+            /**
+            * \brief Gets the center of the tiles where the ramp meets the low ground.
+            *
+            * \return the bottom center.
+            */
+            sc2::Point2D getBottomCenter() const;
+
+            /**
+            * \brief Gets the direction going up the ramp.
+            *
+            * \return unit vector from the bottom center towards the top center.
+            */
+            sc2::Point2D getDirection() const;
+
+            /**
+            * \brief Gets the chokepoint covering the ramp.
+            *
+            * \return pointer to the chokepoint, nullptr if the ramp is not on a chokepoint.
+            */
+            const ChokePoint* getChokePoint() const;
+
+            /**
+            * \brief Set the regions and centers at both ends of the ramp, computes the direction.
+            *
+            * \param top The region on the high ground.
+            * \param topCenter The center of the tiles bordering the high ground.
+            * \param bottom The region on the low ground.
+            * \param bottomCenter The center of the tiles bordering the low ground.
+            */
+            void setEnds(const Region* top, sc2::Point2D topCenter, const Region* bottom, sc2::Point2D bottomCenter);
+
+            /**
+            * \brief Set the chokepoint covering the ramp.
+            *
+            * \param chokePoint The chokepoint.
+            */
+            void setChokePoint(const ChokePoint* chokePoint);
+
+        private:
+            size_t m_id;
+            std::vector<sc2::Point2D> m_points;
+            sc2::Point2D m_midPoint;
+            sc2::Point2D m_topCenter;
+            sc2::Point2D m_bottomCenter;
+            sc2::Point2D m_direction;
+            const Region* p_topRegion;
+            const Region* p_bottomRegion;
+            const ChokePoint* p_chokePoint;
+    };
+}
+
+#endif /* _OVERSEER_RAMP_H_ */
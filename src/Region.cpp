@@ -37,6 +37,19 @@ namespace Overseer{
 
     std::vector<RegionEdge> Region::getEdges(){ return m_edges; }
 
+    void Region::AddEdge(const RegionEdge& edge) {
+        m_edges.push_back(edge);
+    }
+
+    const std::vector<size_t>& Region::getRamps() const {
+
+        return m_ramps;
+    }
+
+    void Region::AddRamp(size_t rampId) {
+        m_ramps.push_back(rampId);
+    }
+
     const std::vector<UnitPosition> Region::getNeutralUnitPositions(){
 
     	return m_neutralUnitPositions;
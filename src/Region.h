@@ -84,6 +84,27 @@ namespace Overseer{
             */
             std::vector<RegionEdge> getEdges();
             
+            /**
+            * \brief Add an edge to the region.
+            *
+            * \param edge The edge to add.
+            */
+            void AddEdge(const RegionEdge& edge);
+            
+            /**
+            * \brief Returns the ids of the ramps leading in or out of the region.
+            *
+            * \return vector with ramp ids.
+            */
+            const std::vector<size_t>& getRamps() const;
+            
+            /**
+            * \brief Add a ramp leading in or out of the region.
+            *
+            * \param rampId The id of the ramp.
+            */
+            void AddRamp(size_t rampId);
+            
             /**
             * \brief Returns the units and positions occupying the region
             *
@@ -162,6 +183,7 @@ namespace Overseer{
         private:
             std::vector<TilePosition> m_tilePositions;
             std::vector<RegionEdge> m_edges;
+            std::vector<size_t> m_ramps;
             std::vector<UnitPosition> m_neutralUnitPositions;
             
             float m_largestDistUnpathable;
@@ -176,6 +198,17 @@ namespace Overseer{
     */
     class RegionEdge {
         public:
+            /**
+            * \brief constructor.
+            *
+            * \param region The region the edge belongs to.
+            * \param other The region on the other side of the edge, nullptr if there is none.
+            * \param points The tile positions of the region along the edge.
+            * \param edgeType The kind of edge.
+            */
+            RegionEdge(const Region* region, const Region* other, std::vector<TilePosition> points, EdgeType edgeType)
+                :m_regions(region, other),m_points(points),m_edgeType(edgeType){}
+
             //Returns the regions this edge separates
             const std::pair<const Region *, const Region *> & getRegions(){return m_regions;}
             const std::vector<TilePosition> getPoints(){return m_points;}
@@ -12,11 +12,31 @@ namespace Overseer{
 		return m_tileInfo.buildable;
 	}
 
+	bool Tile::Placeable(){
+
+		return m_tileInfo.placeable;
+	}
+
+	bool Tile::Pathable(){
+
+		return m_tileInfo.pathable;
+	}
+
 	int Tile::GroundHeight(){
 
 		return m_tileInfo.groundHeight;
 	}
 
+	bool Tile::Ramp(){
+
+		return m_tileInfo.ramp;
+	}
+
+	float Tile::getTerrainHeight() const {
+
+		return m_terrainHeight;
+	}
+
 	bool Tile::Doodad(){
 
 		return m_tileInfo.doodad;
@@ -26,6 +46,26 @@ namespace Overseer{
 		m_tileInfo.buildable = buildable;
 	}
 
+	void Tile::setPlaceable(bool placeable){
+		m_tileInfo.placeable = placeable;
+	}
+
+	void Tile::setPathable(bool pathable){
+		m_tileInfo.pathable = pathable;
+	}
+
+	void Tile::setGroundHeight(int groundHeight){
+		m_tileInfo.groundHeight = groundHeight;
+	}
+
+	void Tile::setRamp(bool ramp){
+		m_tileInfo.ramp = ramp;
+	}
+
+	void Tile::setTerrainHeight(float height){
+		m_terrainHeight = height;
+	}
+
 	void Tile::setDistNearestUnpathable(float dist){
 		m_distNearestUnpathable = dist;
 	}
@@ -58,7 +98,7 @@ namespace Overseer{
 	*****************************
 	*/
 
-    Tile::TileInfo::TileInfo():buildable(false),groundHeight(0),doodad(false) {}
+    Tile::TileInfo::TileInfo():buildable(false),placeable(false),pathable(false),groundHeight(0),doodad(false),ramp(false) {}
 
 	/*
 	****************************
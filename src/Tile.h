@@ -19,12 +19,40 @@ namespace Overseer{
             bool Buildable();
             
             /**
-            * \brief Get the z-axis value for the tile.
+            * \brief check if a structure can be placed on the tile.
+            *
+            * \return true if the tile is on the placement grid, false otherwise
+            */
+            bool Placeable();
+            
+            /**
+            * \brief check if ground units can walk over the tile.
             *
-            * \return z-axis value.
+            * \return true if the tile is on the pathing grid, false otherwise
+            */
+            bool Pathable();
+            
+            /**
+            * \brief Get the height level of the tile, 0 being the lowest level on the map.
+            *
+            * \return height level.
             */
             int GroundHeight();
             
+            /**
+            * \brief check if the tile is on a ramp, sloping between two height levels.
+            *
+            * \return true if the tile is part of a ramp, false otherwise
+            */
+            bool Ramp();
+            
+            /**
+            * \brief Get the z-axis value for the tile.
+            *
+            * \return terrain height.
+            */
+            float getTerrainHeight() const;
+            
             /**
             * \brief corently not used...
             */
@@ -37,6 +65,41 @@ namespace Overseer{
             */
             void setBuildable(bool buildable);
             
+            /**
+            * \brief Set a tile to placeable.
+            *
+            * \param placeable boolean value, true if on the placement grid and false otherwise.
+            */
+            void setPlaceable(bool placeable);
+            
+            /**
+            * \brief Set a tile to pathable.
+            *
+            * \param pathable boolean value, true if on the pathing grid and false otherwise.
+            */
+            void setPathable(bool pathable);
+            
+            /**
+            * \brief Set the height level of the tile.
+            *
+            * \param groundHeight the height level, 0 to 3.
+            */
+            void setGroundHeight(int groundHeight);
+            
+            /**
+            * \brief Set a tile to be part of a ramp.
+            *
+            * \param ramp boolean value, true if on a ramp and false otherwise.
+            */
+            void setRamp(bool ramp);
+            
+            /**
+            * \brief Set the z-axis value for the tile.
+            *
+            * \param height The terrain height.
+            */
+            void setTerrainHeight(float height);
+            
             /**
             * \brief Set a distance to the nearest unpathable tile.
             *
@@ -69,12 +132,16 @@ namespace Overseer{
             struct TileInfo {
                 TileInfo();
                 bool            buildable:true;
+                bool            placeable:true;
+                bool            pathable:true;
                 size_t          groundHeight:2;
                 bool            doodad:true;
+                bool            ramp:true;
             };
             
             size_t m_regionId;
             float m_distNearestUnpathable;
+            float m_terrainHeight;
             TileInfo m_tileInfo;
     };
 }
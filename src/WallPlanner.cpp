@@ -0,0 +1,509 @@
+#include "WallPlanner.h"
+#include "Map.h"
+
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <stdexcept>
+
+namespace Overseer{
+
+    WallLayout::WallLayout():hasGap(false),sealed(false),openTiles(0) {}
+
+    /*
+    ****************************
+    *** Public members start ***
+    ****************************
+    */
+
+    WallPlanner::WallPlanner():p_map(nullptr) {}
+
+    WallPlanner::WallPlanner(Map* map):p_map(map) {}
+
+    void WallPlanner::setMap(Map* map) {
+        p_map = map;
+        Clear();
+    }
+
+    const WallLayout& WallPlanner::Plan(ChokePoint& chokePoint, std::vector<size_t> footprints, bool gap) {
+        //Footprints are shifted into 64 bit row masks
+        for(size_t size : footprints) {
+
+            if(size == 0 || size > constants::max_footprint) {
+
+                throw std::invalid_argument("footprint");
+            }
+        }
+
+        //Larger buildings first, so sealing layouts with few buildings are found early
+        std::sort(footprints.begin(), footprints.end(), std::greater<size_t>());
+
+        sc2::Point2D mid = chokePoint.getMidPoint();
+        CacheKey key(mid.x, mid.y, chokePoint.getRegions().first->getId(), chokePoint.getRegions().second->getId(), footprints, gap);
+        std::map<CacheKey, WallLayout>::iterator cached = m_cache.find(key);
+
+        if(cached != m_cache.end()) {
+
+            return cached->second;
+        }
+
+        Window window = BuildWindow(chokePoint);
+        Search search;
+        search.footprints = footprints;
+        search.occupied.fill(0);
+        search.hasGap = gap;
+        search.hasBest = false;
+        search.nodes = 0;
+        Expand(window, search, 0);
+
+        return m_cache[key] = search.best;
+    }
+
+    void WallPlanner::Clear() {
+        m_cache.clear();
+    }
+
+    /*
+    ***************************
+    *** Public members stop ***
+    ***************************
+
+    ***************************
+    ***************************
+    ***************************
+
+    *****************************
+    *** Priavte members start ***
+    *****************************
+    */
+
+    WallPlanner::Window WallPlanner::BuildWindow(ChokePoint& chokePoint) const {
+        Window window;
+        std::vector<sc2::Point2D> points = chokePoint.getPoints();
+        sc2::Point2D mid = chokePoint.getMidPoint();
+        int minX = mid.x, minY = mid.y, maxX = mid.x, maxY = mid.y;
+
+        for(const auto& point : points) {
+            minX = std::min(minX, (int) point.x);
+            minY = std::min(minY, (int) point.y);
+            maxX = std::max(maxX, (int) point.x);
+            maxY = std::max(maxY, (int) point.y);
+        }
+
+        //Clamp the window to the map and to the 64 tiles a row can hold, centered on the chokepoint if it is too wide
+        int mapWidth = p_map->getWidth();
+        int mapHeight = p_map->getHeight();
+        window.x0 = std::max(0, minX - window_margin);
+        window.y0 = std::max(0, minY - window_margin);
+        window.width = std::min(mapWidth, maxX + window_margin + 1) - window.x0;
+        window.height = std::min(mapHeight, maxY + window_margin + 1) - window.y0;
+
+        if(window.width > max_window) {
+            window.x0 = std::max(0, std::min(mapWidth - max_window, (int) mid.x - max_window / 2));
+            window.width = std::min(max_window, mapWidth);
+        }
+
+        if(window.height > max_window) {
+            window.y0 = std::max(0, std::min(mapHeight - max_window, (int) mid.y - max_window / 2));
+            window.height = std::min(max_window, mapHeight);
+        }
+
+        window.mid = sc2::Point2D(mid.x - window.x0, mid.y - window.y0);
+        window.placeable.fill(0);
+        window.pathable.fill(0);
+        window.sideA.fill(0);
+        window.sideB.fill(0);
+        window.choke.fill(0);
+
+        size_t regionA = chokePoint.getRegions().first->getId();
+        size_t regionB = chokePoint.getRegions().second->getId();
+        Grid regionTilesA = window.sideA;
+        Grid regionTilesB = window.sideB;
+
+        for(int y(0); y < window.height; ++y) {
+
+            for(int x(0); x < window.width; ++x) {
+                std::shared_ptr<Tile> tile = p_map->GetTile(sc2::Point2D(window.x0 + x, window.y0 + y));
+                uint64_t bit = uint64_t(1) << x;
+
+                //Tiles missing from the map can not be built on nor walked through
+                if(!tile) {
+                    continue;
+                }
+
+                if(tile->Placeable()) {
+                    window.placeable[y] |= bit;
+                }
+
+                if(tile->Pathable()) {
+                    window.pathable[y] |= bit;
+                }
+
+                if(tile->getRegionId() == regionA) {
+                    regionTilesA[y] |= bit;
+
+                } else if(tile->getRegionId() == regionB) {
+                    regionTilesB[y] |= bit;
+                }
+            }
+        }
+
+        for(const auto& point : points) {
+            int x = (int) point.x - window.x0;
+            int y = (int) point.y - window.y0;
+
+            if(0 <= x && x < window.width && 0 <= y && y < window.height) {
+                window.choke[y] |= uint64_t(1) << x;
+            }
+        }
+
+        //Buildings have to overlap the band around the chokepoint
+        window.band = window.choke;
+        for(int i(0); i < band_radius; ++i) {
+            window.band = Dilate(window, window.band);
+        }
+
+        window.bandMinX = window.width;
+        window.bandMinY = window.height;
+        window.bandMaxX = -1;
+        window.bandMaxY = -1;
+
+        for(int y(0); y < window.height; ++y) {
+
+            for(int x(0); x < window.width; ++x) {
+
+                if(window.band[y] & (uint64_t(1) << x)) {
+                    window.bandMinX = std::min(window.bandMinX, x);
+                    window.bandMinY = std::min(window.bandMinY, y);
+                    window.bandMaxX = std::max(window.bandMaxX, x);
+                    window.bandMaxY = std::max(window.bandMaxY, y);
+                }
+            }
+        }
+
+        //Both sides are seeded away from the band, so a wall anywhere in the band separates them
+        for(int y(0); y < window.height; ++y) {
+            window.sideA[y] = regionTilesA[y] & ~window.band[y];
+            window.sideB[y] = regionTilesB[y] & ~window.band[y];
+        }
+
+        if(!Count(window, window.sideA)) {
+            window.sideA = regionTilesA;
+        }
+
+        if(!Count(window, window.sideB)) {
+            window.sideB = regionTilesB;
+        }
+
+        return window;
+    }
+
+    void WallPlanner::Expand(const Window& window, Search& search, size_t depth) const {
+
+        if(++search.nodes > max_search_nodes) {
+            return;
+        }
+
+        if(Evaluate(window, search) || depth == search.footprints.size()) {
+            return;
+        }
+
+        //A sealing layout with as few buildings can not be improved by going deeper
+        if(search.best.sealed && search.best.placements.size() <= search.placements.size() + 1) {
+            return;
+        }
+
+        size_t size = search.footprints[depth];
+        bool sameAsPrevious = depth && search.footprints[depth - 1] == size;
+
+        for(const Candidate& candidate : Candidates(window, search.occupied, size)) {
+
+            //Buildings of the same size are placed in row order, so each set of positions is tried once
+            if(sameAsPrevious) {
+                const Candidate& previous = search.last.back();
+
+                if(candidate.y < previous.y || (candidate.y == previous.y && candidate.x <= previous.x)) {
+                    continue;
+                }
+            }
+
+            WallPlacement placement;
+            placement.position = sc2::Point2D(window.x0 + candidate.x + size / 2.0f, window.y0 + candidate.y + size / 2.0f);
+            placement.size = size;
+
+            Grid occupied = search.occupied;
+            Stamp(search.occupied, candidate.x, candidate.y, size);
+            search.placements.push_back(placement);
+            search.last.push_back(candidate);
+
+            Expand(window, search, depth + 1);
+
+            search.last.pop_back();
+            search.placements.pop_back();
+            search.occupied = occupied;
+
+            if(search.nodes > max_search_nodes) {
+                return;
+            }
+        }
+
+        //Leave out the remaining buildings of this size
+        size_t next = depth + 1;
+        while(next < search.footprints.size() && search.footprints[next] == size) {
+            ++next;
+        }
+
+        if(next < search.footprints.size()) {
+            Expand(window, search, next);
+        }
+    }
+
+    bool WallPlanner::Evaluate(const Window& window, Search& search) const {
+        uint64_t rowMask = RowMask(window);
+        Grid free;
+        free.fill(0);
+
+        for(int y(0); y < window.height; ++y) {
+            free[y] = window.pathable[y] & ~search.occupied[y];
+        }
+
+        Grid reachA = Flood(window, free, window.sideA);
+        bool sealed = !Intersects(window, reachA, window.sideB);
+        bool hasGap = false;
+        Candidate gap = Candidate();
+        size_t openTiles = 0;
+
+        if(sealed && search.hasGap) {
+            //A full seal is not what was asked for, and adding buildings will not open a gap
+            return true;
+        }
+
+        if(!sealed) {
+            Grid reachB = Flood(window, free, window.sideB);
+            Grid open;
+
+            for(int y(0); y < window.height; ++y) {
+                open[y] = reachA[y] & reachB[y];
+            }
+
+            if(search.hasGap) {
+                //A gap is an open tile squeezed between blocked tiles, left and right or above and below,
+                //whose closing seals the wall
+                for(int y(0); y < window.height && !hasGap; ++y) {
+                    uint64_t blocked = ~free[y] & rowMask;
+                    uint64_t above = y > 0 ? ~free[y - 1] : ~uint64_t(0);
+                    uint64_t below = y + 1 < window.height ? ~free[y + 1] : ~uint64_t(0);
+                    uint64_t sides = ((blocked << 1) | 1) & ((blocked >> 1) | (uint64_t(1) << (window.width - 1)));
+                    uint64_t pinch = open[y] & window.band[y] & (sides | (above & below));
+
+                    for(int x(0); pinch && x < window.width; ++x, pinch >>= 1) {
+
+                        if(pinch & 1) {
+                            free[y] &= ~(uint64_t(1) << x);
+
+                            if(!Intersects(window, Flood(window, free, window.sideA), window.sideB)) {
+                                hasGap = true;
+                                gap.x = x;
+                                gap.y = y;
+                                break;
+                            }
+                            free[y] |= uint64_t(1) << x;
+                        }
+                    }
+                }
+            }
+
+            for(int y(0); y < window.height; ++y) {
+                open[y] &= window.choke[y];
+            }
+            openTiles = hasGap ? 0 : Count(window, open);
+        }
+        sealed = sealed || hasGap;
+
+        const WallLayout& best = search.best;
+        bool better = !search.hasBest ||
+            (sealed && !best.sealed) ||
+            (sealed == best.sealed && (openTiles < best.openTiles ||
+                                       (openTiles == best.openTiles && search.placements.size() < best.placements.size())));
+
+        if(better) {
+            search.best.placements = search.placements;
+            search.best.hasGap = hasGap;
+            search.best.gap = hasGap ? sc2::Point2D(window.x0 + gap.x, window.y0 + gap.y) : sc2::Point2D();
+            search.best.sealed = sealed;
+            search.best.openTiles = openTiles;
+            search.hasBest = true;
+        }
+
+        return sealed;
+    }
+
+    std::vector<WallPlanner::Candidate> WallPlanner::Candidates(const Window& window, const Grid& occupied, size_t size) const {
+        std::vector<Candidate> candidates;
+        int span = size;
+
+        for(int y = std::max(0, window.bandMinY - span + 1); y <= std::min(window.height - span, window.bandMaxY); ++y) {
+
+            for(int x = std::max(0, window.bandMinX - span + 1); x <= std::min(window.width - span, window.bandMaxX); ++x) {
+                Grid footprint;
+                footprint.fill(0);
+                Stamp(footprint, x, y, size);
+
+                if(Intersects(window, footprint, window.band) && Fits(window, occupied, x, y, size) && Touches(window, occupied, x, y, size)) {
+                    Candidate candidate;
+                    candidate.x = x;
+                    candidate.y = y;
+                    candidate.distance = sc2::Distance2D(sc2::Point2D(x + size / 2.0f, y + size / 2.0f), window.mid);
+                    candidates.push_back(candidate);
+                }
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b){ return a.distance < b.distance; });
+
+        if(candidates.size() > max_candidates) {
+            candidates.resize(max_candidates);
+        }
+
+        return candidates;
+    }
+
+    bool WallPlanner::Fits(const Window& window, const Grid& occupied, int x, int y, size_t size) {
+        uint64_t mask = ((uint64_t(1) << size) - 1) << x;
+
+        for(int row = y; row < y + (int) size; ++row) {
+
+            if((window.placeable[row] & mask) != mask || (occupied[row] & mask)) {
+
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool WallPlanner::Touches(const Window& window, const Grid& occupied, int x, int y, size_t size) {
+        //The ring around the footprint, corners included since diagonal contact blocks ground units
+        uint64_t ring = (uint64_t(1) << (size + 2)) - 1;
+        ring = (x > 0 ? ring << (x - 1) : ring >> 1) & RowMask(window);
+
+        for(int row = std::max(0, y - 1); row <= std::min(window.height - 1, y + (int) size); ++row) {
+
+            if(ring & (~window.pathable[row] | occupied[row])) {
+
+                return true;
+            }
+        }
+
+        //The border of the window is treated as a wall
+        return x == 0 || y == 0 || x + (int) size == window.width || y + (int) size == window.height;
+    }
+
+    void WallPlanner::Stamp(Grid& grid, int x, int y, size_t size) {
+        uint64_t mask = ((uint64_t(1) << size) - 1) << x;
+
+        for(int row = y; row < y + (int) size; ++row) {
+            grid[row] |= mask;
+        }
+    }
+
+    WallPlanner::Grid WallPlanner::Flood(const Window& window, const Grid& free, const Grid& from) {
+        uint64_t rowMask = RowMask(window);
+        Grid reach;
+
+        for(int y(0); y < window.height; ++y) {
+            reach[y] = from[y] & free[y];
+        }
+
+        //Alternate downward and upward sweeps, each row spreading sideways within a sweep
+        bool changed = true;
+        while(changed) {
+            changed = false;
+
+            for(int pass(0); pass < 2; ++pass) {
+
+                for(int i(0); i < window.height; ++i) {
+                    int y = pass ? window.height - 1 - i : i;
+                    uint64_t row = reach[y];
+
+                    if(y > 0) {
+                        row |= reach[y - 1];
+                    }
+
+                    if(y + 1 < window.height) {
+                        row |= reach[y + 1];
+                    }
+                    row &= free[y];
+
+                    uint64_t spread;
+                    do {
+                        spread = row;
+                        row = (row | (row << 1) | (row >> 1)) & free[y] & rowMask;
+                    } while(row != spread);
+
+                    if(row != reach[y]) {
+                        reach[y] = row;
+                        changed = true;
+                    }
+                }
+            }
+        }
+
+        return reach;
+    }
+
+    WallPlanner::Grid WallPlanner::Dilate(const Window& window, const Grid& grid) {
+        uint64_t rowMask = RowMask(window);
+        Grid dilated;
+        dilated.fill(0);
+
+        for(int y(0); y < window.height; ++y) {
+            uint64_t row = grid[y] | (grid[y] << 1) | (grid[y] >> 1);
+            dilated[y] |= row & rowMask;
+
+            if(y > 0) {
+                dilated[y - 1] |= row & rowMask;
+            }
+
+            if(y + 1 < window.height) {
+                dilated[y + 1] |= row & rowMask;
+            }
+        }
+
+        return dilated;
+    }
+
+    bool WallPlanner::Intersects(const Window& window, const Grid& a, const Grid& b) {
+
+        for(int y(0); y < window.height; ++y) {
+
+            if(a[y] & b[y]) {
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    uint64_t WallPlanner::RowMask(const Window& window) {
+
+        return window.width >= 64 ? ~uint64_t(0) : (uint64_t(1) << window.width) - 1;
+    }
+
+    size_t WallPlanner::Count(const Window& window, const Grid& grid) {
+        size_t count = 0;
+
+        for(int y(0); y < window.height; ++y) {
+            count += std::bitset<64>(grid[y]).count();
+        }
+
+        return count;
+    }
+
+    /*
+    ****************************
+    *** Priavte members stop ***
+    ****************************
+    */
+}
@@ -0,0 +1,154 @@
+#ifndef _OVERSEER_WALLPLANNER_H_
+#define _OVERSEER_WALLPLANNER_H_
+
+#include "ChokePoint.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace Overseer{
+
+    class Map;
+
+    /**
+    * \struct WallPlacement WallPlanner.h "WallPlanner.h"
+    * \brief A single building in a wall layout.
+    */
+    struct WallPlacement {
+        sc2::Point2D position;  //!< Build position, as expected by the build ability (footprint center).
+        size_t size;            //!< Side of the footprint in tiles (2, 3 or 5).
+    };
+
+    /**
+    * \struct WallLayout WallPlanner.h "WallPlanner.h"
+    * \brief The result of a wall search at a chokepoint.
+    */
+    struct WallLayout {
+        WallLayout();
+
+        std::vector<WallPlacement> placements;  //!< Buildings to place, in search order.
+        sc2::Point2D gap;                       //!< Position of the one tile gap, when hasGap is set.
+        bool hasGap;                            //!< True if the layout leaves a one tile gap.
+        bool sealed;                            //!< True if the layout fully seals the chokepoint (except the gap).
+        size_t openTiles;                       //!< Number of chokepoint tiles still open to walking units.
+    };
+
+    /**
+    * \class WallPlanner WallPlanner.h "WallPlanner.h"
+    * \brief Finds building layouts that seal, or partially seal, a chokepoint.
+    *
+    * The search runs on a window of at most 64x64 tiles around the chokepoint, where each row of the
+    * placement and pathing grids is held in a single 64 bit word. Footprints are tried closest to the
+    * chokepoint first, must touch an unpathable tile or an earlier building, and the search is stopped
+    * after a fixed number of nodes, so a plan costs a few milliseconds at most. Results are cached per
+    * chokepoint and request.
+    */
+    class WallPlanner {
+        public:
+
+            /**
+            * \brief empty constructor
+            */
+            WallPlanner();
+
+            /**
+            * \brief constructor.
+            *
+            * \param map The map to plan walls on.
+            */
+            WallPlanner(Map* map);
+
+            /**
+            * \brief set the map to plan walls on, clears the cache.
+            *
+            * \param map is a pointer to the map.
+            */
+            void setMap(Map* map);
+
+            /**
+            * \brief Find a layout that seals the chokepoint with the given buildings.
+            *
+            * Not all buildings have to be used, the layout using the fewest buildings is preferred. When no
+            * sealing layout exists the layout leaving the fewest open chokepoint tiles is returned.
+            *
+            * \param chokePoint The chokepoint to wall.
+            * \param footprints Sizes of the buildings available for the wall, each one of 2, 3 or 5.
+            * \param gap If true, leave a one tile gap in the wall.
+            * \return The best layout found.
+            * \throw std::invalid_argument If a footprint is 0 or larger than constants::max_footprint.
+            */
+            const WallLayout& Plan(ChokePoint& chokePoint, std::vector<size_t> footprints, bool gap = false);
+
+            /**
+            * \brief Drop all cached layouts.
+            */
+            void Clear();
+
+        private:
+            typedef std::array<uint64_t, 64> Grid;
+            typedef std::tuple<int, int, size_t, size_t, std::vector<size_t>, bool> CacheKey;
+
+            struct Window {
+                int x0;
+                int y0;
+                int width;
+                int height;
+                sc2::Point2D mid;
+                Grid placeable;
+                Grid pathable;
+                Grid sideA;
+                Grid sideB;
+                Grid choke;
+                Grid band;
+                int bandMinX;
+                int bandMinY;
+                int bandMaxX;
+                int bandMaxY;
+            };
+
+            struct Candidate {
+                int x;
+                int y;
+                float distance;
+            };
+
+            struct Search {
+                std::vector<size_t> footprints;
+                std::vector<WallPlacement> placements;
+                std::vector<Candidate> last;
+                Grid occupied;
+                bool hasGap;
+                WallLayout best;
+                bool hasBest;
+                size_t nodes;
+            };
+
+            Window BuildWindow(ChokePoint& chokePoint) const;
+            void Expand(const Window& window, Search& search, size_t depth) const;
+            bool Evaluate(const Window& window, Search& search) const;
+            std::vector<Candidate> Candidates(const Window& window, const Grid& occupied, size_t size) const;
+
+            static bool Fits(const Window& window, const Grid& occupied, int x, int y, size_t size);
+            static bool Touches(const Window& window, const Grid& occupied, int x, int y, size_t size);
+            static void Stamp(Grid& grid, int x, int y, size_t size);
+            static Grid Flood(const Window& window, const Grid& free, const Grid& from);
+            static Grid Dilate(const Window& window, const Grid& grid);
+            static bool Intersects(const Window& window, const Grid& a, const Grid& b);
+            static uint64_t RowMask(const Window& window);
+            static size_t Count(const Window& window, const Grid& grid);
+
+            Map *p_map;
+            std::map<CacheKey, WallLayout> m_cache;
+
+            static const int max_window = 64;
+            static const int window_margin = 8;
+            static const int band_radius = 4;
+            static const size_t max_candidates = 24;
+            static const size_t max_search_nodes = 4000;
+    };
+}
+
+#endif /* _OVERSEER_WALLPLANNER_H_ */
@@ -0,0 +1,320 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   arena_allocator.hpp
+ *  Contains the definition of the \ref spatial::arena_allocator, an allocator
+ *  that carves the nodes of a container out of large slabs of memory.
+ */
+
+#ifndef SPATIAL_ARENA_ALLOCATOR_HPP
+#define SPATIAL_ARENA_ALLOCATOR_HPP
+
+#include <new>     // ::operator new, ::operator delete, placement new
+#include <cstddef> // offsetof
+#include <limits>  // std::numeric_limits
+#include "spatial.hpp"
+#include "bits/spatial_import_thread.hpp"
+#ifdef SPATIAL_THREAD
+#  include <atomic>
+#endif
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  The strictest alignment required by a fundamental type.
+     */
+    union arena_max_align
+    {
+      long double ld;
+#if __cplusplus >= 201103L
+      long long ll; // not a C++03 type
+#endif
+      double d;
+      void* p;
+      void (*f)();
+    };
+
+    struct arena_align_probe
+    {
+      char c;
+      arena_max_align a;
+    };
+
+    /**
+     *  Rounds \c bytes up to the alignment of \ref arena_max_align.
+     */
+    inline std::size_t
+    arena_round(std::size_t bytes)
+    {
+      const std::size_t align = offsetof(arena_align_probe, a);
+      return (bytes + align - 1) / align * align;
+    }
+
+    /**
+     *  The type of the count of the allocators sharing an arena. Allocators
+     *  may be copied on several threads, so the count is atomic whenever
+     *  threads are available.
+     */
+#ifdef SPATIAL_THREAD
+    typedef std::atomic<std::size_t> Arena_count;
+#else
+    typedef std::size_t Arena_count;
+#endif
+
+    /**
+     *  A list of slabs from which fixed-size blocks are carved out.
+     *
+     *  Blocks are handed out by bumping a cursor through the current slab.
+     *  Freed blocks of the size of the first block ever allocated are kept on
+     *  a free list and reused first; in a container this size is the size of
+     *  a node. Blocks of other sizes are only reclaimed when the whole arena
+     *  is released. Requests larger than a slab are forwarded to operator new.
+     *
+     *  The arena is shared by all the copies of an \ref arena_allocator and
+     *  destroyed with the last of them. Only its count of allocators is
+     *  thread safe: allocating and freeing blocks is not.
+     */
+    class Arena
+    {
+    public:
+      explicit Arena(std::size_t slab_size)
+        : refs(1), _slab_size(arena_round(slab_size)), _first(0),
+          _current(0), _cursor(0), _end(0), _free(0), _block(0) { }
+
+      ~Arena() { release(); }
+
+      void*
+      allocate(std::size_t bytes)
+      {
+        bytes = arena_round(bytes);
+        if (_block == 0) { _block = bytes; }
+        if (bytes == _block && _free != 0)
+          {
+            Free* block = _free;
+            _free = block->next;
+            return block;
+          }
+        if (bytes > _slab_size) { return ::operator new(bytes); }
+        if (static_cast<std::size_t>(_end - _cursor) < bytes)
+          { next_slab(); } // may throw
+        void* block = _cursor;
+        _cursor += bytes;
+        return block;
+      }
+
+      void
+      deallocate(void* block, std::size_t bytes)
+      {
+        bytes = arena_round(bytes);
+        if (bytes > _slab_size) { ::operator delete(block); }
+        else if (bytes == _block)
+          {
+            Free* node = static_cast<Free*>(block);
+            node->next = _free;
+            _free = node;
+          }
+      }
+
+      /**
+       *  Forgets every block handed out and rewinds to the first slab. The
+       *  slabs are kept for the blocks allocated next.
+       */
+      void
+      reset()
+      {
+        _free = 0;
+        _current = _first;
+        if (_current != 0)
+          {
+            _cursor = data(_current);
+            _end = _cursor + _slab_size;
+          }
+        else { _cursor = _end = 0; }
+      }
+
+      /**
+       *  Gives all slabs back to the system at once.
+       */
+      void
+      release()
+      {
+        while (_first != 0)
+          {
+            Slab* next = _first->next;
+            ::operator delete(_first);
+            _first = next;
+          }
+        _current = 0;
+        _cursor = _end = 0;
+        _free = 0;
+      }
+
+      std::size_t slab_size() const { return _slab_size; }
+
+      Arena_count refs;
+
+    private:
+      struct Slab { Slab* next; };
+      struct Free { Free* next; };
+
+      char*
+      data(Slab* slab) const
+      { return reinterpret_cast<char*>(slab) + arena_round(sizeof(Slab)); }
+
+      void
+      next_slab()
+      {
+        if (_current != 0 && _current->next != 0)
+          { _current = _current->next; }
+        else
+          {
+            Slab* slab = static_cast<Slab*>
+              (::operator new(arena_round(sizeof(Slab)) + _slab_size));
+            slab->next = 0;
+            if (_current != 0) { _current->next = slab; }
+            else { _first = slab; }
+            _current = slab;
+          }
+        _cursor = data(_current);
+        _end = _cursor + _slab_size;
+      }
+
+      Arena(const Arena&);
+      Arena& operator=(const Arena&);
+
+      std::size_t _slab_size;
+      Slab* _first;
+      Slab* _current;
+      char* _cursor;
+      char* _end;
+      Free* _free;
+      std::size_t _block;
+    };
+  } // namespace details
+
+  /**
+   *  An allocator that draws single objects out of large slabs of memory, for
+   *  use as the \c Alloc argument of the containers of the library, such as
+   *  \point_multimap, \box_multimap or \idle_point_multimap.
+   *
+   *  Containers allocate a node per element. Using this allocator, nodes are
+   *  laid out next to each other, in slabs of \c SlabSize bytes, and a node
+   *  freed by \c erase() is reused by the next insertion. Destroying the
+   *  container gives all slabs back in one go, instead of one call to
+   *  operator delete per node.
+   *
+   *  Every default constructed allocator owns a new arena, so each container
+   *  gets its own. Copies of an allocator, including rebound copies, share
+   *  the arena of the original and compare equal. Copies may be made and
+   *  destroyed on different threads, but allocating and freeing from the
+   *  same arena on several threads at once is not safe.
+   *
+   *  \tparam T The type of the objects to allocate.
+   *  \tparam SlabSize The size in bytes of each slab of memory.
+   */
+  template<typename T, std::size_t SlabSize = 65536>
+  class arena_allocator
+  {
+    template<typename U, std::size_t S> friend class arena_allocator;
+
+  public:
+    typedef T                 value_type;
+    typedef T*                pointer;
+    typedef const T*          const_pointer;
+    typedef T&                reference;
+    typedef const T&          const_reference;
+    typedef std::size_t       size_type;
+    typedef std::ptrdiff_t    difference_type;
+
+    template<typename U>
+    struct rebind { typedef arena_allocator<U, SlabSize> other; };
+
+    arena_allocator() : _arena(new details::Arena(SlabSize)) { }
+
+    arena_allocator(const arena_allocator& other) : _arena(other._arena)
+    { ++_arena->refs; }
+
+    template<typename U>
+    arena_allocator(const arena_allocator<U, SlabSize>& other)
+      : _arena(other._arena)
+    { ++_arena->refs; }
+
+    arena_allocator&
+    operator=(const arena_allocator& other)
+    {
+      ++other._arena->refs;
+      drop();
+      _arena = other._arena;
+      return *this;
+    }
+
+    ~arena_allocator() { drop(); }
+
+    pointer address(reference x) const { return &x; }
+
+    const_pointer address(const_reference x) const { return &x; }
+
+    pointer
+    allocate(size_type n, const void* = 0)
+    {
+      if (n > max_size()) { throw std::bad_alloc(); }
+      return static_cast<pointer>(_arena->allocate(n * sizeof(T)));
+    }
+
+    void
+    deallocate(pointer p, size_type n)
+    { _arena->deallocate(p, n * sizeof(T)); }
+
+    size_type
+    max_size() const
+    { return std::numeric_limits<size_type>::max() / sizeof(T); }
+
+    void
+    construct(pointer p, const T& value)
+    { ::new(static_cast<void*>(p)) T(value); }
+
+    void
+    destroy(pointer p)
+    { p->~T(); }
+
+    /**
+     *  Rewinds the arena to its first slab, keeping all slabs for reuse.
+     *
+     *  Only call this once every object allocated from the arena has been
+     *  destroyed, for instance after \c clear() on the container that holds
+     *  the allocator, when the container is going to be refilled.
+     */
+    void
+    reset()
+    { _arena->reset(); }
+
+    /**
+     *  Returns true if \c other shares the arena of this allocator.
+     */
+    template<typename U>
+    bool
+    operator==(const arena_allocator<U, SlabSize>& other) const
+    { return _arena == other._arena; }
+
+    template<typename U>
+    bool
+    operator!=(const arena_allocator<U, SlabSize>& other) const
+    { return _arena != other._arena; }
+
+  private:
+    void
+    drop()
+    { if (--_arena->refs == 0) { delete _arena; } }
+
+    details::Arena* _arena;
+  };
+}
+
+#endif // SPATIAL_ARENA_ALLOCATOR_HPP
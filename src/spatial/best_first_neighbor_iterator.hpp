@@ -0,0 +1,20 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   best_first_neighbor_iterator.hpp
+ *  Provides the best-first neighbor iterator and all the functions around
+ *  it.
+ */
+
+#ifndef SPATIAL_BEST_FIRST_NEIGHBOR_ITERATOR_HPP
+#define SPATIAL_BEST_FIRST_NEIGHBOR_ITERATOR_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_best_first_neighbor.hpp"
+
+#endif // SPATIAL_BEST_FIRST_NEIGHBOR_ITERATOR_HPP
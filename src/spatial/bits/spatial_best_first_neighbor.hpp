@@ -0,0 +1,631 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_best_first_neighbor.hpp
+ *  Provides the best-first neighbor iterator and all the functions around
+ *  it.
+ */
+
+#ifndef SPATIAL_BEST_FIRST_NEIGHBOR_HPP
+#define SPATIAL_BEST_FIRST_NEIGHBOR_HPP
+
+#include <algorithm> // std::push_heap, std::pop_heap
+#include <iterator>  // std::forward_iterator_tag
+#include <vector>
+
+#include "spatial_import_tuple.hpp"
+#include "../metric.hpp"
+#include "../traits.hpp"
+#include "spatial_bidirectional.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  An entry in the queue of a \ref best_first_neighbor_iterator. It
+     *  stands either for the node alone, with its exact distance to the
+     *  target, or for the whole sub-tree under the node, with a lower bound
+     *  of the distance of all its nodes to the target.
+     */
+    template <typename NodePtr, typename Distance>
+    struct Best_first_entry
+    {
+      Best_first_entry() { }
+
+      Best_first_entry(NodePtr node_, dimension_type dim_,
+                       Distance distance_, bool subtree_)
+        : node(node_), dim(dim_), distance(distance_), subtree(subtree_) { }
+
+      NodePtr node;
+      dimension_type dim;
+      Distance distance;
+      bool subtree;
+    };
+
+    /**
+     *  Orders the entries of the queue so that the closest one is on top of
+     *  the heap. Between a node and a sub-tree at the same distance, the node
+     *  comes first, since it can be returned without further work.
+     */
+    struct Best_first_further
+    {
+      template <typename NodePtr, typename Distance>
+      bool
+      operator()(const Best_first_entry<NodePtr, Distance>& x,
+                 const Best_first_entry<NodePtr, Distance>& y) const
+      {
+        return y.distance < x.distance
+          || (!(x.distance < y.distance) && x.subtree && !y.subtree);
+      }
+    };
+
+    /**
+     *  The state of a \ref best_first_neighbor_iterator: the target, the
+     *  distance to the current node and the queue of nodes and sub-trees that
+     *  remain to be visited.
+     *
+     *  \tparam Ct The container to which these iterator relate to.
+     *  \tparam Metric The type of \metric applied to the iterator.
+     *  \tparam NodePtr The type of node pointer walked by the iterator.
+     */
+    template<typename Ct, typename Metric, typename NodePtr>
+    struct Best_first_data : container_traits<Ct>::key_compare
+    {
+      typedef Best_first_entry<NodePtr, typename Metric::distance_type>
+      entry_type;
+
+      //! Build an unintialized data object.
+      Best_first_data() { }
+
+      Best_first_data
+      (const typename container_traits<Ct>::key_compare& key_comp,
+       const Metric& metric,
+       const typename container_traits<Ct>::key_type& key,
+       NodePtr end)
+        : container_traits<Ct>::key_compare(key_comp), _target(metric, key),
+          _distance(), _end(end) { }
+
+      //! The target of the iteration.
+      Compress<Metric, typename container_traits<Ct>::key_type> _target;
+
+      //! The distance of the current node to the target.
+      typename Metric::distance_type _distance;
+
+      //! The past-the-end node of the container.
+      NodePtr _end;
+
+      /**
+       *  The heap of nodes and sub-trees left to visit. Its storage is kept
+       *  when the iterator is reset on a new target.
+       */
+      std::vector<entry_type> _heap;
+    };
+
+    /**
+     *  Moves \c node to the next closest node to the target of \c data, or
+     *  to the end of the container when all nodes have been visited.
+     *
+     *  The sub-tree on top of the queue is expanded by walking down the side
+     *  of each node that contains the target, since it is never further than
+     *  the sub-tree itself, while the node and its other side are queued.
+     */
+    template <typename NodePtr, typename Rank, typename Ct, typename Metric>
+    inline void
+    best_first_increment(NodePtr& node, dimension_type& node_dim,
+                         const Rank& rank,
+                         Best_first_data<Ct, Metric, NodePtr>& data)
+    {
+      typedef typename Best_first_data<Ct, Metric, NodePtr>::entry_type
+        entry_type;
+      const typename container_traits<Ct>::key_compare& key_comp = data;
+      const Metric& met = data._target.base();
+      const typename container_traits<Ct>::key_type& target = data._target();
+      while (!data._heap.empty())
+        {
+          std::pop_heap(data._heap.begin(), data._heap.end(),
+                        Best_first_further());
+          entry_type top = data._heap.back();
+          data._heap.pop_back();
+          if (!top.subtree)
+            {
+              node = top.node;
+              node_dim = top.dim;
+              data._distance = top.distance;
+              return;
+            }
+          SPATIAL_STATS_COUNT(backtracks);
+          for (NodePtr x = top.node; x != 0;)
+            {
+              dimension_type dim = top.dim;
+              SPATIAL_STATS_COUNT(nodes_visited);
+              SPATIAL_STATS_COUNT(distance_evaluations);
+              data._heap.push_back
+                (entry_type(x, dim, met.distance_to_key
+                            (rank(), target, const_key(x)), false));
+              std::push_heap(data._heap.begin(), data._heap.end(),
+                             Best_first_further());
+              NodePtr near, far;
+              import::tie(near, far) = key_comp(dim, const_key(x), target)
+                ? import::make_tuple(x->right, x->left)
+                : import::make_tuple(x->left, x->right);
+              top.dim = incr_dim(rank, dim);
+              if (far != 0)
+                {
+                  typename Metric::distance_type bound
+                    = met.distance_to_plane(rank(), dim, target,
+                                            const_key(x));
+                  data._heap.push_back
+                    (entry_type(far, top.dim, bound < top.distance
+                                ? top.distance : bound, true));
+                  std::push_heap(data._heap.begin(), data._heap.end(),
+                                 Best_first_further());
+                }
+              x = near;
+            }
+        }
+      node = data._end;
+      node_dim = decr_dim(rank, 0);
+    }
+
+    /**
+     *  Empties the queue of \c data and seeds it with the whole tree under \c
+     *  root, then moves \c node to the closest node to the target.
+     */
+    template <typename NodePtr, typename Rank, typename Ct, typename Metric>
+    inline void
+    best_first_first(NodePtr& node, dimension_type& node_dim,
+                     const Rank& rank, NodePtr root,
+                     Best_first_data<Ct, Metric, NodePtr>& data)
+    {
+      typedef typename Best_first_data<Ct, Metric, NodePtr>::entry_type
+        entry_type;
+      data._heap.clear();
+      if (root != data._end)
+        {
+          data._heap.push_back
+            (entry_type(root, 0, typename Metric::distance_type(), true));
+        }
+      best_first_increment(node, node_dim, rank, data);
+    }
+  } // namespace details
+
+  /**
+   *  A spatial iterator for a container \c Ct that goes through the nearest
+   *  to the furthest element from a target key, like \ref neighbor_iterator,
+   *  but which keeps a priority queue of the parts of the tree left to visit.
+   *
+   *  A \ref neighbor_iterator holds no state besides its current node, and
+   *  searches the tree again for each increment. This iterator instead pops
+   *  the next closest node out of its queue, so that visiting the \c k
+   *  nearest elements costs about as much as finding the first of them plus
+   *  \c k operations on a small heap. Use it when walking through many
+   *  neighbors in a row, for instance until an element meeting a condition
+   *  is found.
+   *
+   *  In exchange, this iterator can only move forward and owns its queue:
+   *  copying it copies the queue, so prefer the prefix increment. Call
+   *  reset() to restart the iteration from a new target without releasing
+   *  the storage of the queue.
+   *
+   *  \tparam Ct The container type bound to the iterator.
+   *  \tparam Metric An type that is a model of \metric.
+   */
+  template <typename Ct, typename Metric =
+            euclidian<typename details::mutate<Ct>::type,
+                      double,
+                      typename details::with_builtin_difference<Ct>::type> >
+  class best_first_neighbor_iterator
+    : public details::Bidirectional_iterator
+  <typename container_traits<Ct>::mode_type,
+   typename container_traits<Ct>::rank_type>
+  {
+  private:
+    typedef typename details::Bidirectional_iterator
+    <typename container_traits<Ct>::mode_type,
+     typename container_traits<Ct>::rank_type> Base;
+
+  public:
+    using Base::node;
+    using Base::node_dim;
+    using Base::rank;
+
+    //! This iterator only moves forward.
+    typedef std::forward_iterator_tag iterator_category;
+
+    //! Key comparator type transferred from the container
+    typedef typename container_traits<Ct>::key_compare key_compare;
+
+    //! The metric type used by the iterator
+    typedef Metric metric_type;
+
+    //! The distance type that is read from metric_type
+    typedef typename Metric::distance_type distance_type;
+
+    //! The key type that is used as a target for the nearest neighbor search
+    typedef typename container_traits<Ct>::key_type key_type;
+
+    //! Uninitialized iterator.
+    best_first_neighbor_iterator() { }
+
+    /**
+     *  Build an iterator past-the-end of \c container_.
+     *
+     *  \param container_ The container to iterate.
+     *  \param metric_ The \metric applied during the iteration.
+     *  \param target_ The target of the neighbor iteration.
+     */
+    best_first_neighbor_iterator
+    (Ct& container_, const Metric& metric_,
+     const typename container_traits<Ct>::key_type& target_)
+      : Base(container_.rank(), container_.end().node,
+             container_.dimension() - 1),
+        _data(container_.key_comp(), metric_, target_,
+              container_.end().node) { }
+
+    /**
+     *  Restart the iteration on the nearest element to \c target_ in \c
+     *  container_. The queue of the iterator keeps its storage.
+     */
+    void
+    reset(Ct& container_,
+          const typename container_traits<Ct>::key_type& target_)
+    {
+      SPATIAL_ASSERT_CHECK(_data._end == container_.end().node);
+      target_key() = target_;
+      typename Base::node_ptr root = container_.end().node->parent;
+      details::best_first_first(node, node_dim, rank(), root, _data);
+    }
+
+    //! Increments the iterator and returns the incremented value. Prefer to
+    //! use this form in \c for loops.
+    best_first_neighbor_iterator<Ct, Metric>& operator++()
+    {
+      details::best_first_increment(node, node_dim, rank(), _data);
+      return *this;
+    }
+
+    //! Increments the iterator but returns the value of the iterator before
+    //! the increment, along with a copy of its queue. Prefer to use the other
+    //! form in \c for loops.
+    best_first_neighbor_iterator<Ct, Metric> operator++(int)
+    {
+      best_first_neighbor_iterator<Ct, Metric> x(*this);
+      details::best_first_increment(node, node_dim, rank(), _data);
+      return x;
+    }
+
+    //! Return the key_comparator used by the iterator
+    key_compare
+    key_comp() const { return static_cast<const key_compare&>(_data); }
+
+    //! Return the metric used by the iterator
+    metric_type
+    metric() const { return _data._target.base(); }
+
+    //! Read-only accessor to the last valid distance of the iterator
+    const distance_type&
+    distance() const { return _data._distance; }
+
+    //! Read-only accessor to the target of the iterator
+    const key_type&
+    target_key() const { return _data._target(); }
+
+  private:
+    //! Read/write accessor to the target of the iterator
+    key_type&
+    target_key() { return _data._target(); }
+
+    //! The related data for the iterator.
+    details::Best_first_data<Ct, Metric, typename Base::node_ptr> _data;
+  };
+
+  /**
+   *  A spatial iterator for a container \c Ct that goes through the nearest
+   *  to the furthest element from a target key, keeping a priority queue of
+   *  the parts of the tree left to visit.
+   *
+   *  This iterator only returns constant objects.
+   *
+   *  \tparam Ct The container type bound to the iterator.
+   *  \tparam Metric An type that follow the \metric concept.
+   *  \see best_first_neighbor_iterator
+   */
+  template<typename Ct, typename Metric>
+  class best_first_neighbor_iterator<const Ct, Metric>
+    : public details::Const_bidirectional_iterator
+      <typename container_traits<Ct>::mode_type,
+       typename container_traits<Ct>::rank_type>
+  {
+  private:
+    typedef typename details::Const_bidirectional_iterator
+    <typename container_traits<Ct>::mode_type,
+     typename container_traits<Ct>::rank_type> Base;
+
+  public:
+    using Base::node;
+    using Base::node_dim;
+    using Base::rank;
+
+    //! This iterator only moves forward.
+    typedef std::forward_iterator_tag iterator_category;
+
+    //! Key comparator type transferred from the container
+    typedef typename container_traits<Ct>::key_compare key_compare;
+
+    //! The metric type used by the iterator
+    typedef Metric metric_type;
+
+    //! The distance type that is read from metric_type
+    typedef typename Metric::distance_type distance_type;
+
+    //! The key type that is used as a target for the nearest neighbor search
+    typedef typename container_traits<Ct>::key_type key_type;
+
+    //! \empty
+    best_first_neighbor_iterator() { }
+
+    /**
+     *  Build an iterator past-the-end of \c container_.
+     *
+     *  \param container_ The container to iterate.
+     *  \param metric_ The \metric applied during the iteration.
+     *  \param target_ The target of the neighbor iteration.
+     */
+    best_first_neighbor_iterator
+    (const Ct& container_, const Metric& metric_,
+     const typename container_traits<Ct>::key_type& target_)
+      : Base(container_.rank(), container_.end().node,
+             container_.dimension() - 1),
+        _data(container_.key_comp(), metric_, target_,
+              container_.end().node) { }
+
+    /**
+     *  Restart the iteration on the nearest element to \c target_ in \c
+     *  container_. The queue of the iterator keeps its storage.
+     */
+    void
+    reset(const Ct& container_,
+          const typename container_traits<Ct>::key_type& target_)
+    {
+      SPATIAL_ASSERT_CHECK(_data._end == container_.end().node);
+      target_key() = target_;
+      typename Base::node_ptr root = container_.end().node->parent;
+      details::best_first_first(node, node_dim, rank(), root, _data);
+    }
+
+    //! Increments the iterator and returns the incremented value. Prefer to
+    //! use this form in \c for loops.
+    best_first_neighbor_iterator<const Ct, Metric>& operator++()
+    {
+      details::best_first_increment(node, node_dim, rank(), _data);
+      return *this;
+    }
+
+    //! Increments the iterator but returns the value of the iterator before
+    //! the increment, along with a copy of its queue. Prefer to use the other
+    //! form in \c for loops.
+    best_first_neighbor_iterator<const Ct, Metric> operator++(int)
+    {
+      best_first_neighbor_iterator<const Ct, Metric> x(*this);
+      details::best_first_increment(node, node_dim, rank(), _data);
+      return x;
+    }
+
+    //! Return the key_comparator used by the iterator
+    key_compare
+    key_comp() const { return static_cast<const key_compare&>(_data); }
+
+    //! Return the metric used by the iterator
+    metric_type
+    metric() const { return _data._target.base(); }
+
+    //! Read-only accessor to the last valid distance of the iterator
+    const distance_type&
+    distance() const { return _data._distance; }
+
+    //! Read-only accessor to the target of the iterator
+    const key_type&
+    target_key() const { return _data._target(); }
+
+  private:
+    //! Read/write accessor to the target of the iterator
+    key_type&
+    target_key() { return _data._target(); }
+
+    //! The related data for the iterator.
+    details::Best_first_data<Ct, Metric, typename Base::node_ptr> _data;
+  };
+
+  /**
+   *  Read accessor for best-first neighbor iterators that retrieve the valid
+   *  calculated distance from the target. The distance read is only relevant
+   *  if the iterator does not point past-the-end.
+   */
+  template <typename Ct, typename Metric>
+  inline typename Metric::distance_type
+  distance(const best_first_neighbor_iterator<Ct, Metric>& iter)
+  { return iter.distance(); }
+
+  /**
+   *  A quick accessor for best-first neighbor iterators that retrive the key
+   *  that is the target for the nearest neighbor iteration.
+   */
+  template <typename Ct, typename Metric>
+  inline const typename container_traits<Ct>::key_type&
+  target_key(const best_first_neighbor_iterator<Ct, Metric>& iter)
+  { return iter.target_key(); }
+
+  /**
+   *  Build a past-the-end best-first neighbor iterator with a user-defined
+   *  \metric.
+   *  \param container The container in which a neighbor must be found.
+   *  \param metric The metric to use in search of the neighbor.
+   *  \param target The target key used in the neighbor search.
+   */
+  ///@{
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<Ct, Metric>
+  best_first_neighbor_end
+  (Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_iterator<Ct, Metric>
+      (container, metric, target);
+  }
+
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<const Ct, Metric>
+  best_first_neighbor_end
+  (const Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_iterator<const Ct, Metric>
+      (container, metric, target);
+  }
+
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<const Ct, Metric>
+  best_first_neighbor_cend
+  (const Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  { return best_first_neighbor_end(container, metric, target); }
+  ///@}
+
+  /**
+   *  Build a past-the-end best-first neighbor iterator, assuming an euclidian
+   *  metric with distances expressed in double. It requires that the
+   *  container used was defined with a built-in key compare functor.
+   *  \param container The container in which a neighbor must be found.
+   *  \param target The target key used in the neighbor search.
+   */
+  ///@{
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<Ct> >::type
+  best_first_neighbor_end
+  (Ct& container, const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_end
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target);
+  }
+
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<const Ct> >::type
+  best_first_neighbor_end
+  (const Ct& container, const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_end
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target);
+  }
+
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<const Ct> >::type
+  best_first_neighbor_cend
+  (const Ct& container, const typename container_traits<Ct>::key_type& target)
+  { return best_first_neighbor_end(container, target); }
+  ///@}
+
+  /**
+   *  Build a \ref best_first_neighbor_iterator pointing to the nearest
+   *  neighbor of \c target using a user-defined \metric.
+   *  \param container The container in which a neighbor must be found.
+   *  \param metric The metric to use in search of the neighbor.
+   *  \param target The target key used in the neighbor search.
+   */
+  ///@{
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<Ct, Metric>
+  best_first_neighbor_begin
+  (Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  {
+    best_first_neighbor_iterator<Ct, Metric> it(container, metric, target);
+    it.reset(container, target);
+    return it;
+  }
+
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<const Ct, Metric>
+  best_first_neighbor_begin
+  (const Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  {
+    best_first_neighbor_iterator<const Ct, Metric>
+      it(container, metric, target);
+    it.reset(container, target);
+    return it;
+  }
+
+  template <typename Ct, typename Metric>
+  inline best_first_neighbor_iterator<const Ct, Metric>
+  best_first_neighbor_cbegin
+  (const Ct& container, const Metric& metric,
+   const typename container_traits<Ct>::key_type& target)
+  { return best_first_neighbor_begin(container, metric, target); }
+  ///@}
+
+  /**
+   *  Build a \ref best_first_neighbor_iterator pointing to the nearest
+   *  neighbor of \c target, assuming an euclidian metric with distances
+   *  expressed in double. It requires that the container used was defined
+   *  with a built-in key compare functor.
+   *  \param container The container in which a neighbor must be found.
+   *  \param target The target key used in the neighbor search.
+   */
+  ///@{
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<Ct> >::type
+  best_first_neighbor_begin
+  (Ct& container, const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_begin
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target);
+  }
+
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<const Ct> >::type
+  best_first_neighbor_begin
+  (const Ct& container, const typename container_traits<Ct>::key_type& target)
+  {
+    return best_first_neighbor_begin
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target);
+  }
+
+  template <typename Ct>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            best_first_neighbor_iterator<const Ct> >::type
+  best_first_neighbor_cbegin
+  (const Ct& container, const typename container_traits<Ct>::key_type& target)
+  { return best_first_neighbor_begin(container, target); }
+  ///@}
+
+} // namespace spatial
+
+#endif // SPATIAL_BEST_FIRST_NEIGHBOR_HPP
@@ -14,6 +14,7 @@
 #ifndef SPATIAL_COMPARE_BUILTIN_HPP
 #define SPATIAL_COMPARE_BUILTIN_HPP
 
+#include <iterator> // std::advance
 #include "spatial_import_type_traits.hpp"
 #include "spatial_check_concept.hpp"
 
@@ -62,6 +63,41 @@ namespace spatial
       : is_compare_builtin_helper<typename container_traits<Ct>::key_compare>
     { };
 
+    /**
+     *  Reads the coordinate of \c key along \c dim, the same way as the
+     *  builtin comparator \c compare does, for containers that place keys
+     *  by their coordinates rather than by comparing them.
+     */
+    ///@{
+    template <typename Accessor, typename Key>
+    inline double
+    builtin_coordinate(const accessor_less<Accessor, Key>& compare,
+                       dimension_type dim, const Key& key)
+    { return static_cast<double>(compare.accessor()(dim, key)); }
+
+    template <typename Key>
+    inline double
+    builtin_coordinate(const bracket_less<Key>&, dimension_type dim,
+                       const Key& key)
+    { return static_cast<double>(key[dim]); }
+
+    template <typename Key>
+    inline double
+    builtin_coordinate(const paren_less<Key>&, dimension_type dim,
+                       const Key& key)
+    { return static_cast<double>(key(dim)); }
+
+    template <typename Key>
+    inline double
+    builtin_coordinate(const iterator_less<Key>&, dimension_type dim,
+                       const Key& key)
+    {
+      typename Key::const_iterator i = key.begin();
+      std::advance(i, dim);
+      return static_cast<double>(*i);
+    }
+    ///@}
+
     /**
      *  The generic helper class to determine if a container uses a built-in
      *  compare type. See the specializations of this class.
@@ -0,0 +1,1173 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_compact_kdtree.hpp
+ *  Defines a mutable \kdtree whose nodes are stored in a single array and
+ *  linked by 32 bits indices instead of pointers.
+ *
+ *  Each node holds the indices of its parent and children and the weight of
+ *  its sub-tree in 4 words of 32 bits, followed by its value: 16 bytes of
+ *  links where a \ref Relaxed_kdtree_link needs 32, not counting the
+ *  overhead of allocating each node on its own. The array holds no pointer,
+ *  so the nodes can be copied or written out as they are.
+ *
+ *  Like the \ref Relaxed_kdtree, the tree follows the relaxed invariant and
+ *  is kept balanced by a balancing policy, as a scapegoat tree: the sub-tree
+ *  of the highest node that the policy finds unbalanced after an insertion or
+ *  a deletion is rebuilt around median nodes.
+ *
+ *  \see Compact_kdtree
+ */
+
+#ifndef SPATIAL_COMPACT_KDTREE_HPP
+#define SPATIAL_COMPACT_KDTREE_HPP
+
+#include <algorithm> // std::nth_element, std::equal
+#include <iterator>  // std::reverse_iterator
+#include <stdexcept> // std::length_error
+#include <vector>
+
+#include "spatial_ordered.hpp"
+#include "spatial_mapping.hpp"
+#include "spatial_equal.hpp"
+#include "spatial_compress.hpp"
+#include "spatial_index_node.hpp"
+#include "spatial_relaxed_kdtree.hpp" // for the balancing policies
+#include "spatial_value_compare.hpp"
+#include "spatial_template_member_swap.hpp"
+#include "spatial_except.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    //! The type of the links and weights of a \ref Compact_node.
+    typedef unsigned int compact_link_type;
+
+    /**
+     *  A node of a \ref Compact_kdtree. A node whose weight is 0 is free, and
+     *  its left link holds the next free node.
+     */
+    template <typename Value>
+    struct Compact_node
+    {
+      compact_link_type parent;
+      compact_link_type left;
+      compact_link_type right;
+      compact_link_type weight;
+      Value value;
+    };
+
+    /**
+     *  Accessors for the keys of a \ref Compact_kdtree, when values are pairs
+     *  of a key and a mapped value.
+     */
+    template <typename Key, typename Value>
+    struct Compact_values
+    {
+      static const Key&
+      key_of(const Value& value) { return value.first; }
+    };
+
+    /**
+     *  Accessors for the keys of a \ref Compact_kdtree, when values are the
+     *  keys.
+     */
+    template <typename Key>
+    struct Compact_values<Key, Key>
+    {
+      static const Key&
+      key_of(const Key& value) { return value; }
+    };
+
+    /**
+     *  A mutable \kdtree stored in a single array of nodes, used by
+     *  compact_point_multiset, compact_point_multimap, compact_box_multiset
+     *  and compact_box_multimap.
+     *
+     *  Nodes are addressed with an \ref Index_node_ptr, so all the iterators
+     *  of the library work on this tree. Inserting a value never invalidates
+     *  iterators: when the array grows, the nodes keep their indices. Erasing
+     *  a value only invalidates the iterators to that value, and its node is
+     *  reused by the next insertion.
+     *
+     *  When the array grows, the values are copied into a new array, so
+     *  references and pointers to the values are invalidated, as in a \c
+     *  std::vector. They remain valid as long as the size does not exceed
+     *  the capacity set by reserve().
+     *
+     *  The tree holds at most 2^32 - 3 nodes.
+     */
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    class Compact_kdtree
+    {
+      typedef Compact_kdtree<Rank, Key, Value, Compare, Balancing,
+                             Alloc>                   Self;
+      typedef Compact_values<Key, Value>              Values;
+
+    public:
+      // Container intrincsic types
+      typedef Rank                                    rank_type;
+      typedef typename mutate<Key>::type              key_type;
+      typedef typename mutate<Value>::type            value_type;
+      typedef Value                                   link_value_type;
+      typedef Index_link<Self>                        mode_type;
+      typedef Compare                                 key_compare;
+      typedef ValueCompare<value_type, key_compare>   value_compare;
+      typedef Alloc                                   allocator_type;
+      typedef Balancing                               balancing_policy;
+      typedef relaxed_invariant_tag                   invariant_category;
+
+      // Container iterator related types
+      typedef Value*                                  pointer;
+      typedef const Value*                            const_pointer;
+      typedef Value&                                  reference;
+      typedef const Value&                            const_reference;
+      typedef std::size_t                             size_type;
+      typedef std::ptrdiff_t                          difference_type;
+
+      // Container iterators
+      typedef Node_iterator<mode_type>                iterator;
+      typedef Const_node_iterator<mode_type>          const_iterator;
+      typedef std::reverse_iterator<iterator>         reverse_iterator;
+      typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+    private:
+      typedef Compact_node<Value>                     node_type;
+      typedef compact_link_type                       link_type;
+      typedef typename Alloc::template rebind
+      <node_type>::other                              Node_allocator;
+      typedef typename Alloc::template rebind
+      <value_type>::other                             Value_allocator;
+      typedef typename mode_type::node_ptr            node_ptr;
+      typedef typename mode_type::const_node_ptr      const_node_ptr;
+
+      //! The link to a missing node.
+      static link_type null_link() { return static_cast<link_type>(-1); }
+
+      //! The parent link of the root node.
+      static link_type header_link() { return static_cast<link_type>(-2); }
+
+      struct Implementation : rank_type
+      {
+        Implementation(const rank_type& rank, const key_compare& compare,
+                       const Balancing& balance, const Node_allocator& alloc)
+          : Rank(rank), _compare(balance, compare), _nodes(alloc)
+        { _nodes() = 0; _capacity = 0; initialize(); }
+
+        void initialize()
+        {
+          _end = 0;
+          _free = null_link();
+          _root = null_link();
+          _leftmost = null_link();
+          _rightmost = null_link();
+        }
+
+        Compress<Balancing, key_compare> _compare;
+        Compress<Node_allocator, node_type*> _nodes;
+        link_type _capacity;  // the number of nodes allocated
+        link_type _end;       // the nodes in [_end, _capacity) were never used
+        link_type _free;      // the first free node below _end
+        link_type _root;
+        link_type _leftmost;
+        link_type _rightmost;
+      } _impl;
+
+    private:
+      rank_type& get_rank()
+      { return *static_cast<Rank*>(&_impl); }
+
+      key_compare& get_compare()
+      { return _impl._compare(); }
+
+      balancing_policy& get_balancing()
+      { return _impl._compare.base(); }
+
+      Node_allocator& get_node_allocator()
+      { return _impl._nodes.base(); }
+
+      Value_allocator get_value_allocator() const
+      { return _impl._nodes.base(); }
+
+      node_type& get_node(link_type i) const
+      { return _impl._nodes()[i]; }
+
+      const key_type& get_key(link_type i) const
+      { return Values::key_of(get_node(i).value); }
+
+      link_type get_weight(link_type i) const
+      { return i == null_link() ? 0 : get_node(i).weight; }
+
+      //! Convert a link into the index of an \ref Index_node_ptr.
+      size_type to_index(link_type i) const
+      {
+        return i == null_link() ? node_ptr::npos()
+          : (i == header_link() ? header_index() : i);
+      }
+
+    private:
+      /**
+       *  Copy \c value into a free node and return its index, or throw
+       *  leaving the tree unchanged.
+       */
+      link_type create_node(const value_type& value);
+
+      /**
+       *  Destroy the value of the node \c i and put it on the free list.
+       */
+      void destroy_node(link_type i);
+
+      /**
+       *  Move all the nodes into an array of \c capacity nodes.
+       */
+      void reallocate(link_type capacity);
+
+      /**
+       *  Copy the nodes of \c other, keeping their indices.
+       */
+      void copy_nodes(const Self& other);
+
+      /**
+       *  Destroy all the values and deallocate the array of nodes.
+       */
+      void destroy_all();
+
+      /**
+       *  Returns the dimension of the node \c i.
+       */
+      dimension_type depth_dim(link_type i) const;
+
+      /**
+       *  Replace the link to \c from with a link to \c to in the parent of
+       *  \c from, or in the header if \c from is the root.
+       */
+      void replace_child(link_type from, link_type to);
+
+      /**
+       *  Exchange the places of the nodes \c a and \c b in the tree. Their
+       *  values and indices do not change.
+       */
+      void swap_links(link_type a, link_type b);
+
+      /**
+       *  Link the new node \c i into the tree, rebuilding the sub-tree of the
+       *  highest node that the balancing policy finds unbalanced.
+       */
+      void insert_node(link_type i);
+
+      /**
+       *  Unlink the node \c i of dimension \c dim from the tree, rebuilding
+       *  the sub-tree of the highest node that the balancing policy finds
+       *  unbalanced. The node is not destroyed.
+       */
+      void erase_node(link_type i, dimension_type dim);
+
+      /**
+       *  Rebuild the sub-tree of the node \c i of dimension \c dim around
+       *  median nodes.
+       */
+      void rebuild(link_type i, dimension_type dim);
+
+      /**
+       *  Link the nodes in \c [first, last) into a tree around median nodes
+       *  along \c dim, under \c parent, and return its root.
+       */
+      link_type
+      rebuild_insert(typename std::vector<link_type>::iterator first,
+                     typename std::vector<link_type>::iterator last,
+                     dimension_type dim, link_type parent);
+
+      //! Find the left most and right most nodes again.
+      void reset_extremes();
+
+      //! Compares the keys of two nodes along a single dimension.
+      struct Link_compare
+      {
+        Link_compare(const Self& tree_, dimension_type dim_)
+          : tree(&tree_), dim(dim_) { }
+
+        bool
+        operator()(link_type x, link_type y) const
+        { return tree->key_comp()(dim, tree->key(x), tree->key(y)); }
+
+        const Self* tree;
+        dimension_type dim;
+      };
+
+    public:
+      // Accessors to the nodes, used by Index_node_ptr
+      size_type
+      header_index() const
+      { return static_cast<size_type>(header_link()); }
+
+      void
+      links(size_type i, size_type& parent, size_type& left,
+            size_type& right) const
+      {
+        if (i == header_index())
+          {
+            parent = empty() ? i : _impl._root;
+            left = i;
+            right = empty() ? i : _impl._rightmost;
+          }
+        else
+          {
+            const node_type& node = get_node(static_cast<link_type>(i));
+            parent = to_index(node.parent);
+            left = to_index(node.left);
+            right = to_index(node.right);
+          }
+      }
+
+      const key_type&
+      key(size_type i) const
+      { return get_key(static_cast<link_type>(i)); }
+
+      link_value_type&
+      value(size_type i) const
+      { return get_node(static_cast<link_type>(i)).value; }
+
+      template <typename R>
+      dimension_type
+      modulo(size_type i, R r) const
+      {
+        if (i == header_index()) return r() - 1;
+        return depth_dim(static_cast<link_type>(i));
+      }
+
+      bool
+      bucket(size_type, size_type&, size_type&) const
+      { return false; }
+
+    public:
+      // Iterators standard interface
+      iterator begin()
+      {
+        return iterator(node_ptr(this, empty() ? header_index()
+                                 : _impl._leftmost));
+      }
+
+      const_iterator begin() const
+      {
+        return const_iterator(const_node_ptr(this, empty() ? header_index()
+                                             : _impl._leftmost));
+      }
+
+      const_iterator cbegin() const
+      { return begin(); }
+
+      iterator end()
+      { return iterator(node_ptr(this, header_index())); }
+
+      const_iterator end() const
+      { return const_iterator(const_node_ptr(this, header_index())); }
+
+      const_iterator cend() const
+      { return end(); }
+
+      reverse_iterator rbegin()
+      { return reverse_iterator(end()); }
+
+      const_reverse_iterator rbegin() const
+      { return const_reverse_iterator(end()); }
+
+      const_reverse_iterator crbegin() const
+      { return rbegin(); }
+
+      reverse_iterator rend()
+      { return reverse_iterator(begin()); }
+
+      const_reverse_iterator rend() const
+      { return const_reverse_iterator(begin()); }
+
+      const_reverse_iterator crend() const
+      { return rend(); }
+
+    public:
+      // Functors accessors
+      /**
+       *  Returns the balancing policy for the container.
+       */
+      balancing_policy balancing() const
+      { return _impl._compare.base(); }
+
+      /**
+       *  Returns the rank type used internally to get the number of dimensions
+       *  in the container.
+       */
+      rank_type rank() const
+      { return *static_cast<const rank_type*>(&_impl); }
+
+      /**
+       *  Returns the dimension of the container.
+       */
+      dimension_type
+      dimension() const
+      { return rank()(); }
+
+      /**
+       *  Returns the compare function used for the key.
+       */
+      key_compare key_comp() const
+      { return _impl._compare(); }
+
+      /**
+       *  Returns the compare function used for the value.
+       */
+      value_compare value_comp() const
+      { return value_compare(_impl._compare()); }
+
+      /**
+       *  Returns the allocator used by the tree.
+       */
+      allocator_type
+      get_allocator() const { return _impl._nodes.base(); }
+
+      /**
+       *  True if the tree is empty.
+       */
+      bool
+      empty() const
+      { return _impl._root == null_link(); }
+
+      /**
+       *  Returns the number of elements in the K-d tree.
+       */
+      size_type
+      size() const
+      { return get_weight(_impl._root); }
+
+      /**
+       *  Returns the number of elements in the K-d tree. Same as size().
+       *  \see size()
+       */
+      size_type
+      count() const
+      { return size(); }
+
+      /**
+       *  The maximum number of elements that can be allocated.
+       */
+      size_type
+      max_size() const
+      {
+        return std::min(_impl._nodes.base().max_size(),
+                        static_cast<size_type>(header_link() - 1));
+      }
+
+      /**
+       *  The number of elements that the tree can hold before it allocates
+       *  a larger array of nodes.
+       */
+      size_type
+      capacity() const
+      { return _impl._capacity; }
+
+      ///@{
+      /**
+       *  Find the first node that matches with \c key and returns an
+       *  iterator to it found, otherwise it returns an iterator to the element
+       *  past the end of the container.
+       *
+       *  \param key The value search.
+       *  \return An iterator to that value or an iterator to the element past
+       *  the end of the container.
+       */
+      iterator
+      find(const key_type& key)
+      {
+        if (empty()) return end();
+        return iterator(first_equal(node_ptr(this, _impl._root), 0, rank(),
+                                    key_comp(), key).first);
+      }
+
+      const_iterator
+      find(const key_type& key) const
+      {
+        if (empty()) return end();
+        return const_iterator(first_equal(const_node_ptr(this, _impl._root),
+                                          0, rank(), key_comp(), key).first);
+      }
+      ///@}
+
+    public:
+      Compact_kdtree()
+        : _impl(rank_type(), key_compare(), balancing_policy(),
+                Node_allocator()) { }
+
+      explicit Compact_kdtree(const rank_type& rank_)
+        : _impl(rank_, Compare(), Balancing(), Node_allocator())
+      { }
+
+      Compact_kdtree(const rank_type& rank_, const key_compare& compare_)
+        : _impl(rank_, compare_, Balancing(), Node_allocator())
+      { }
+
+      Compact_kdtree(const rank_type& rank_, const key_compare& compare_,
+                     const balancing_policy& balancing_)
+        : _impl(rank_, compare_, balancing_, Node_allocator())
+      { }
+
+      Compact_kdtree(const rank_type& rank_, const key_compare& compare_,
+                     const balancing_policy& balancing_,
+                     const allocator_type& allocator_)
+        : _impl(rank_, compare_, balancing_, allocator_)
+      { }
+
+      /**
+       *  Deep copy of \c other into the new tree. The nodes keep their
+       *  indices, so the copy has the same structure as \c other.
+       */
+      Compact_kdtree(const Compact_kdtree& other)
+        : _impl(other.rank(), other.key_comp(), other.balancing(),
+                other._impl._nodes.base())
+      { copy_nodes(other); }
+
+      /**
+       *  Assignment of \c other into the tree, with deep copy.
+       *
+       *  \note  Allocator is not modified with this assignment and remains the
+       *  same.
+       */
+      Compact_kdtree&
+      operator=(const Compact_kdtree& other)
+      {
+        if (&other != this)
+          {
+            destroy_all();
+            template_member_assign<rank_type>
+              ::do_it(get_rank(), other.rank());
+            template_member_assign<key_compare>
+              ::do_it(get_compare(), other.key_comp());
+            template_member_assign<balancing_policy>
+              ::do_it(get_balancing(), other.balancing());
+            copy_nodes(other);
+          }
+        return *this;
+      }
+
+      /**
+       *  Deallocate all nodes in the destructor.
+       */
+      ~Compact_kdtree()
+      { destroy_all(); }
+
+    public:
+      // Mutable functions
+      /**
+       *  Swap the K-d tree content with others
+       */
+      void
+      swap(Self& other)
+      {
+        template_member_swap<rank_type>::do_it
+          (get_rank(), other.get_rank());
+        template_member_swap<key_compare>::do_it
+          (get_compare(), other.get_compare());
+        template_member_swap<balancing_policy>::do_it
+          (get_balancing(), other.get_balancing());
+        template_member_swap<Node_allocator>::do_it
+          (get_node_allocator(), other.get_node_allocator());
+        std::swap(_impl._nodes(), other._impl._nodes());
+        std::swap(_impl._capacity, other._impl._capacity);
+        std::swap(_impl._end, other._impl._end);
+        std::swap(_impl._free, other._impl._free);
+        std::swap(_impl._root, other._impl._root);
+        std::swap(_impl._leftmost, other._impl._leftmost);
+        std::swap(_impl._rightmost, other._impl._rightmost);
+      }
+
+      /**
+       *  Erase all elements in the K-d tree. The array of nodes is kept.
+       */
+      void
+      clear()
+      {
+        Value_allocator value_alloc = get_value_allocator();
+        for (link_type i = 0; i < _impl._end; ++i)
+          {
+            if (get_node(i).weight != 0)
+              { value_alloc.destroy(mutate_pointer(&get_node(i).value)); }
+          }
+        _impl.initialize();
+      }
+
+      /**
+       *  Allocate room for at least \c n elements, so that inserting them
+       *  does not grow the array of nodes again.
+       */
+      void
+      reserve(size_type n)
+      {
+        if (n > max_size())
+          { throw std::length_error("Compact_kdtree::reserve"); }
+        if (n > _impl._capacity)
+          { reallocate(static_cast<link_type>(n)); }
+      }
+
+      /**
+       *  Insert a single value \c value in the tree. References and pointers
+       *  to the values are invalidated if the array of nodes grows.
+       */
+      iterator
+      insert(const value_type& value)
+      {
+        link_type i = create_node(value); // may throw
+        insert_node(i);
+        return iterator(node_ptr(this, i));
+      }
+
+      /**
+       *  Insert a serie of values in the tree at once.
+       */
+      template<typename InputIterator>
+      void
+      insert(InputIterator first, InputIterator last)
+      { for (; first != last; ++first) { insert(*first); } }
+
+      /**
+       *  Insert a serie of values in the container at once and rebuild the
+       *  whole tree around median nodes, in \Onlogn time.
+       */
+      template<typename InputIterator>
+      void
+      insert_rebalance(InputIterator first, InputIterator last);
+
+      /**
+       *  Rebuild the tree around median nodes, leaving it perfectly
+       *  balanced.
+       */
+      void
+      rebalance()
+      { if (!empty()) { rebuild(_impl._root, 0); } }
+
+      // Deletion
+      /**
+       *  Deletes the node pointed to by the iterator.
+       *
+       *  \exception invalid_iterator is thrown if \c position does not point
+       *  to an element of this container.
+       */
+      void
+      erase(iterator position)
+      {
+        node_ptr node = position.node;
+        if (node.tree != this || node.index >= _impl._end
+            || get_node(static_cast<link_type>(node.index)).weight == 0)
+          {
+            throw invalid_iterator
+              ("iterator is invalid or does not belong to the container used");
+          }
+        link_type i = static_cast<link_type>(node.index);
+        erase_node(i, depth_dim(i));
+        destroy_node(i);
+      }
+
+      /**
+       *  Deletes all nodes that match key \c value.
+       *  \param  key To be compared with the tree nodes.
+       */
+      size_type
+      erase(const key_type& key);
+    };
+
+    /**
+     *  Swap the content of the compact \kdtree \p left and \p right.
+     */
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void swap
+    (Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& left,
+     Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& right)
+    { left.swap(right); }
+
+    /**
+     *  The == and != operations is performed by first comparing sizes, and if
+     *  they match, the elements are compared sequentially using algorithm
+     *  std::equal, which stops at the first mismatch. The sequence of element
+     *  in each container is extracted using \ref ordered_iterator.
+     *
+     *  \param lhs Left-hand side container.
+     *  \param rhs Right-hand side container.
+     */
+    ///@{
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline bool
+    operator==
+    (const Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+     const Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+    {
+      return lhs.size() == rhs.size()
+        && std::equal(ordered_begin(lhs), ordered_end(lhs),
+                      ordered_begin(rhs));
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline bool
+    operator!=
+    (const Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& lhs,
+     const Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>& rhs)
+    { return !(lhs == rhs); }
+    ///@}
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline
+    typename Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::link_type
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::create_node(const value_type& value)
+    {
+      if (_impl._free == null_link() && _impl._end == _impl._capacity)
+        {
+          if (_impl._capacity >= max_size())
+            { throw std::length_error("Compact_kdtree::insert"); }
+          size_type capacity = 2 * static_cast<size_type>(_impl._capacity);
+          if (capacity < 16) { capacity = 16; }
+          if (capacity > max_size()) { capacity = max_size(); }
+          reallocate(static_cast<link_type>(capacity)); // may throw
+        }
+      link_type i = (_impl._free != null_link()) ? _impl._free : _impl._end;
+      node_type& node = get_node(i);
+      get_value_allocator().construct(mutate_pointer(&node.value), value);
+      if (i == _impl._free) { _impl._free = node.left; }
+      else { ++_impl._end; }
+      node.left = null_link();
+      node.right = null_link();
+      node.weight = 1;
+      return i;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::destroy_node(link_type i)
+    {
+      node_type& node = get_node(i);
+      get_value_allocator().destroy(mutate_pointer(&node.value));
+      node.weight = 0;
+      node.left = _impl._free;
+      _impl._free = i;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::reallocate(link_type capacity)
+    {
+      Node_allocator& node_alloc = get_node_allocator();
+      Value_allocator value_alloc = get_value_allocator();
+      node_type* nodes = node_alloc.allocate(capacity); // may throw
+      link_type i = 0;
+      try
+        {
+          for (; i < _impl._end; ++i)
+            {
+              const node_type& node = get_node(i);
+              if (node.weight != 0)
+                {
+                  value_alloc.construct(mutate_pointer(&nodes[i].value),
+                                        node.value);
+                }
+              nodes[i].parent = node.parent;
+              nodes[i].left = node.left;
+              nodes[i].right = node.right;
+              nodes[i].weight = node.weight;
+            }
+        }
+      catch (...)
+        {
+          while (i-- != 0)
+            {
+              if (nodes[i].weight != 0)
+                { value_alloc.destroy(mutate_pointer(&nodes[i].value)); }
+            }
+          node_alloc.deallocate(nodes, capacity);
+          throw;
+        }
+      link_type end = _impl._end, free = _impl._free, root = _impl._root,
+        leftmost = _impl._leftmost, rightmost = _impl._rightmost;
+      destroy_all();
+      _impl._nodes() = nodes;
+      _impl._capacity = capacity;
+      _impl._end = end;
+      _impl._free = free;
+      _impl._root = root;
+      _impl._leftmost = leftmost;
+      _impl._rightmost = rightmost;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::copy_nodes(const Self& other)
+    {
+      SPATIAL_ASSERT_CHECK(_impl._capacity == 0);
+      if (other._impl._end == 0) return;
+      Node_allocator& node_alloc = get_node_allocator();
+      Value_allocator value_alloc = get_value_allocator();
+      link_type capacity = other._impl._end;
+      node_type* nodes = node_alloc.allocate(capacity); // may throw
+      link_type i = 0;
+      try
+        {
+          for (; i < capacity; ++i)
+            {
+              const node_type& node = other.get_node(i);
+              if (node.weight != 0)
+                {
+                  value_alloc.construct(mutate_pointer(&nodes[i].value),
+                                        node.value);
+                }
+              nodes[i].parent = node.parent;
+              nodes[i].left = node.left;
+              nodes[i].right = node.right;
+              nodes[i].weight = node.weight;
+            }
+        }
+      catch (...)
+        {
+          while (i-- != 0)
+            {
+              if (nodes[i].weight != 0)
+                { value_alloc.destroy(mutate_pointer(&nodes[i].value)); }
+            }
+          node_alloc.deallocate(nodes, capacity);
+          throw;
+        }
+      _impl._nodes() = nodes;
+      _impl._capacity = capacity;
+      _impl._end = other._impl._end;
+      _impl._free = other._impl._free;
+      _impl._root = other._impl._root;
+      _impl._leftmost = other._impl._leftmost;
+      _impl._rightmost = other._impl._rightmost;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::destroy_all()
+    {
+      clear();
+      if (_impl._nodes() != 0)
+        { get_node_allocator().deallocate(_impl._nodes(), _impl._capacity); }
+      _impl._nodes() = 0;
+      _impl._capacity = 0;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline dimension_type
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::depth_dim(link_type i) const
+    {
+      dimension_type dim = 0;
+      for (i = get_node(i).parent; i != header_link(); i = get_node(i).parent)
+        { dim = incr_dim(rank(), dim); }
+      return dim;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::replace_child(link_type from, link_type to)
+    {
+      link_type p = get_node(from).parent;
+      if (p == header_link()) { _impl._root = to; }
+      else if (get_node(p).left == from) { get_node(p).left = to; }
+      else { get_node(p).right = to; }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::swap_links(link_type a, link_type b)
+    {
+      node_type& x = get_node(a);
+      node_type& y = get_node(b);
+      // Point the neighbours of each node to the other node. A neighbour of
+      // both is only updated once, by swapping a and b in its links.
+      link_type around[6]
+        = { x.parent, x.left, x.right, y.parent, y.left, y.right };
+      for (int k = 0; k < 6; ++k)
+        {
+          link_type n = around[k];
+          if (n == a || n == b || n == null_link()) continue;
+          bool seen = false;
+          for (int j = 0; j < k; ++j) { seen = seen || around[j] == n; }
+          if (seen) continue;
+          if (n == header_link())
+            { _impl._root = (_impl._root == a) ? b : a; continue; }
+          node_type& z = get_node(n);
+          if (z.parent == a) { z.parent = b; }
+          else if (z.parent == b) { z.parent = a; }
+          if (z.left == a) { z.left = b; }
+          else if (z.left == b) { z.left = a; }
+          if (z.right == a) { z.right = b; }
+          else if (z.right == b) { z.right = a; }
+        }
+      // Then swap their own links, where a link to one another is reversed
+      std::swap(x.parent, y.parent);
+      std::swap(x.left, y.left);
+      std::swap(x.right, y.right);
+      std::swap(x.weight, y.weight);
+      link_type* own[6]
+        = { &x.parent, &x.left, &x.right, &y.parent, &y.left, &y.right };
+      for (int k = 0; k < 6; ++k)
+        {
+          if (*own[k] == a) { *own[k] = b; }
+          else if (*own[k] == b) { *own[k] = a; }
+        }
+      if (_impl._leftmost == a) { _impl._leftmost = b; }
+      else if (_impl._leftmost == b) { _impl._leftmost = a; }
+      if (_impl._rightmost == a) { _impl._rightmost = b; }
+      else if (_impl._rightmost == b) { _impl._rightmost = a; }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::insert_node(link_type i)
+    {
+      node_type& target = get_node(i);
+      if (empty())
+        {
+          target.parent = header_link();
+          _impl._root = i;
+          _impl._leftmost = i;
+          _impl._rightmost = i;
+          return;
+        }
+      const key_type& key = get_key(i);
+      link_type node = _impl._root;
+      dimension_type dim = 0;
+      link_type scapegoat = null_link();
+      dimension_type scapegoat_dim = 0;
+      for (;;)
+        {
+          node_type& n = get_node(node);
+          // Balancing equal values on either side of the tree
+          bool left_side = key_comp()(dim, key, get_key(node))
+            || (!key_comp()(dim, get_key(node), key)
+                && (n.left == null_link()
+                    || (n.right != null_link()
+                        && get_weight(n.left) < get_weight(n.right))));
+          ++n.weight;
+          if (scapegoat == null_link()
+              && balancing()(rank(), get_weight(n.left) + left_side,
+                             get_weight(n.right) + !left_side))
+            {
+              scapegoat = node;
+              scapegoat_dim = dim;
+            }
+          link_type& child = left_side ? n.left : n.right;
+          if (child == null_link())
+            {
+              child = i;
+              target.parent = node;
+              if (left_side && _impl._leftmost == node)
+                { _impl._leftmost = i; }
+              if (!left_side && _impl._rightmost == node)
+                { _impl._rightmost = i; }
+              break;
+            }
+          node = child;
+          dim = incr_dim(rank(), dim);
+        }
+      if (scapegoat != null_link())
+        { rebuild(scapegoat, scapegoat_dim); }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::erase_node(link_type i, dimension_type dim)
+    {
+      // Swap the node down with its replacement until it is a leaf
+      for (;;)
+        {
+          const node_type& n = get_node(i);
+          if (n.left == null_link() && n.right == null_link()) break;
+          std::pair<node_ptr, dimension_type> candidate
+            = (n.left != null_link()
+               && (n.right == null_link()
+                   || get_weight(n.right) < get_weight(n.left)))
+            ? maximum_mapping(node_ptr(this, n.left), incr_dim(rank(), dim),
+                              rank(), dim, key_comp())
+            : minimum_mapping(node_ptr(this, n.right), incr_dim(rank(), dim),
+                              rank(), dim, key_comp());
+          swap_links(i, static_cast<link_type>(candidate.first.index));
+          dim = candidate.second;
+        }
+      link_type p = get_node(i).parent;
+      replace_child(i, null_link());
+      if (p == header_link())
+        {
+          _impl._leftmost = null_link();
+          _impl._rightmost = null_link();
+          return;
+        }
+      if (_impl._leftmost == i) { _impl._leftmost = p; }
+      if (_impl._rightmost == i) { _impl._rightmost = p; }
+      link_type scapegoat = null_link();
+      dimension_type scapegoat_dim = 0;
+      for (; p != header_link(); p = get_node(p).parent)
+        {
+          dim = decr_dim(rank(), dim);
+          node_type& n = get_node(p);
+          --n.weight;
+          if (balancing()(rank(), get_weight(n.left), get_weight(n.right)))
+            {
+              scapegoat = p;
+              scapegoat_dim = dim;
+            }
+        }
+      if (scapegoat != null_link())
+        { rebuild(scapegoat, scapegoat_dim); }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::rebuild(link_type i, dimension_type dim)
+    {
+      std::vector<link_type> store;
+      store.reserve(get_node(i).weight); // may throw
+      link_type parent = get_node(i).parent;
+      for (link_type node = i; node != parent; )
+        {
+          store.push_back(node);
+          const node_type& n = get_node(node);
+          if (n.left != null_link()) { node = n.left; continue; }
+          if (n.right != null_link()) { node = n.right; continue; }
+          // Climb up to the first ancestor with an unvisited right side
+          link_type p = n.parent;
+          while (p != parent && (get_node(p).right == node
+                                 || get_node(p).right == null_link()))
+            { node = p; p = get_node(node).parent; }
+          node = (p == parent) ? parent : get_node(p).right;
+        }
+      link_type root = rebuild_insert(store.begin(), store.end(), dim, parent);
+      if (parent == header_link()) { _impl._root = root; }
+      else if (get_node(parent).left == i) { get_node(parent).left = root; }
+      else { get_node(parent).right = root; }
+      reset_extremes();
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline
+    typename Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::link_type
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::rebuild_insert(typename std::vector<link_type>::iterator first,
+                     typename std::vector<link_type>::iterator last,
+                     dimension_type dim, link_type parent)
+    {
+      SPATIAL_ASSERT_CHECK(first != last);
+      typename std::vector<link_type>::iterator
+        med = first + (last - first) / 2;
+      std::nth_element(first, med, last, Link_compare(*this, dim));
+      link_type root = *med;
+      node_type& n = get_node(root);
+      n.parent = parent;
+      n.weight = static_cast<link_type>(last - first);
+      dim = incr_dim(rank(), dim);
+      n.left = (first != med)
+        ? rebuild_insert(first, med, dim, root) : null_link();
+      n.right = (med + 1 != last)
+        ? rebuild_insert(med + 1, last, dim, root) : null_link();
+      return root;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::reset_extremes()
+    {
+      link_type node = _impl._root;
+      while (get_node(node).left != null_link()) { node = get_node(node).left; }
+      _impl._leftmost = node;
+      node = _impl._root;
+      while (get_node(node).right != null_link())
+        { node = get_node(node).right; }
+      _impl._rightmost = node;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    template <typename InputIterator>
+    inline void
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::insert_rebalance(InputIterator first, InputIterator last)
+    {
+      if (first == last) return;
+      std::vector<link_type> store;
+      try
+        {
+          for (; first != last; ++first)
+            { store.push_back(create_node(*first)); } // may throw
+        }
+      catch (...)
+        {
+          for (typename std::vector<link_type>::iterator i = store.begin();
+               i != store.end(); ++i)
+            { destroy_node(*i); }
+          throw;
+        }
+      for (iterator i = begin(); i != end(); ++i)
+        { store.push_back(static_cast<link_type>(i.node.index)); }
+      _impl._root = rebuild_insert(store.begin(), store.end(), 0,
+                                   header_link());
+      reset_extremes();
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Balancing, typename Alloc>
+    inline
+    typename Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::size_type
+    Compact_kdtree<Rank, Key, Value, Compare, Balancing, Alloc>
+    ::erase(const key_type& key)
+    {
+      size_type cnt = 0;
+      while (!empty())
+        {
+          node_ptr node;
+          dimension_type dim;
+          details::assign(node, dim,
+                          first_equal(node_ptr(this, _impl._root), 0, rank(),
+                                      key_comp(), key));
+          if (header(node)) break;
+          link_type i = static_cast<link_type>(node.index);
+          erase_node(i, dim);
+          destroy_node(i);
+          ++cnt;
+        }
+      return cnt;
+    }
+
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_COMPACT_KDTREE_HPP
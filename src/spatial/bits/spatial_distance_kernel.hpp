@@ -0,0 +1,503 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_distance_kernel.hpp
+ *  Computes the distances from one target to a block of keys at once, with
+ *  SSE or AVX instructions when the compiler targets them.
+ *
+ *  The kernels work on coordinates laid out dimension by dimension: all the
+ *  first coordinates of the block, then all the second ones, and so on, as
+ *  produced by \ref spatial::details::Block_distance from an array of keys.
+ *  They are used for the \euclidian, \quadrance and \manhattan metrics on
+ *  \c float, \c double and \c int coordinates, and for any rank, though the
+ *  loop over the dimensions is only unrolled when the rank is static.
+ *
+ *  The instruction set is picked at compile time from the macros \c
+ *  __AVX2__, \c __AVX__, \c __SSE4_1__ and \c __SSE2__. Define \c
+ *  SPATIAL_DISABLE_SIMD to only use the scalar loops. The kernels are not
+ *  used when \c SPATIAL_SAFER_ARITHMETICS is defined, since they do not
+ *  check for overflows.
+ */
+
+#ifndef SPATIAL_DISTANCE_KERNEL_HPP
+#define SPATIAL_DISTANCE_KERNEL_HPP
+
+#include <cmath>   // std::sqrt, std::abs
+#include <cstdlib> // std::abs
+
+#if !defined(SPATIAL_DISABLE_SIMD)
+#  if defined(__AVX__)
+#    include <immintrin.h>
+#    define SPATIAL_SIMD_AVX
+#  elif defined(__SSE2__)
+#    include <emmintrin.h>
+#    define SPATIAL_SIMD_SSE2
+#  endif
+#  if defined(__AVX2__)
+#    define SPATIAL_SIMD_AVX2
+#  elif defined(__SSE4_1__)
+#    include <smmintrin.h>
+#    define SPATIAL_SIMD_SSE4_1
+#  endif
+#endif
+
+#include "../function.hpp"
+#include "../metric.hpp"
+#include "spatial_builtin.hpp"
+
+namespace spatial
+{
+  namespace math
+  {
+    /**
+     *  A pack of values of type \c Tp, processed by one instruction. The
+     *  generic pack holds a single value, for types without vector
+     *  instructions.
+     */
+    template <typename Tp>
+    struct Pack
+    {
+      enum { width = 1 };
+    };
+
+#if defined(SPATIAL_SIMD_AVX)
+    template <>
+    struct Pack<float>
+    {
+      enum { width = 8 };
+      typedef __m256 type;
+      static type zero() { return _mm256_setzero_ps(); }
+      static type set(float x) { return _mm256_set1_ps(x); }
+      static type load(const float* p) { return _mm256_loadu_ps(p); }
+      static void store(float* p, type x) { _mm256_storeu_ps(p, x); }
+      static type add(type x, type y) { return _mm256_add_ps(x, y); }
+      static type sub(type x, type y) { return _mm256_sub_ps(x, y); }
+      static type mul(type x, type y) { return _mm256_mul_ps(x, y); }
+      static type sqrt(type x) { return _mm256_sqrt_ps(x); }
+      static type abs(type x)
+      { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+    };
+
+    template <>
+    struct Pack<double>
+    {
+      enum { width = 4 };
+      typedef __m256d type;
+      static type zero() { return _mm256_setzero_pd(); }
+      static type set(double x) { return _mm256_set1_pd(x); }
+      static type load(const double* p) { return _mm256_loadu_pd(p); }
+      static void store(double* p, type x) { _mm256_storeu_pd(p, x); }
+      static type add(type x, type y) { return _mm256_add_pd(x, y); }
+      static type sub(type x, type y) { return _mm256_sub_pd(x, y); }
+      static type mul(type x, type y) { return _mm256_mul_pd(x, y); }
+      static type sqrt(type x) { return _mm256_sqrt_pd(x); }
+      static type abs(type x)
+      { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), x); }
+    };
+#elif defined(SPATIAL_SIMD_SSE2)
+    template <>
+    struct Pack<float>
+    {
+      enum { width = 4 };
+      typedef __m128 type;
+      static type zero() { return _mm_setzero_ps(); }
+      static type set(float x) { return _mm_set1_ps(x); }
+      static type load(const float* p) { return _mm_loadu_ps(p); }
+      static void store(float* p, type x) { _mm_storeu_ps(p, x); }
+      static type add(type x, type y) { return _mm_add_ps(x, y); }
+      static type sub(type x, type y) { return _mm_sub_ps(x, y); }
+      static type mul(type x, type y) { return _mm_mul_ps(x, y); }
+      static type sqrt(type x) { return _mm_sqrt_ps(x); }
+      static type abs(type x)
+      { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+    };
+
+    template <>
+    struct Pack<double>
+    {
+      enum { width = 2 };
+      typedef __m128d type;
+      static type zero() { return _mm_setzero_pd(); }
+      static type set(double x) { return _mm_set1_pd(x); }
+      static type load(const double* p) { return _mm_loadu_pd(p); }
+      static void store(double* p, type x) { _mm_storeu_pd(p, x); }
+      static type add(type x, type y) { return _mm_add_pd(x, y); }
+      static type sub(type x, type y) { return _mm_sub_pd(x, y); }
+      static type mul(type x, type y) { return _mm_mul_pd(x, y); }
+      static type sqrt(type x) { return _mm_sqrt_pd(x); }
+      static type abs(type x)
+      { return _mm_andnot_pd(_mm_set1_pd(-0.0), x); }
+    };
+#endif
+
+#if defined(SPATIAL_SIMD_AVX2)
+    template <>
+    struct Pack<int>
+    {
+      enum { width = 8 };
+      typedef __m256i type;
+      static type zero() { return _mm256_setzero_si256(); }
+      static type set(int x) { return _mm256_set1_epi32(x); }
+      static type load(const int* p)
+      { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+      static void store(int* p, type x)
+      { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), x); }
+      static type add(type x, type y) { return _mm256_add_epi32(x, y); }
+      static type sub(type x, type y) { return _mm256_sub_epi32(x, y); }
+      static type mul(type x, type y) { return _mm256_mullo_epi32(x, y); }
+      static type abs(type x) { return _mm256_abs_epi32(x); }
+    };
+#elif defined(SPATIAL_SIMD_SSE4_1)
+    template <>
+    struct Pack<int>
+    {
+      enum { width = 4 };
+      typedef __m128i type;
+      static type zero() { return _mm_setzero_si128(); }
+      static type set(int x) { return _mm_set1_epi32(x); }
+      static type load(const int* p)
+      { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+      static void store(int* p, type x)
+      { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), x); }
+      static type add(type x, type y) { return _mm_add_epi32(x, y); }
+      static type sub(type x, type y) { return _mm_sub_epi32(x, y); }
+      static type mul(type x, type y) { return _mm_mullo_epi32(x, y); }
+      static type abs(type x) { return _mm_abs_epi32(x); }
+    };
+#endif
+
+    /**
+     *  The kernels over packs, only instantiated for types that have vector
+     *  instructions. Each computes \c n distances, rounded down to a multiple
+     *  of the width of the pack, and returns how many it computed.
+     */
+    template <typename Tp, bool Vector = (Pack<Tp>::width > 1)>
+    struct Block_kernel
+    {
+      template <typename Rank>
+      static size_type
+      square_euclid(const Rank&, const Tp*, const Tp* const*, size_type,
+                    Tp*) { return 0; }
+
+      template <typename Rank>
+      static size_type
+      euclid(const Rank&, const Tp*, const Tp* const*, size_type, Tp*)
+      { return 0; }
+
+      template <typename Rank>
+      static size_type
+      manhattan(const Rank&, const Tp*, const Tp* const*, size_type, Tp*)
+      { return 0; }
+    };
+
+    template <typename Tp>
+    struct Block_kernel<Tp, true>
+    {
+      typedef Pack<Tp> pack;
+      typedef typename pack::type type;
+
+      template <typename Rank>
+      static size_type
+      square_euclid(const Rank& rank, const Tp* target,
+                    const Tp* const* coords, size_type n, Tp* out)
+      {
+        size_type i = 0;
+        for (; i + pack::width <= n; i += pack::width)
+          {
+            type sum = pack::zero();
+            for (dimension_type d = 0; d < rank(); ++d)
+              {
+                type x = pack::sub(pack::set(target[d]),
+                                   pack::load(coords[d] + i));
+                sum = pack::add(sum, pack::mul(x, x));
+              }
+            pack::store(out + i, sum);
+          }
+        return i;
+      }
+
+      template <typename Rank>
+      static size_type
+      euclid(const Rank& rank, const Tp* target, const Tp* const* coords,
+             size_type n, Tp* out)
+      {
+        size_type i = 0;
+        for (; i + pack::width <= n; i += pack::width)
+          {
+            type sum = pack::zero();
+            for (dimension_type d = 0; d < rank(); ++d)
+              {
+                type x = pack::sub(pack::set(target[d]),
+                                   pack::load(coords[d] + i));
+                sum = pack::add(sum, pack::mul(x, x));
+              }
+            pack::store(out + i, pack::sqrt(sum));
+          }
+        return i;
+      }
+
+      template <typename Rank>
+      static size_type
+      manhattan(const Rank& rank, const Tp* target, const Tp* const* coords,
+                size_type n, Tp* out)
+      {
+        size_type i = 0;
+        for (; i + pack::width <= n; i += pack::width)
+          {
+            type sum = pack::zero();
+            for (dimension_type d = 0; d < rank(); ++d)
+              {
+                sum = pack::add(sum, pack::abs
+                                (pack::sub(pack::set(target[d]),
+                                           pack::load(coords[d] + i))));
+              }
+            pack::store(out + i, sum);
+          }
+        return i;
+      }
+    };
+
+    /**
+     *  Computes the square of the euclidian distances between \c target and
+     *  the \c n keys whose coordinates along dimension \c d are in \c
+     *  coords[d], and writes them to \c out.
+     */
+    template <typename Rank, typename Tp>
+    inline void
+    square_euclid_block(const Rank& rank, const Tp* target,
+                        const Tp* const* coords, size_type n, Tp* out)
+    {
+      for (size_type i = Block_kernel<Tp>::square_euclid
+             (rank, target, coords, n, out); i < n; ++i)
+        {
+          Tp sum = Tp();
+          for (dimension_type d = 0; d < rank(); ++d)
+            {
+              Tp x = target[d] - coords[d][i];
+              sum += x * x;
+            }
+          out[i] = sum;
+        }
+    }
+
+    //! Computes the euclidian distances, like square_euclid_block().
+    template <typename Rank, typename Tp>
+    inline void
+    euclid_block(const Rank& rank, const Tp* target, const Tp* const* coords,
+                 size_type n, Tp* out)
+    {
+      for (size_type i = Block_kernel<Tp>::euclid
+             (rank, target, coords, n, out); i < n; ++i)
+        {
+          Tp sum = Tp();
+          for (dimension_type d = 0; d < rank(); ++d)
+            {
+              Tp x = target[d] - coords[d][i];
+              sum += x * x;
+            }
+          out[i] = std::sqrt(sum);
+        }
+    }
+
+    //! Computes the manhattan distances, like square_euclid_block().
+    template <typename Rank, typename Tp>
+    inline void
+    manhattan_block(const Rank& rank, const Tp* target,
+                    const Tp* const* coords, size_type n, Tp* out)
+    {
+      for (size_type i = Block_kernel<Tp>::manhattan
+             (rank, target, coords, n, out); i < n; ++i)
+        {
+          Tp sum = Tp();
+          for (dimension_type d = 0; d < rank(); ++d)
+            {
+              using namespace std;
+              sum += abs(target[d] - coords[d][i]);
+            }
+          out[i] = sum;
+        }
+    }
+  } // namespace math
+
+  namespace details
+  {
+    /**
+     *  Reads the coordinate of \c key along dimension \c n, the way the
+     *  built-in difference functor \c diff reads it.
+     */
+    ///@{
+    template <typename Key, typename Unit>
+    inline Unit
+    coordinate(const bracket_minus<Key, Unit>&, dimension_type n,
+               const Key& key)
+    { return key[n]; }
+
+    template <typename Key, typename Unit>
+    inline Unit
+    coordinate(const paren_minus<Key, Unit>&, dimension_type n,
+               const Key& key)
+    { return key(n); }
+
+    template <typename Key, typename Unit>
+    inline Unit
+    coordinate(const iterator_minus<Key, Unit>&, dimension_type n,
+               const Key& key)
+    {
+      typename Key::const_iterator i = key.begin();
+      std::advance(i, n);
+      return *i;
+    }
+
+    template <typename Accessor, typename Key, typename Unit>
+    inline Unit
+    coordinate(const accessor_minus<Accessor, Key, Unit>& diff,
+               dimension_type n, const Key& key)
+    { return diff.accessor()(n, key); }
+    ///@}
+
+    //! The number of keys whose distances are computed at once.
+    enum { block_size = 16 };
+
+    //! Computes the distances from a target to each key, one at a time.
+    template <typename Metric, typename Rank, typename Key>
+    inline void
+    each_distance(const Metric& metric, const Rank& rank, const Key& target,
+                  const Key* keys, size_type n,
+                  typename Metric::distance_type* out)
+    {
+      for (size_type i = 0; i < n; ++i)
+        { out[i] = metric.distance_to_key(rank(), target, keys[i]); }
+    }
+
+    /**
+     *  Computes the distances from a target to an array of keys according
+     *  to \c Metric. The generic version calls the metric for each key.
+     */
+    template <typename Metric>
+    struct Block_distance
+    {
+      template <typename Rank, typename Key>
+      static void
+      apply(const Metric& metric, const Rank& rank, const Key& target,
+            const Key* keys, size_type n,
+            typename Metric::distance_type* out)
+      { each_distance(metric, rank, target, keys, n, out); }
+    };
+
+#ifndef SPATIAL_SAFER_ARITHMETICS
+    /**
+     *  Copies the coordinates of a block of keys into arrays, one per
+     *  dimension, and the coordinates of the target, for the kernels.
+     */
+    template <typename Unit, dimension_type MaxRank = 3>
+    struct Block_coordinates
+    {
+      //! Does nothing for difference functors that are not built-in.
+      template <typename Rank, typename Diff, typename Key>
+      bool
+      extract(const Rank&, const Diff&, const Key&, const Key*, size_type,
+              import::false_type)
+      { return false; }
+
+      template <typename Rank, typename Diff, typename Key>
+      bool
+      extract(const Rank& rank, const Diff& diff, const Key& target,
+              const Key* keys, size_type n, import::true_type)
+      {
+        if (rank() > MaxRank || n > block_size) return false;
+        for (dimension_type d = 0; d < rank(); ++d)
+          {
+            origin[d] = coordinate(diff, d, target);
+            for (size_type i = 0; i < n; ++i)
+              { values[d][i] = coordinate(diff, d, keys[i]); }
+            coords[d] = values[d];
+          }
+        return true;
+      }
+
+      Unit origin[MaxRank];
+      Unit values[MaxRank][block_size];
+      const Unit* coords[MaxRank];
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Block_distance<euclidian<Ct, DistanceType, Diff> >
+    {
+      template <typename Rank, typename Key>
+      static void
+      apply(const euclidian<Ct, DistanceType, Diff>& metric,
+            const Rank& rank, const Key& target, const Key* keys,
+            size_type n, DistanceType* out)
+      {
+        Block_coordinates<DistanceType> block;
+        if (block.extract(rank, metric.difference(), target, keys, n,
+                          is_difference_builtin<Diff>()))
+          { math::euclid_block(rank, block.origin, block.coords, n, out); }
+        else
+          { each_distance(metric, rank, target, keys, n, out); }
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Block_distance<quadrance<Ct, DistanceType, Diff> >
+    {
+      template <typename Rank, typename Key>
+      static void
+      apply(const quadrance<Ct, DistanceType, Diff>& metric,
+            const Rank& rank, const Key& target, const Key* keys,
+            size_type n, DistanceType* out)
+      {
+        Block_coordinates<DistanceType> block;
+        if (block.extract(rank, metric.difference(), target, keys, n,
+                          is_difference_builtin<Diff>()))
+          {
+            math::square_euclid_block(rank, block.origin, block.coords, n,
+                                      out);
+          }
+        else
+          { each_distance(metric, rank, target, keys, n, out); }
+      }
+    };
+
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Block_distance<manhattan<Ct, DistanceType, Diff> >
+    {
+      template <typename Rank, typename Key>
+      static void
+      apply(const manhattan<Ct, DistanceType, Diff>& metric,
+            const Rank& rank, const Key& target, const Key* keys,
+            size_type n, DistanceType* out)
+      {
+        Block_coordinates<DistanceType> block;
+        if (block.extract(rank, metric.difference(), target, keys, n,
+                          is_difference_builtin<Diff>()))
+          {
+            math::manhattan_block(rank, block.origin, block.coords, n,
+                                  out);
+          }
+        else
+          { each_distance(metric, rank, target, keys, n, out); }
+      }
+    };
+#endif // SPATIAL_SAFER_ARITHMETICS
+
+    /**
+     *  Computes the distances from \c target to the \c n keys starting at \c
+     *  keys according to \c metric, and writes them to \c out. At most \ref
+     *  block_size keys are handled with the kernels at once.
+     */
+    template <typename Metric, typename Rank, typename Key>
+    inline void
+    block_distance(const Metric& metric, const Rank& rank, const Key& target,
+                   const Key* keys, size_type n,
+                   typename Metric::distance_type* out)
+    { Block_distance<Metric>::apply(metric, rank, target, keys, n, out); }
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_DISTANCE_KERNEL_HPP
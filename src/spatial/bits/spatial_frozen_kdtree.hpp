@@ -0,0 +1,907 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_frozen_kdtree.hpp
+ *  Defines a read-only \kdtree stored without any pointer.
+ *
+ *  The nodes of the tree are laid out in contiguous arrays, in an order
+ *  given by one of the layouts of spatial_frozen_layout.hpp, which find the
+ *  children of a node from its index alone. Keys are held in their own
+ *  array so that walking down the tree only touches keys, packed closely
+ *  together. When the values are pairs of a key and a mapped value, the
+ *  pairs are stored in a second array, since iterators refer to them: each
+ *  key is then stored twice.
+ *
+ *  The tree cannot be modified once built, other than by building it again
+ *  with more values. In exchange, it saves the links and the allocation
+ *  overhead of every node of a \kdtree linked with pointers, and is much
+ *  more cache friendly.
+ *
+ *  Since the nodes hold no pointer, the arrays can be saved as they are and
+ *  queried again in place once loaded or mapped in memory, when keys and
+ *  values can be copied bit by bit.
+ *
+ *  \see Frozen_kdtree
+ */
+
+#ifndef SPATIAL_FROZEN_KDTREE_HPP
+#define SPATIAL_FROZEN_KDTREE_HPP
+
+#include <algorithm> // std::equal
+#include <cstring>   // std::memcpy, std::memcmp
+#include <istream>
+#include <iterator>  // std::distance, std::reverse_iterator
+#include <ostream>
+#include <vector>
+#include <stdint.h>  // uint64_t, uintptr_t
+
+#include "spatial_ordered.hpp"
+#include "spatial_mapping.hpp"
+#include "spatial_equal.hpp"
+#include "spatial_compress.hpp"
+#include "spatial_index_node.hpp"
+#include "spatial_frozen_layout.hpp"
+#include "spatial_value_compare.hpp"
+#include "spatial_template_member_swap.hpp"
+#include "spatial_import_type_traits.hpp"
+#include "spatial_check_concept.hpp"
+#include "spatial_except.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  The header of the image of a \ref Frozen_kdtree, written by \c save()
+     *  and read by \c load() and \c map(). The keys follow at \c
+     *  keys_offset from the start of the image and the values, if they are
+     *  not the keys, at \c values_offset.
+     *
+     *  The fields have the same size on all machines, so that an image
+     *  written by a 32 bits program is read as such by a 64 bits one.
+     */
+    struct Frozen_image_header
+    {
+      char magic[8];
+      uint64_t byte_order;
+      uint64_t key_size;
+      uint64_t value_size;
+      uint64_t rank;
+      uint64_t layout;
+      uint64_t count;
+      uint64_t keys_offset;
+      uint64_t values_offset;
+    };
+
+    //! Identifies the images of frozen trees and the version of their format.
+    inline const char*
+    frozen_image_magic()
+    { return "spatial1"; }
+
+    //! Differs between machines that do not store integers the same way.
+    inline uint64_t
+    frozen_image_byte_order()
+    { return static_cast<uint64_t>(0x01020304); }
+
+    //! Keys and values start at offsets aligned on a cache line.
+    inline uint64_t
+    frozen_image_align(uint64_t offset)
+    { return (offset + 63) & ~static_cast<uint64_t>(63); }
+
+    /**
+     *  True when the values of \c Tp can be copied from and to memory bit by
+     *  bit. The check is left to the user of the library before C++11.
+     */
+    template <typename Tp>
+    struct Frozen_flat
+    {
+#ifdef SPATIAL_TYPE_TRAITS_TRIVIAL
+      static const bool value
+      = import::is_trivially_copy_constructible<Tp>::value
+        && import::is_trivially_destructible<Tp>::value;
+#else
+      static const bool value = true;
+#endif
+    };
+
+    //! Fails to compile if \c Tp cannot be copied bit by bit.
+    template <typename Tp>
+    inline typename enable_if<Frozen_flat<Tp> >::type
+    check_concept_flat() { }
+
+    /**
+     *  Accessors for the keys and values of a \ref Frozen_kdtree, when values
+     *  are pairs of a key and a mapped value. The values are stored in their
+     *  own array.
+     */
+    template <typename Key, typename Value>
+    struct Frozen_values
+    {
+      static const bool separate = true;
+
+      static const Key&
+      key_of(const Value& value) { return value.first; }
+
+      static const Value&
+      value_of(const typename mutate<Key>::type*, const Value* values,
+               size_type i) { return values[i]; }
+    };
+
+    /**
+     *  Accessors for the keys and values of a \ref Frozen_kdtree, when values
+     *  are the keys. Only the keys are stored.
+     */
+    template <typename Key>
+    struct Frozen_values<Key, Key>
+    {
+      static const bool separate = false;
+
+      static const Key&
+      key_of(const Key& value) { return value; }
+
+      static const Key&
+      value_of(const typename mutate<Key>::type* keys, const Key*,
+               size_type i) { return keys[i]; }
+    };
+
+    /**
+     *  Compares pointers to values by the keys of the values, along a single
+     *  dimension.
+     */
+    template <typename Key, typename Value, typename Compare>
+    struct frozen_compare
+    {
+      Compare compare;
+      dimension_type dimension;
+
+      frozen_compare(const Compare& c, dimension_type d)
+        : compare(c), dimension(d) { }
+
+      bool
+      operator()(const Value* x, const Value* y) const
+      {
+        return compare(dimension, Frozen_values<Key, Value>::key_of(*x),
+                       Frozen_values<Key, Value>::key_of(*y));
+      }
+    };
+
+    /**
+     *  A read-only \kdtree with an implicit layout, used by
+     *  frozen_point_multiset, frozen_point_multimap, frozen_box_multiset and
+     *  frozen_box_multimap.
+     *
+     *  Nodes are addressed with an \ref Index_node_ptr, so all the iterators
+     *  of the library work on this tree. The tree follows the relaxed
+     *  invariant: keys equal to a node's key may be on either side of it.
+     *
+     *  \tparam Layout The order in which nodes are stored, such as \ref
+     *  Breadth_first_layout.
+     */
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    class Frozen_kdtree
+    {
+      typedef Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc> Self;
+      typedef Frozen_values<Key, Value>                       Values;
+
+    public:
+      // Container intrincsic types
+      typedef Rank                                    rank_type;
+      typedef typename mutate<Key>::type              key_type;
+      typedef typename mutate<Value>::type            value_type;
+      typedef const Value                             link_value_type;
+      typedef Index_link<const Self>                  mode_type;
+      typedef Compare                                 key_compare;
+      typedef ValueCompare<value_type, key_compare>   value_compare;
+      typedef Alloc                                   allocator_type;
+      typedef relaxed_invariant_tag                   invariant_category;
+
+      // Container iterator related types
+      typedef const Value*                            pointer;
+      typedef const Value*                            const_pointer;
+      typedef const Value&                            reference;
+      typedef const Value&                            const_reference;
+      typedef std::size_t                             size_type;
+      typedef std::ptrdiff_t                          difference_type;
+
+      // Container iterators
+      // The container is read-only, iterator and const_iterator are the same.
+      typedef Const_node_iterator<mode_type>          iterator;
+      typedef Const_node_iterator<mode_type>          const_iterator;
+      typedef std::reverse_iterator<iterator>         reverse_iterator;
+      typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+    private:
+      typedef typename Alloc::template rebind
+      <key_type>::other                               Key_allocator;
+      typedef typename Alloc::template rebind
+      <value_type>::other                             Value_allocator;
+      typedef typename mode_type::node_ptr            node_ptr;
+
+      struct Implementation : rank_type
+      {
+        Implementation(const rank_type& rank, const key_compare& compare,
+                       const Alloc& alloc)
+          : Rank(rank), _compare(alloc, compare) { initialize(); }
+
+        void initialize()
+        {
+          _keys = 0;
+          _values = 0;
+          _count = 0;
+          _owned = true;
+          _layout.reset(0);
+        }
+
+        Compress<Alloc, key_compare> _compare;
+        key_type* _keys;
+        value_type* _values;
+        size_type _count;
+        bool _owned;   // false when the arrays are in a mapped image
+        Layout _layout;
+      } _impl;
+
+    private:
+      rank_type& get_rank()
+      { return *static_cast<Rank*>(&_impl); }
+
+      key_compare& get_compare()
+      { return _impl._compare(); }
+
+      Alloc& get_allocator_ref()
+      { return _impl._compare.base(); }
+
+      Key_allocator get_key_allocator() const
+      { return _impl._compare.base(); }
+
+      Value_allocator get_value_allocator() const
+      { return _impl._compare.base(); }
+
+      /**
+       *  Replace the content of the tree with copies of the values pointed to
+       *  by \c order.
+       */
+      void
+      build(std::vector<const value_type*>& order);
+
+      /**
+       *  Destroy and deallocate the arrays of keys and values, unless they
+       *  belong to a mapped image.
+       */
+      void
+      destroy_all();
+
+      //! The header of the image of the tree.
+      Frozen_image_header
+      image_header() const;
+
+      //! Throws invalid_image if \c header is not for this type of tree.
+      void
+      check_image(const Frozen_image_header& header) const;
+
+    public:
+      // Accessors to the nodes, used by Index_node_ptr
+      size_type
+      header_index() const
+      { return _impl._count; }
+
+      void
+      links(size_type i, size_type& parent, size_type& left,
+            size_type& right) const
+      {
+        if (i == _impl._count)
+          {
+            parent = _impl._count == 0 ? i : 0;
+            left = i;
+            right = _impl._count == 0 ? i : _impl._layout.rightmost();
+          }
+        else { _impl._layout.links(i, parent, left, right); }
+      }
+
+      const key_type&
+      key(size_type i) const
+      { return _impl._keys[i]; }
+
+      link_value_type&
+      value(size_type i) const
+      { return Values::value_of(_impl._keys, _impl._values, i); }
+
+      template <typename R>
+      dimension_type
+      modulo(size_type i, R r) const
+      {
+        if (i == _impl._count) return r() - 1;
+        return _impl._layout.depth(i) % r();
+      }
+
+      bool
+      bucket(size_type i, size_type& first, size_type& last) const
+      {
+        return i != _impl._count && _impl._layout.bucket(i, first, last);
+      }
+
+    public:
+      // Iterators standard interface
+      const_iterator begin() const
+      { return const_iterator(node_ptr(this, _impl._layout.leftmost())); }
+
+      const_iterator cbegin() const
+      { return begin(); }
+
+      const_iterator end() const
+      { return const_iterator(node_ptr(this, _impl._count)); }
+
+      const_iterator cend() const
+      { return end(); }
+
+      const_reverse_iterator rbegin() const
+      { return const_reverse_iterator(end()); }
+
+      const_reverse_iterator crbegin() const
+      { return rbegin(); }
+
+      const_reverse_iterator rend() const
+      { return const_reverse_iterator(begin()); }
+
+      const_reverse_iterator crend() const
+      { return rend(); }
+
+    public:
+      // Functors accessors
+      /**
+       *  Returns the rank type used internally to get the number of dimensions
+       *  in the container.
+       */
+      rank_type rank() const
+      { return *static_cast<const rank_type*>(&_impl); }
+
+      /**
+       *  Returns the dimension of the container.
+       */
+      dimension_type
+      dimension() const
+      { return rank()(); }
+
+      /**
+       *  Returns the compare function used for the key.
+       */
+      key_compare key_comp() const
+      { return _impl._compare(); }
+
+      /**
+       *  Returns the compare function used for the value.
+       */
+      value_compare value_comp() const
+      { return value_compare(_impl._compare()); }
+
+      /**
+       *  Returns the allocator used by the tree.
+       */
+      allocator_type
+      get_allocator() const { return _impl._compare.base(); }
+
+      /**
+       *  True if the tree is empty.
+       */
+      bool
+      empty() const
+      { return _impl._count == 0; }
+
+      /**
+       *  Returns the number of elements in the K-d tree.
+       */
+      size_type
+      size() const
+      { return _impl._count; }
+
+      /**
+       *  Returns the number of elements in the K-d tree. Same as size().
+       *  \see size()
+       */
+      size_type
+      count() const
+      { return size(); }
+
+      /**
+       *  The maximum number of elements that can be allocated.
+       */
+      size_type
+      max_size() const
+      { return get_key_allocator().max_size(); }
+
+      /**
+       *  Find the first node that matches with \c key and returns an
+       *  iterator to it found, otherwise it returns an iterator to the element
+       *  past the end of the container.
+       *
+       *  \param key The value search.
+       *  \return An iterator to that value or an iterator to the element past
+       *  the end of the container.
+       */
+      const_iterator
+      find(const key_type& key) const
+      {
+        if (empty()) return end();
+        return const_iterator(first_equal(node_ptr(this, 0), 0, rank(),
+                                          key_comp(), key).first);
+      }
+
+    public:
+      Frozen_kdtree()
+        : _impl(rank_type(), key_compare(), allocator_type()) { }
+
+      explicit Frozen_kdtree(const rank_type& rank_)
+        : _impl(rank_, key_compare(), allocator_type()) { }
+
+      Frozen_kdtree(const rank_type& rank_, const key_compare& compare_)
+        : _impl(rank_, compare_, allocator_type()) { }
+
+      Frozen_kdtree(const rank_type& rank_, const key_compare& compare_,
+                    const allocator_type& allocator_)
+        : _impl(rank_, compare_, allocator_) { }
+
+      /**
+       *  Deep copy of \c other into the new tree.
+       */
+      Frozen_kdtree(const Frozen_kdtree& other)
+        : _impl(other.rank(), other.key_comp(), other.get_allocator())
+      { insert_rebalance(other.begin(), other.end()); }
+
+      /**
+       *  Assignment of \c other into the tree, with deep copy.
+       *
+       *  \note  Allocator is not modified with this assignment and remains the
+       *  same.
+       */
+      Frozen_kdtree&
+      operator=(const Frozen_kdtree& other)
+      {
+        if (&other != this)
+          {
+            destroy_all();
+            template_member_assign<rank_type>
+              ::do_it(get_rank(), other.rank());
+            template_member_assign<key_compare>
+              ::do_it(get_compare(), other.key_comp());
+            insert_rebalance(other.begin(), other.end());
+          }
+        return *this;
+      }
+
+      /**
+       *  Deallocate all values in the destructor.
+       */
+      ~Frozen_kdtree()
+      { destroy_all(); }
+
+    public:
+      /**
+       *  Swap the K-d tree content with others
+       */
+      void
+      swap(Self& other)
+      {
+        template_member_swap<rank_type>::do_it
+          (get_rank(), other.get_rank());
+        template_member_swap<key_compare>::do_it
+          (get_compare(), other.get_compare());
+        template_member_swap<Alloc>::do_it
+          (get_allocator_ref(), other.get_allocator_ref());
+        std::swap(_impl._keys, other._impl._keys);
+        std::swap(_impl._values, other._impl._values);
+        std::swap(_impl._count, other._impl._count);
+        std::swap(_impl._owned, other._impl._owned);
+        std::swap(_impl._layout, other._impl._layout);
+      }
+
+      /**
+       *  Erase all elements in the K-d tree.
+       */
+      void
+      clear()
+      { destroy_all(); }
+
+      /**
+       *  Add the values in \c [first, last) to the values already in the
+       *  container and build the tree again, in \Onlogn time.
+       *
+       *  Iterators on the container are invalidated. The parameters \c first
+       *  and \c last must be a model of \c ForwardIterator.
+       */
+      template<typename ForwardIterator>
+      void
+      insert_rebalance(ForwardIterator first, ForwardIterator last);
+
+      /**
+       *  Returns the number of bytes written by save().
+       */
+      size_type
+      image_size() const
+      {
+        Frozen_image_header header = image_header();
+        return static_cast<size_type>
+          (Values::separate
+           ? header.values_offset + header.count * sizeof(value_type)
+           : header.keys_offset + header.count * sizeof(key_type));
+      }
+
+      /**
+       *  Writes the image of the tree to \c out: a header followed by the
+       *  arrays of keys and values exactly as they are laid out in memory.
+       *  The keys and values must be copyable bit by bit, and must not hold
+       *  pointers if the image is to be used by another process.
+       *
+       *  Errors are reported through the state of \c out.
+       */
+      void
+      save(std::ostream& out) const;
+
+      /**
+       *  Replaces the content of the tree with the image read from \c in, as
+       *  written by save() for a tree of the same type.
+       *
+       *  \throws invalid_image if the image is truncated or was not written
+       *  for a tree of this type, on a machine with the same memory
+       *  representation. The tree is left unchanged.
+       */
+      void
+      load(std::istream& in);
+
+      /**
+       *  Replaces the content of the tree with the image at \c image, as
+       *  written by save(), without copying it: the tree is queried in place
+       *  with all the iterators of the library. Suitable for an image mapped
+       *  read-only in memory from a file, in microseconds:
+       *
+       *  \code
+       *  int fd = open("tiles.bin", O_RDONLY);
+       *  struct stat st; fstat(fd, &st);
+       *  void* image = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+       *  tiles.map(image, st.st_size);
+       *  \endcode
+       *
+       *  The memory must remain valid as long as the tree uses it, and must
+       *  be aligned for the keys and the values, as the memory returned by
+       *  \c malloc() or \c mmap() is. Building the tree again, with
+       *  insert_rebalance(), copies the values back into memory of its own.
+       *
+       *  \throws invalid_image under the same conditions as load(), or if
+       *  \c image is not aligned for the keys and the values.
+       */
+      void
+      map(const void* image, size_type size);
+
+      /**
+       *  True when the tree is using the memory of an image given to map().
+       */
+      bool
+      mapped() const
+      { return !_impl._owned; }
+    };
+
+    /**
+     *  Swap the content of the frozen \kdtree \p left and \p right.
+     */
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void swap
+    (Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& left,
+     Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& right)
+    { left.swap(right); }
+
+    /**
+     *  The == and != operations is performed by first comparing sizes, and if
+     *  they match, the elements are compared sequentially using algorithm
+     *  std::equal, which stops at the first mismatch. The sequence of element
+     *  in each container is extracted using \ref ordered_iterator.
+     *
+     *  \param lhs Left-hand side container.
+     *  \param rhs Right-hand side container.
+     */
+    ///@{
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline bool
+    operator==
+    (const Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& lhs,
+     const Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& rhs)
+    {
+      return lhs.size() == rhs.size()
+        && std::equal(ordered_begin(lhs), ordered_end(lhs),
+                      ordered_begin(rhs));
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline bool
+    operator!=
+    (const Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& lhs,
+     const Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>& rhs)
+    { return !(lhs == rhs); }
+    ///@}
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>::destroy_all()
+    {
+      if (_impl._owned)
+        {
+          Key_allocator key_alloc = get_key_allocator();
+          Value_allocator value_alloc = get_value_allocator();
+          for (size_type i = 0; i < _impl._count; ++i)
+            {
+              key_alloc.destroy(_impl._keys + i);
+              if (Values::separate)
+                { value_alloc.destroy(_impl._values + i); }
+            }
+          if (_impl._keys != 0)
+            { key_alloc.deallocate(_impl._keys, _impl._count); }
+          if (_impl._values != 0)
+            { value_alloc.deallocate(_impl._values, _impl._count); }
+        }
+      _impl.initialize();
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline Frozen_image_header
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::image_header() const
+    {
+      Frozen_image_header header;
+      std::memcpy(header.magic, frozen_image_magic(), sizeof(header.magic));
+      header.byte_order = frozen_image_byte_order();
+      header.key_size = sizeof(key_type);
+      header.value_size = Values::separate ? sizeof(value_type) : 0;
+      header.rank = dimension();
+      header.layout = Layout::signature();
+      header.count = _impl._count;
+      header.keys_offset = frozen_image_align(sizeof(Frozen_image_header));
+      header.values_offset = Values::separate
+        ? frozen_image_align(header.keys_offset
+                             + header.count * sizeof(key_type)) : 0;
+      return header;
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::check_image(const Frozen_image_header& header) const
+    {
+      Frozen_image_header expected = image_header();
+      if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)))
+        { throw invalid_image("not the image of a frozen tree"); }
+      if (header.byte_order != expected.byte_order)
+        { throw invalid_image("image saved with another byte order"); }
+      if (header.key_size != expected.key_size
+          || header.value_size != expected.value_size
+          || header.layout != expected.layout)
+        { throw invalid_image("image saved from another type of tree"); }
+      if (header.rank != expected.rank)
+        { throw invalid_image("image saved with another rank"); }
+      if (header.count > max_size()
+          || header.count > get_value_allocator().max_size())
+        { throw invalid_image("corrupt image"); }
+      // Offsets depend on the count, which was not known to image_header()
+      expected.count = header.count;
+      expected.values_offset = Values::separate
+        ? frozen_image_align(expected.keys_offset
+                             + header.count * sizeof(key_type)) : 0;
+      if (header.keys_offset != expected.keys_offset
+          || header.values_offset != expected.values_offset)
+        { throw invalid_image("corrupt image"); }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::save(std::ostream& out) const
+    {
+      check_concept_flat<key_type>();
+      check_concept_flat<value_type>();
+      Frozen_image_header header = image_header();
+      const char padding[64] = { 0 };
+      out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      out.write(padding, header.keys_offset - sizeof(header));
+      out.write(reinterpret_cast<const char*>(_impl._keys),
+                header.count * sizeof(key_type));
+      if (Values::separate)
+        {
+          out.write(padding, header.values_offset - header.keys_offset
+                    - header.count * sizeof(key_type));
+          out.write(reinterpret_cast<const char*>(_impl._values),
+                    header.count * sizeof(value_type));
+        }
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::load(std::istream& in)
+    {
+      check_concept_flat<key_type>();
+      check_concept_flat<value_type>();
+      Frozen_image_header header;
+      if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        { throw invalid_image("truncated image"); }
+      check_image(header);
+      size_type count = static_cast<size_type>(header.count);
+      Key_allocator key_alloc = get_key_allocator();
+      Value_allocator value_alloc = get_value_allocator();
+      key_type* keys = count ? key_alloc.allocate(count) : 0; // may throw
+      value_type* values = 0;
+      bool complete = false;
+      try
+        {
+          if (Values::separate && count)
+            { values = value_alloc.allocate(count); } // may throw
+          // The types are copyable bit by bit, they need no construction
+          complete = in.ignore(header.keys_offset - sizeof(header))
+            && in.read(reinterpret_cast<char*>(keys),
+                       count * sizeof(key_type))
+            && (!Values::separate
+                || (in.ignore(header.values_offset - header.keys_offset
+                              - count * sizeof(key_type))
+                    && in.read(reinterpret_cast<char*>(values),
+                               count * sizeof(value_type))));
+        }
+      catch (...)
+        {
+          if (values != 0) { value_alloc.deallocate(values, count); }
+          if (keys != 0) { key_alloc.deallocate(keys, count); }
+          throw;
+        }
+      if (!complete)
+        {
+          if (values != 0) { value_alloc.deallocate(values, count); }
+          if (keys != 0) { key_alloc.deallocate(keys, count); }
+          throw invalid_image("truncated image");
+        }
+      destroy_all();
+      _impl._keys = keys;
+      _impl._values = values;
+      _impl._count = count;
+      _impl._layout.reset(count);
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::map(const void* image, size_type size)
+    {
+      check_concept_flat<key_type>();
+      check_concept_flat<value_type>();
+      Frozen_image_header header;
+      if (size < sizeof(header)) { throw invalid_image("truncated image"); }
+      std::memcpy(&header, image, sizeof(header));
+      check_image(header);
+      // The offsets are multiples of 64, so the arrays are aligned if the
+      // image is.
+      if (reinterpret_cast<uintptr_t>(image)
+          % import::alignment_of<key_type>::value != 0
+          || reinterpret_cast<uintptr_t>(image)
+          % import::alignment_of<value_type>::value != 0)
+        { throw invalid_image("misaligned image"); }
+      const char* bytes = static_cast<const char*>(image);
+      uint64_t end = Values::separate
+        ? header.values_offset + header.count * sizeof(value_type)
+        : header.keys_offset + header.count * sizeof(key_type);
+      if (size < end) { throw invalid_image("truncated image"); }
+      destroy_all();
+      // The tree never writes to its arrays, which are only non-const so
+      // that trees of its own may be destroyed through them.
+      _impl._keys = reinterpret_cast<key_type*>
+        (const_cast<char*>(bytes + header.keys_offset));
+      _impl._values = Values::separate ? reinterpret_cast<value_type*>
+        (const_cast<char*>(bytes + header.values_offset)) : 0;
+      _impl._count = static_cast<size_type>(header.count);
+      _impl._owned = false;
+      _impl._layout.reset(_impl._count);
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    template <typename ForwardIterator>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::insert_rebalance(ForwardIterator first, ForwardIterator last)
+    {
+      size_type added = static_cast<size_type>(std::distance(first, last));
+      if (added == 0) return;
+      // Copy the new values aside, they may not be of value_type
+      Value_allocator value_alloc = get_value_allocator();
+      value_type* staged = value_alloc.allocate(added); // may throw
+      size_type constructed = 0;
+      try
+        {
+          for (; first != last; ++first, ++constructed)
+            { value_alloc.construct(staged + constructed, *first); }
+          std::vector<const value_type*> order;
+          order.reserve(_impl._count + added);
+          for (size_type i = 0; i < _impl._count; ++i)
+            { order.push_back(&value(i)); }
+          for (size_type i = 0; i < added; ++i)
+            { order.push_back(staged + i); }
+          build(order);
+        }
+      catch (...)
+        {
+          for (size_type i = 0; i < constructed; ++i)
+            { value_alloc.destroy(staged + i); }
+          value_alloc.deallocate(staged, added);
+          throw;
+        }
+      for (size_type i = 0; i < added; ++i)
+        { value_alloc.destroy(staged + i); }
+      value_alloc.deallocate(staged, added);
+    }
+
+    template <typename Rank, typename Key, typename Value, typename Compare,
+              typename Layout, typename Alloc>
+    inline void
+    Frozen_kdtree<Rank, Key, Value, Compare, Layout, Alloc>
+    ::build(std::vector<const value_type*>& order)
+    {
+      size_type count = order.size();
+      Layout layout;
+      layout.reset(count);
+      std::vector<const value_type*> slots;
+      layout.order(rank(), frozen_compare<Key, Value, Compare>(key_comp(), 0),
+                   order, slots);
+      Key_allocator key_alloc = get_key_allocator();
+      Value_allocator value_alloc = get_value_allocator();
+      key_type* keys = key_alloc.allocate(count); // may throw
+      value_type* values = 0;
+      size_type constructed = 0;
+      try
+        {
+          if (Values::separate)
+            { values = value_alloc.allocate(count); } // may throw
+          for (; constructed < count; ++constructed)
+            {
+              key_alloc.construct(keys + constructed,
+                                  Values::key_of(*slots[constructed]));
+              if (Values::separate)
+                {
+                  try
+                    {
+                      value_alloc.construct(values + constructed,
+                                            *slots[constructed]);
+                    }
+                  catch (...)
+                    { key_alloc.destroy(keys + constructed); throw; }
+                }
+            }
+        }
+      catch (...)
+        {
+          for (size_type i = 0; i < constructed; ++i)
+            {
+              key_alloc.destroy(keys + i);
+              if (Values::separate) { value_alloc.destroy(values + i); }
+            }
+          if (values != 0) { value_alloc.deallocate(values, count); }
+          key_alloc.deallocate(keys, count);
+          throw;
+        }
+      destroy_all();
+      _impl._keys = keys;
+      _impl._values = values;
+      _impl._count = count;
+      _impl._layout = layout;
+    }
+
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_FROZEN_KDTREE_HPP
@@ -0,0 +1,164 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_frozen_layout.hpp
+ *  Defines the layouts in which a \ref Frozen_kdtree stores its nodes.
+ *
+ *  A layout decides at which index each node of the tree is stored and
+ *  resolves the parent, left and right indices of any node in constant
+ *  time, without storing them. A layout must provide:
+ *
+ *  \code
+ *  static size_type signature();     // tells layouts apart in images
+ *  void reset(size_type count);      // lay out a tree of count nodes
+ *  size_type leftmost() const;
+ *  size_type rightmost() const;
+ *  void links(size_type i, size_type& parent, size_type& left,
+ *             size_type& right) const; // parent of the root is count
+ *  dimension_type depth(size_type i) const;
+ *  bool bucket(size_type i, size_type& first,
+ *              size_type& last) const; // i roots the nodes [first, last)
+ *  template <typename Rank, typename Less, typename Pointer>
+ *  void order(const Rank& rank, Less less, std::vector<Pointer>& values,
+ *             std::vector<Pointer>& slots) const;
+ *  \endcode
+ *
+ *  \c order() rearranges \c values into the index at which they must be
+ *  stored. \c Less compares two values along its public member \c
+ *  dimension. \c bucket() returns true when the sub-tree rooted at \c i is
+ *  stored in one range of indices, so that searches may scan it in one
+ *  pass rather than walk it.
+ */
+
+#ifndef SPATIAL_FROZEN_LAYOUT_HPP
+#define SPATIAL_FROZEN_LAYOUT_HPP
+
+#include <algorithm> // std::nth_element
+#include <vector>
+
+#include "spatial_rank.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    //! Returns the index given to missing nodes by the frozen layouts.
+    inline size_type
+    frozen_npos()
+    { return static_cast<size_type>(-1); }
+
+    /**
+     *  Returns the number of nodes on the left of the root of a left-complete
+     *  binary tree of \c count nodes.
+     */
+    inline size_type
+    complete_left_count(size_type count)
+    {
+      if (count < 2) return 0;
+      size_type height = 0;
+      while ((static_cast<size_type>(2) << height) <= count) ++height;
+      size_type full = (static_cast<size_type>(1) << height) - 1;
+      size_type half = static_cast<size_type>(1) << (height - 1);
+      size_type last = count - full;
+      return (full - 1) / 2 + (last < half ? last : half);
+    }
+
+    /**
+     *  Lays out a left-complete tree in breadth-first order: the children of
+     *  the node at index \c i are found at \c 2i+1 and \c 2i+2.
+     */
+    class Breadth_first_layout
+    {
+    public:
+      Breadth_first_layout()
+        : _count(0), _leftmost(0), _rightmost(0) { }
+
+      static size_type signature() { return 0; }
+
+      void
+      reset(size_type count)
+      {
+        _count = count;
+        size_type i = 0;
+        while (2 * i + 1 < count) i = 2 * i + 1;
+        _leftmost = i;
+        i = 0;
+        while (2 * i + 2 < count) i = 2 * i + 2;
+        _rightmost = i;
+      }
+
+      size_type leftmost() const { return _leftmost; }
+
+      size_type rightmost() const { return _rightmost; }
+
+      void
+      links(size_type i, size_type& parent, size_type& left,
+            size_type& right) const
+      {
+        parent = (i == 0) ? _count : (i - 1) / 2;
+        left = (2 * i + 1 < _count) ? 2 * i + 1 : frozen_npos();
+        right = (2 * i + 2 < _count) ? 2 * i + 2 : frozen_npos();
+      }
+
+      dimension_type
+      depth(size_type i) const
+      {
+        dimension_type depth = 0;
+        for (++i; i > 1; i >>= 1) ++depth;
+        return depth;
+      }
+
+      bool
+      bucket(size_type, size_type&, size_type&) const
+      { return false; }
+
+      template <typename Rank, typename Less, typename Pointer>
+      void
+      order(const Rank& rank, Less less, std::vector<Pointer>& values,
+            std::vector<Pointer>& slots) const
+      {
+        slots.resize(values.size());
+        place(rank, less, values.begin(), values.end(), 0, 0, slots.begin());
+      }
+
+      /**
+       *  Place the values of \c [first, last) in the left-complete sub-tree
+       *  rooted at \c out[slot], splitting them along \c dim first.
+       */
+      template <typename Rank, typename Less, typename Iterator,
+                typename Output>
+      static void
+      place(const Rank& rank, Less less, Iterator first, Iterator last,
+            dimension_type dim, size_type slot, Output out)
+      {
+        while (first != last)
+          {
+            Iterator med = first + complete_left_count
+              (static_cast<size_type>(last - first));
+            less.dimension = dim;
+            std::nth_element(first, med, last, less);
+            out[slot] = *med;
+            dim = incr_dim(rank, dim);
+            if (med + 1 != last)
+              { place(rank, less, med + 1, last, dim, 2 * slot + 2, out); }
+            last = med;
+            slot = 2 * slot + 1;
+          }
+      }
+
+    private:
+
+      size_type _count;
+      size_type _leftmost;
+      size_type _rightmost;
+    };
+
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_FROZEN_LAYOUT_HPP
@@ -0,0 +1,26 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file spatial_import_thread.hpp Contains the macro that tells whether
+ *  std::thread can be used by the library.
+ *
+ *  Threads are only available from C++11 onward. MSVC does not update
+ *  __cplusplus by default, so its version is checked separately. Define
+ *  SPATIAL_NO_THREAD to keep every algorithm of the library single threaded.
+ */
+
+#ifndef SPATIAL_IMPORT_THREAD
+#define SPATIAL_IMPORT_THREAD
+
+#if !defined(SPATIAL_NO_THREAD)                                         \
+  && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+#  include <thread>
+#  define SPATIAL_THREAD 1
+#endif
+
+#endif // SPATIAL_IMPORT_THREAD
@@ -23,7 +23,8 @@
 #  undef SPATIAL_TYPE_TRAITS_NAMESPACE
 #endif
 
-#if defined(__LIBCPP_VERSION) || __cplusplus >= 201103L
+#if defined(_LIBCPP_VERSION) || __cplusplus >= 201103L                  \
+  || (defined(_MSC_VER) && _MSC_VER >= 1900)
 #  include <type_traits>
 #  define SPATIAL_TYPE_TRAITS_NAMESPACE std
 #elif defined(__GLIBCXX__)
@@ -41,11 +42,18 @@ namespace spatial
 {
   namespace import
   {
+    using SPATIAL_TYPE_TRAITS_NAMESPACE::alignment_of;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::is_arithmetic;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::is_empty;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::is_floating_point;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::true_type;
     using SPATIAL_TYPE_TRAITS_NAMESPACE::false_type;
+#if defined(_LIBCPP_VERSION) || __cplusplus >= 201103L                  \
+  || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#  define SPATIAL_TYPE_TRAITS_TRIVIAL 1
+    using std::is_trivially_copy_constructible;
+    using std::is_trivially_destructible;
+#endif
   }
 }
 
@@ -0,0 +1,275 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_index_node.hpp
+ *  Defines a node handle for trees that store their nodes in arrays and link
+ *  them by index rather than by pointer.
+ *
+ *  The iterators of the library walk the tree through node pointers only:
+ *  they read \c node->parent, \c node->left and \c node->right, compare
+ *  nodes with 0 and call header(), const_key() or value() on them. The \ref
+ *  Index_node_ptr provides all of these operations for a node that is an
+ *  index in a tree, so that every iterator of the library can walk such
+ *  trees without modification.
+ *
+ *  A tree using this handle must provide the following members, where \c i
+ *  is an index and \c npos is \ref Index_node_ptr::npos():
+ *
+ *  \code
+ *  typedef ... key_type;
+ *  typedef ... link_value_type;      // the type of a value, const if read-only
+ *  typedef ... invariant_category;
+ *  size_type header_index() const;   // index of the header node
+ *  void links(size_type i, size_type& parent, size_type& left,
+ *             size_type& right) const; // npos for missing children
+ *  const key_type& key(size_type i) const;
+ *  link_value_type& value(size_type i) const;
+ *  template <typename Rank>
+ *  dimension_type modulo(size_type i, Rank r) const;
+ *  bool bucket(size_type i, size_type& first,
+ *              size_type& last) const; // see index_bucket()
+ *  \endcode
+ *
+ *  The links of the header node follow the convention of \ref Node: its
+ *  parent is the root, its left is itself and its right is the right most
+ *  node.
+ */
+
+#ifndef SPATIAL_INDEX_NODE_HPP
+#define SPATIAL_INDEX_NODE_HPP
+
+#include "../spatial.hpp"
+#include "spatial_assert.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  An incomplete type. The literal 0, used in the iterators to create or
+     *  compare to a null node, converts to a pointer to this type.
+     */
+    struct Index_null;
+
+    template <typename Tree> struct Index_links;
+
+    /**
+     *  A handle on a node of a \c Tree that addresses its nodes by index. It
+     *  behaves like a node pointer for all the algorithms of the library.
+     *
+     *  \tparam Tree The tree type, const-qualified when the handle gives read
+     *  only access to the values.
+     */
+    template <typename Tree>
+    struct Index_node_ptr
+    {
+      //! The value of \c index for a null handle.
+      static size_type npos() { return static_cast<size_type>(-1); }
+
+      //! Build a null handle.
+      Index_node_ptr() : tree(0), index(npos()) { }
+
+      //! Build a null handle from the literal 0.
+      Index_node_ptr(Index_null*) : tree(0), index(npos()) { }
+
+      //! Build a handle on the node at \c index_ in \c tree_.
+      Index_node_ptr(Tree* tree_, size_type index_)
+        : tree(tree_), index(index_) { }
+
+      //! Convert a mutable handle into a constant one.
+      template <typename Other>
+      Index_node_ptr(const Index_node_ptr<Other>& other)
+        : tree(other.tree), index(other.index) { }
+
+      //! Access the parent, left and right nodes of the node.
+      Index_links<Tree> operator->() const
+      { return Index_links<Tree>(*this); }
+
+      friend bool
+      operator==(const Index_node_ptr& x, const Index_node_ptr& y)
+      { return x.index == y.index; }
+
+      friend bool
+      operator!=(const Index_node_ptr& x, const Index_node_ptr& y)
+      { return x.index != y.index; }
+
+      Tree* tree;
+      size_type index;
+    };
+
+    /**
+     *  Compare a mutable handle with a constant one, as the iterators of
+     *  mutable trees do.
+     */
+    ///@{
+    template <typename Tree1, typename Tree2>
+    inline bool
+    operator==(const Index_node_ptr<Tree1>& x, const Index_node_ptr<Tree2>& y)
+    { return x.index == y.index; }
+
+    template <typename Tree1, typename Tree2>
+    inline bool
+    operator!=(const Index_node_ptr<Tree1>& x, const Index_node_ptr<Tree2>& y)
+    { return x.index != y.index; }
+    ///@}
+
+    /**
+     *  The links of a node, resolved from the tree when the node is
+     *  dereferenced. Only lives for the duration of the expression
+     *  <tt>node->left</tt>, <tt>node->right</tt> or <tt>node->parent</tt>.
+     */
+    template <typename Tree>
+    struct Index_links
+    {
+      explicit Index_links(const Index_node_ptr<Tree>& x)
+        : parent(x.tree, 0), left(x.tree, 0), right(x.tree, 0)
+      { x.tree->links(x.index, parent.index, left.index, right.index); }
+
+      const Index_links* operator->() const { return this; }
+
+      Index_node_ptr<Tree> parent;
+      Index_node_ptr<Tree> left;
+      Index_node_ptr<Tree> right;
+    };
+
+    /**
+     *  The \linkmode of trees addressing their nodes with an \ref
+     *  Index_node_ptr.
+     */
+    template <typename Tree>
+    struct Index_link
+    {
+      typedef typename Tree::key_type                    key_type;
+      typedef typename Tree::link_value_type             value_type;
+      typedef Index_node_ptr<Tree>                       node_ptr;
+      typedef Index_node_ptr<const Tree>                 const_node_ptr;
+      typedef typename Tree::invariant_category          invariant_category;
+    };
+
+    template <typename Tree>
+    inline bool header(const Index_node_ptr<Tree>& x)
+    { return x.index == x.tree->header_index(); }
+
+    template <typename Tree>
+    inline const typename Tree::key_type&
+    const_key(const Index_node_ptr<Tree>& x)
+    { return x.tree->key(x.index); }
+
+    template <typename Tree>
+    inline typename Tree::link_value_type&
+    value(const Index_node_ptr<Tree>& x)
+    { return x.tree->value(x.index); }
+
+    template <typename Tree>
+    inline const typename Tree::link_value_type&
+    const_value(const Index_node_ptr<Tree>& x)
+    { return x.tree->value(x.index); }
+
+    template <typename Tree>
+    inline typename Tree::invariant_category
+    invariant_category(const Index_node_ptr<Tree>&)
+    { return typename Tree::invariant_category(); }
+
+    /**
+     *  Returns the dimension of the node \c x, which the tree can usually
+     *  compute without walking up to the header.
+     */
+    template <typename Tree, typename Rank>
+    inline dimension_type
+    modulo(const Index_node_ptr<Tree>& x, Rank r)
+    { return x.tree->modulo(x.index, r); }
+
+    /**
+     *  Returns true if the sub-tree rooted at \c x is stored in the indices
+     *  \c [first, last) of its tree, with its keys next to each other.
+     */
+    template <typename Tree>
+    inline bool
+    index_bucket(const Index_node_ptr<Tree>& x, size_type& first,
+                 size_type& last)
+    { return x.tree->bucket(x.index, first, last); }
+
+    template <typename Tree>
+    inline Index_node_ptr<Tree>
+    minimum(Index_node_ptr<Tree> x)
+    {
+      SPATIAL_ASSERT_CHECK(!header(x));
+      while (x->left != 0) { x = x->left; }
+      return x;
+    }
+
+    template <typename Tree>
+    inline Index_node_ptr<Tree>
+    maximum(Index_node_ptr<Tree> x)
+    {
+      SPATIAL_ASSERT_CHECK(!header(x));
+      while (x->right != 0) { x = x->right; }
+      return x;
+    }
+
+    template <typename Tree>
+    inline Index_node_ptr<Tree>
+    increment(Index_node_ptr<Tree> x)
+    {
+      SPATIAL_ASSERT_CHECK(!header(x));
+      if (x->right != 0)
+        {
+          x = x->right;
+          while (x->left != 0) { x = x->left; }
+        }
+      else
+        {
+          Index_node_ptr<Tree> p = x->parent;
+          while (!header(p) && x == p->right)
+            { x = p; p = x->parent; }
+          x = p;
+        }
+      return x;
+    }
+
+    template <typename Tree>
+    inline Index_node_ptr<Tree>
+    decrement(Index_node_ptr<Tree> x)
+    {
+      if (header(x)) { return x->right; } // right most node at header
+      if (x->left != 0)
+        {
+          x = x->left;
+          while (x->right != 0) { x = x->right; }
+        }
+      else
+        {
+          Index_node_ptr<Tree> p = x->parent;
+          while (!header(p) && x == p->left)
+            { x = p; p = x->parent; }
+          x = p;
+        }
+      return x;
+    }
+
+    template <typename Tree>
+    inline Index_node_ptr<Tree>
+    preorder_increment(Index_node_ptr<Tree> x)
+    {
+      if (x->left != 0) { x = x->left; }
+      else if (x->right != 0) { x = x->right; }
+      else
+        {
+          Index_node_ptr<Tree> p = x->parent;
+          while (!header(p) && (x == p->right || p->right == 0))
+            { x = p; p = x->parent; }
+          x = p;
+          if (!header(p)) { x = x->right; }
+        }
+      return x;
+    }
+
+  } // namespace details
+} // namespace spatial
+
+#endif // SPATIAL_INDEX_NODE_HPP
@@ -30,6 +30,7 @@
 #include "spatial_value_compare.hpp"
 #include "spatial_template_member_swap.hpp"
 #include "spatial_assert.hpp"
+#include "spatial_stats.hpp"
 #include "spatial_except.hpp"
 
 namespace spatial
@@ -502,6 +503,7 @@ namespace spatial
       iterator
       insert(const value_type& value)
       {
+        SPATIAL_STATS_COUNT(inserts);
         return insert_node(create_node(value));
       }
 
@@ -883,18 +885,6 @@ namespace spatial
       SPATIAL_ASSERT_INVARIANT(*this);
     }
 
-    template <typename InputIterator>
-    inline std::ptrdiff_t
-    random_access_iterator_distance
-    (InputIterator first, InputIterator last, std::random_access_iterator_tag)
-    { return last - first; }
-
-    template <typename InputIterator>
-    inline std::ptrdiff_t
-    random_access_iterator_distance
-    (InputIterator, InputIterator, std::input_iterator_tag)
-    { return 0; }
-
     template <typename Rank, typename Key, typename Value, typename Compare,
               typename Alloc>
     template <typename InputIterator>
@@ -912,7 +902,10 @@ namespace spatial
       try
         {
           for(InputIterator i = first; i != last; ++i)
-            { ptr_store.push_back(create_node(*i)); } // may throw
+            {
+              ptr_store.push_back(create_node(*i)); // may throw
+              SPATIAL_STATS_COUNT(inserts);
+            }
         }
       catch (...)
         {
@@ -921,6 +914,7 @@ namespace spatial
             { destroy_node(*i); }
           throw;
         }
+      SPATIAL_STATS_COUNT(rebalances);
       for(iterator i = begin(); i != end(); ++i)
         { ptr_store.push_back(i.node); }
       set_root(rebalance_node_insert(ptr_store.begin(), ptr_store.end(), 0,
@@ -945,6 +939,7 @@ namespace spatial
       if (empty()) return;
       std::vector<node_ptr> ptr_store;
       ptr_store.reserve(size()); // may throw
+      SPATIAL_STATS_COUNT(rebalances);
       for(iterator i = begin(); i != end(); ++i)
         { ptr_store.push_back(i.node); }
       set_root(rebalance_node_insert(ptr_store.begin(), ptr_store.end(), 0,
@@ -960,22 +955,6 @@ namespace spatial
       SPATIAL_ASSERT_INVARIANT(*this);
     }
 
-    template<typename Compare, typename Node_ptr>
-    struct mapping_compare
-    {
-      Compare compare;
-      dimension_type dimension;
-
-      mapping_compare(const Compare& c, dimension_type d)
-        : compare(c), dimension(d) { }
-
-      bool
-      operator() (const Node_ptr& x, const Node_ptr& y) const
-      {
-        return compare(dimension, const_key(x), const_key(y));
-      }
-    };
-
     template <typename Rank, typename Key, typename Value, typename Compare,
               typename Alloc>
     inline typename
@@ -1127,6 +1106,7 @@ namespace spatial
       SPATIAL_ASSERT_CHECK((get_header() == get_root())
                            ? (_impl._count() == 0) : true);
       destroy_node(node);
+      SPATIAL_STATS_COUNT(erases);
       SPATIAL_ASSERT_INVARIANT(*this);
       return first_swap;
     }
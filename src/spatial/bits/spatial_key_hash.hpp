@@ -0,0 +1,393 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_key_hash.hpp
+ *  Provides key_index, a hash table over the elements of a container that
+ *  finds them by key in constant time, and the hash of the keys of the
+ *  containers using a built-in comparator.
+ */
+
+#ifndef SPATIAL_KEY_HASH_HPP
+#define SPATIAL_KEY_HASH_HPP
+
+#include <cstring>   // std::memcpy
+#include <iterator>  // std::iterator_traits, std::forward_iterator_tag
+#include <stdexcept> // std::length_error
+#include <utility>   // std::pair
+#include <vector>
+
+#include "../traits.hpp"
+#include "spatial_node.hpp"
+#include "spatial_builtin.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Spreads the bits of \c h over all the bits of the result, so that the
+     *  low bits used to pick a slot depend on all of them.
+     */
+    inline size_type
+    hash_mix(size_type h)
+    {
+      h ^= (h >> 16) >> 16; // folds the upper half of 64 bits integers
+      h *= static_cast<size_type>(0x85ebca6bu);
+      h ^= h >> 13;
+      h *= static_cast<size_type>(0xc2b2ae35u);
+      h ^= h >> 16;
+      return h;
+    }
+
+    /**
+     *  Hashes the keys of a container using one of the built-in comparators,
+     *  from their coordinates as read by the comparator. Keys that the
+     *  comparator finds equal on every dimension have the same hash.
+     */
+    template <typename Ct>
+    struct Builtin_key_hash
+    {
+      typedef typename container_traits<Ct>::key_type key_type;
+      typedef typename container_traits<Ct>::key_compare key_compare;
+      typedef typename container_traits<Ct>::rank_type rank_type;
+
+      explicit Builtin_key_hash(const Ct& container)
+        : rank(container.rank()), compare(container.key_comp()) { }
+
+      size_type
+      operator()(const key_type& key) const
+      {
+        size_type h = 0;
+        for (dimension_type d = 0; d < rank(); ++d)
+          {
+            double c = builtin_coordinate(compare, d, key);
+            if (c == 0.0) c = 0.0; // -0.0 and 0.0 are the same coordinate
+            size_type word[sizeof(double) / sizeof(size_type)];
+            std::memcpy(word, &c, sizeof(word));
+            for (size_type i = 0; i < sizeof(word) / sizeof(size_type); ++i)
+              { h = hash_mix(h ^ word[i]); }
+          }
+        return h;
+      }
+
+      rank_type rank;
+      key_compare compare;
+    };
+  } // namespace details
+
+  /**
+   *  An index of the elements of a container by key, held beside the
+   *  container, that finds elements by key in constant expected time instead
+   *  of searching the tree. The container keeps all of its other queries.
+   *
+   *  The index is an open addressing hash table of iterators on the
+   *  container, with linear probing, kept at most half full. Keys are
+   *  compared with the comparator of the container: two keys are equal when
+   *  none is less than the other on any dimension.
+   *
+   *  The index is kept up to date when the container is modified through
+   *  insert() and erase() below, which are available for the containers
+   *  whose iterators stay valid after other elements are inserted or erased:
+   *  all the containers but the \c frozen_ containers. After the container
+   *  is modified in any other way, call rebuild().
+   *  \code
+   *  typedef frozen_point_multimap<2, point, tile> container_type;
+   *  container_type tiles(first, last);
+   *  key_index<container_type> by_position(tiles);
+   *  container_type::iterator i = by_position.find(p);
+   *  \endcode
+   *
+   *  \tparam Ct The type of container indexed, not constant.
+   *  \tparam Hash A functor returning a \c size_type for a key, the same for
+   *  all the keys that the container finds equal. It defaults to a hash of
+   *  the coordinates of the keys, for the containers using a built-in
+   *  comparator.
+   */
+  template <typename Ct, typename Hash = details::Builtin_key_hash<Ct> >
+  class key_index
+  {
+  public:
+    typedef typename container_traits<Ct>::key_type       key_type;
+    typedef typename container_traits<Ct>::value_type     value_type;
+    typedef typename container_traits<Ct>::iterator       iterator;
+    typedef Hash                                          hasher;
+
+    /**
+     *  Walks the elements of the container equal to a key, as found by
+     *  equal_range().
+     */
+    class local_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag                   iterator_category;
+      typedef typename container_traits<Ct>::value_type   value_type;
+      typedef typename std::iterator_traits<iterator>::reference reference;
+      typedef typename std::iterator_traits<iterator>::pointer   pointer;
+      typedef std::ptrdiff_t                              difference_type;
+
+      //! Uninitialized iterator.
+      local_iterator() { }
+
+      reference operator*() const
+      { iterator i = base(); return *i; }
+
+      pointer operator->() const
+      { iterator i = base(); return &*i; }
+
+      //! The iterator on the element in the container.
+      iterator base() const { return _index->_slots[_slot].position; }
+
+      local_iterator& operator++()
+      { _slot = _index->next_equal(_slot + 1, *_key, _hash); return *this; }
+
+      local_iterator operator++(int)
+      { local_iterator x(*this); ++*this; return x; }
+
+      friend bool
+      operator==(const local_iterator& x, const local_iterator& y)
+      { return x._slot == y._slot; }
+
+      friend bool
+      operator!=(const local_iterator& x, const local_iterator& y)
+      { return x._slot != y._slot; }
+
+    private:
+      friend class key_index;
+
+      local_iterator(const key_index* index, size_type slot,
+                     const key_type* key, size_type hash)
+        : _index(index), _slot(slot), _key(key), _hash(hash) { }
+
+      const key_index* _index;
+      size_type _slot;
+      const key_type* _key;
+      size_type _hash;
+    };
+
+    /**
+     *  Indexes all the elements of \c container. The hash functor is built
+     *  from the container, as the default hash is.
+     */
+    explicit key_index(Ct& container)
+      : _slots(), _size(0), _container(&container), _hash(container)
+    { rebuild(); }
+
+    //! Indexes all the elements of \c container, hashing keys with \c hash.
+    key_index(Ct& container, const Hash& hash)
+      : _slots(), _size(0), _container(&container), _hash(hash)
+    { rebuild(); }
+
+    //! Indexes all the elements of the container again.
+    void
+    rebuild()
+    {
+      _slots.clear();
+      _size = 0;
+      resize(_container->size());
+      for (iterator i = _container->begin(); i != _container->end(); ++i)
+        { add(i); }
+    }
+
+    //! The number of elements indexed.
+    size_type size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+    hasher hash_function() const { return _hash; }
+
+    /**
+     *  Returns an iterator on an element of the container equal to \c key,
+     *  or the end of the container if there is none.
+     */
+    iterator
+    find(const key_type& key) const
+    {
+      size_type hash = _hash(key);
+      size_type slot = next_equal(hash & mask(), key, hash);
+      return slot == _slots.size() ? _container->end()
+        : _slots[slot].position;
+    }
+
+    //! Returns the number of elements of the container equal to \c key.
+    size_type
+    count(const key_type& key) const
+    {
+      size_type n = 0;
+      std::pair<local_iterator, local_iterator> range = equal_range(key);
+      for (; range.first != range.second; ++range.first) { ++n; }
+      return n;
+    }
+
+    /**
+     *  Returns the range of the elements of the container equal to \c key,
+     *  in no particular order. \c key must outlive the range.
+     */
+    std::pair<local_iterator, local_iterator>
+    equal_range(const key_type& key) const
+    {
+      size_type hash = _hash(key);
+      return std::make_pair
+        (local_iterator(this, next_equal(hash & mask(), key, hash), &key,
+                        hash),
+         local_iterator(this, _slots.size(), &key, hash));
+    }
+
+    /**
+     *  Inserts \c value in the container and in the index, and returns an
+     *  iterator on the new element.
+     */
+    iterator
+    insert(const value_type& value)
+    {
+      iterator i = _container->insert(value);
+      if (2 * (_size + 1) > _slots.size()) resize(_size + 1);
+      add(i);
+      return i;
+    }
+
+    //! Erases the element at \c position from the index and the container.
+    void
+    erase(iterator position)
+    {
+      remove(position);
+      _container->erase(position);
+    }
+
+    /**
+     *  Erases all the elements equal to \c key from the index and the
+     *  container, and returns their number.
+     */
+    size_type
+    erase(const key_type& key)
+    {
+      size_type n = 0;
+      for (iterator i = find(key); i != _container->end(); i = find(key))
+        { erase(i); ++n; }
+      return n;
+    }
+
+  private:
+    friend class local_iterator;
+
+    //! A slot of the table, empty when it holds the end of the container.
+    struct Slot
+    {
+      iterator position;
+      size_type hash;
+    };
+
+    size_type mask() const { return _slots.size() - 1; }
+
+    bool
+    used(size_type slot) const
+    { return _slots[slot].position != _container->end(); }
+
+    bool
+    equal_key(const key_type& a, const key_type& b) const
+    {
+      typename container_traits<Ct>::key_compare compare
+        = _container->key_comp();
+      for (dimension_type d = 0; d < _container->dimension(); ++d)
+        { if (compare(d, a, b) || compare(d, b, a)) return false; }
+      return true;
+    }
+
+    /**
+     *  Returns the first slot from \c slot on, up to the end of its cluster,
+     *  holding an element equal to \c key, or the number of slots.
+     */
+    size_type
+    next_equal(size_type slot, const key_type& key, size_type hash) const
+    {
+      if (_slots.empty()) return 0;
+      for (slot &= mask(); used(slot); slot = (slot + 1) & mask())
+        {
+          const Slot& s = _slots[slot];
+          if (s.hash == hash && equal_key(const_key(s.position.node), key))
+            { return slot; }
+        }
+      return _slots.size();
+    }
+
+    //! Adds \c position to the table, which has room for it.
+    void
+    add(iterator position)
+    { add(position, _hash(const_key(position.node))); }
+
+    void
+    add(iterator position, size_type hash)
+    {
+      size_type slot = hash & mask();
+      while (used(slot)) { slot = (slot + 1) & mask(); }
+      _slots[slot].position = position;
+      _slots[slot].hash = hash;
+      ++_size;
+    }
+
+    /**
+     *  Removes \c position from the table, shifting back the elements of the
+     *  cluster that follow, so that no probe sequence is broken.
+     */
+    void
+    remove(iterator position)
+    {
+      if (_slots.empty()) return;
+      size_type hole = _slots.size();
+      for (size_type slot = _hash(const_key(position.node)) & mask();
+           used(slot); slot = (slot + 1) & mask())
+        {
+          if (_slots[slot].position == position) { hole = slot; break; }
+        }
+      if (hole == _slots.size()) return;
+      for (size_type slot = (hole + 1) & mask(); used(slot);
+           slot = (slot + 1) & mask())
+        {
+          size_type home = _slots[slot].hash & mask();
+          // Move the element back unless its home is between the hole and
+          // its slot, going around the end of the table.
+          if (hole <= slot ? (home <= hole || home > slot)
+              : (home <= hole && home > slot))
+            { _slots[hole] = _slots[slot]; hole = slot; }
+        }
+      _slots[hole].position = _container->end();
+      --_size;
+    }
+
+    /**
+     *  Makes room for \c n elements in total, rehashing the elements in the
+     *  table. The table is kept at most half full.
+     */
+    void
+    resize(size_type n)
+    {
+      size_type capacity = 16;
+      while (capacity < 2 * n) { capacity *= 2; }
+      if (capacity <= _slots.size()) return;
+      if (capacity > _slots.max_size())
+        { throw std::length_error("key_index::resize"); }
+      std::vector<Slot> slots;
+      slots.swap(_slots);
+      Slot empty;
+      empty.position = _container->end();
+      empty.hash = 0;
+      _slots.assign(capacity, empty);
+      _size = 0;
+      for (typename std::vector<Slot>::const_iterator i = slots.begin();
+           i != slots.end(); ++i)
+        { if (i->position != _container->end()) add(i->position, i->hash); }
+    }
+
+    std::vector<Slot> _slots;
+    size_type _size;
+    Ct* _container;
+    Hash _hash;
+  };
+
+} // namespace spatial
+
+#endif // SPATIAL_KEY_HASH_HPP
@@ -0,0 +1,428 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_knn.hpp
+ *  Provides the k-nearest neighbor searches and all the functions around
+ *  them.
+ */
+
+#ifndef SPATIAL_KNN_HPP
+#define SPATIAL_KNN_HPP
+
+#include <algorithm> // std::push_heap, std::pop_heap, std::sort_heap
+#include <iterator>  // std::iterator_traits
+#include <utility>   // std::pair
+
+#include "spatial_import_tuple.hpp"
+#include "../metric.hpp"
+#include "../traits.hpp"
+#include "spatial_node.hpp"
+#include "spatial_index_node.hpp"
+#include "spatial_distance_kernel.hpp"
+#include "spatial_assert.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    //! Orders the results of a k-nearest search by distance only.
+    struct Knn_closer
+    {
+      template <typename Result>
+      bool
+      operator()(const Result& x, const Result& y) const
+      { return x.first < y.first; }
+    };
+
+    /**
+     *  The state of a k-nearest search: the heap of the best results so far,
+     *  stored in the caller's storage, with the furthest of them on top.
+     */
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename RandomAccessIterator>
+    struct Knn_data
+    {
+      Knn_data(const Ct& container_, const Metric& metric_,
+               const typename container_traits<Ct>::key_type& target_,
+               size_type k_, RandomAccessIterator heap_)
+        : rank(container_.rank()), key_comp(container_.key_comp()),
+          metric(metric_), target(target_), k(k_), heap(heap_), count(0),
+          seeded(false) { }
+
+      typename container_traits<Ct>::rank_type rank;
+      typename container_traits<Ct>::key_compare key_comp;
+      const Metric& metric;
+      typename container_traits<Ct>::key_type target;
+      size_type k;
+      RandomAccessIterator heap;
+      size_type count;
+
+      /**
+       *  True when the heap was filled with results of another search, that
+       *  may be found again during this one.
+       */
+      bool seeded;
+    };
+
+    /**
+     *  Offers the node \c x at \c distance to the heap of \c data, and keep
+     *  it if it is among the \c k closest seen so far.
+     */
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename RandomAccessIterator>
+    inline void
+    knn_offer(Knn_data<Ct, Metric, NodePtr, RandomAccessIterator>& data,
+              NodePtr x, typename Metric::distance_type distance)
+    {
+      typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+        result_type;
+      if (data.count == data.k)
+        {
+          if (!(distance < data.heap->first)) return;
+          if (data.seeded)
+            {
+              for (size_type i = 0; i < data.count; ++i)
+                { if (data.heap[i].second.node == x) return; }
+            }
+          std::pop_heap(data.heap, data.heap + data.count, Knn_closer());
+          --data.count;
+        }
+      data.heap[data.count] = result_type
+        (distance, typename result_type::second_type(x));
+      ++data.count;
+      std::push_heap(data.heap, data.heap + data.count, Knn_closer());
+    }
+
+    /**
+     *  Offers all the nodes of the sub-tree under \c node at once, if they
+     *  are stored next to each other, and returns true in that case. Nodes
+     *  linked by pointers never are.
+     */
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename RandomAccessIterator>
+    inline bool
+    knn_leaf(NodePtr,
+             Knn_data<Ct, Metric, NodePtr, RandomAccessIterator>&)
+    { return false; }
+
+    /**
+     *  Offers all the nodes of a bucket, whose distances are computed a
+     *  block at a time by the kernels of spatial_distance_kernel.hpp. This
+     *  is faster than walking down the few levels of the bucket and pruning
+     *  its branches.
+     */
+    template <typename Ct, typename Metric, typename Tree,
+              typename RandomAccessIterator>
+    inline bool
+    knn_leaf(Index_node_ptr<Tree> node,
+             Knn_data<Ct, Metric, Index_node_ptr<Tree>, RandomAccessIterator>&
+             data)
+    {
+      size_type first, last;
+      if (!index_bucket(node, first, last)) return false;
+      const size_type block = static_cast<size_type>(block_size);
+      typename Metric::distance_type distance[block_size];
+      for (; first < last; first += block)
+        {
+          size_type n = (last - first < block) ? last - first : block;
+          block_distance(data.metric, data.rank, data.target,
+                         &node.tree->key(first), n, distance);
+          SPATIAL_STATS_ADD(nodes_visited, n);
+          SPATIAL_STATS_ADD(distance_evaluations, n);
+          for (size_type i = 0; i < n; ++i)
+            {
+              knn_offer(data, Index_node_ptr<Tree>(node.tree, first + i),
+                        distance[i]);
+            }
+        }
+      return true;
+    }
+
+    /**
+     *  Searches the sub-tree under \c node, near side first, and only walks
+     *  into the far side of a node when it may hold a closer node than the
+     *  furthest of the \c k found so far.
+     */
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename RandomAccessIterator>
+    inline void
+    knn_sub(NodePtr node, dimension_type dim,
+            Knn_data<Ct, Metric, NodePtr, RandomAccessIterator>& data)
+    {
+      SPATIAL_ASSERT_CHECK(dim < data.rank());
+      SPATIAL_ASSERT_CHECK(node != 0);
+      SPATIAL_ASSERT_CHECK(!header(node));
+      for (;;)
+        {
+          if (knn_leaf(node, data)) return;
+          const typename container_traits<Ct>::key_type& key
+            = const_key(node);
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
+          knn_offer(data, node, data.metric.distance_to_key
+                    (data.rank(), data.target, key));
+          NodePtr near, far;
+          import::tie(near, far)
+            = data.key_comp(dim, key, data.target)
+            ? import::make_tuple(node->right, node->left)
+            : import::make_tuple(node->left, node->right);
+          dimension_type child_dim = incr_dim(data.rank, dim);
+          if (near != 0)
+            {
+              if (far == 0) { node = near; dim = child_dim; continue; }
+              SPATIAL_STATS_COUNT(backtracks);
+              knn_sub(near, child_dim, data);
+            }
+          if (far != 0
+              && (data.count < data.k
+                  || data.metric.distance_to_plane
+                  (data.rank(), dim, data.target, key)
+                  < data.heap->first))
+            { node = far; dim = child_dim; }
+          else return;
+        }
+    }
+
+    /**
+     *  Finds the \c k nearest neighbors of the target of \c data, and sorts
+     *  them from the closest to the furthest.
+     */
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename RandomAccessIterator>
+    inline RandomAccessIterator
+    knn_search(NodePtr root,
+               Knn_data<Ct, Metric, NodePtr, RandomAccessIterator>& data)
+    {
+      if (data.k != 0 && !header(root)) { knn_sub(root, 0, data); }
+      std::sort_heap(data.heap, data.heap + data.count, Knn_closer());
+      return data.heap + data.count;
+    }
+
+    template <typename Ct, typename Metric, typename NodePtr,
+              typename InputIterator, typename RandomAccessIterator>
+    inline size_type
+    knn_batch(const Ct& container, const Metric& metric, NodePtr root,
+              InputIterator target, InputIterator last, size_type k,
+              RandomAccessIterator first)
+    {
+      typedef typename std::iterator_traits<RandomAccessIterator>::value_type
+        result_type;
+      size_type count = 0;
+      for (RandomAccessIterator previous = first; target != last;
+           ++target, previous = first, first += k)
+        {
+          Knn_data<Ct, Metric, NodePtr, RandomAccessIterator>
+            data(container, metric, *target, k, first);
+          if (previous != first && count == k)
+            {
+              // The nearest neighbors of the previous target bound the
+              // search from the start when both targets are close.
+              for (; data.count < count; ++data.count)
+                {
+                  NodePtr x = previous[data.count].second.node;
+                  SPATIAL_STATS_COUNT(distance_evaluations);
+                  first[data.count] = result_type
+                    (metric.distance_to_key(data.rank(), data.target,
+                                            const_key(x)),
+                     previous[data.count].second);
+                }
+              std::make_heap(first, first + count, Knn_closer());
+              data.seeded = true;
+            }
+          count = knn_search(root, data) - first;
+        }
+      return count;
+    }
+  } // namespace details
+
+  /**
+   *  Finds the \c k nearest neighbors of \c target in \c container, according
+   *  to a user-defined \metric, and writes them from the closest to the
+   *  furthest in the storage starting at \c first.
+   *
+   *  The search walks the tree only once, keeping the best results found so
+   *  far in a heap laid out in the storage given, which must have room for
+   *  \c k results. No memory is allocated. This is much faster than
+   *  incrementing a \ref neighbor_iterator \c k times.
+   *
+   *  The value type of \c RandomAccessIterator must be a
+   *  <tt>std::pair<distance_type, iterator></tt>, where \c distance_type is
+   *  the distance type of \c Metric and \c iterator the iterator type of the
+   *  container: <tt>Ct::const_iterator</tt> when the container is constant.
+   *
+   *  \param container The container in which neighbors must be found.
+   *  \param metric The metric to use in search of the neighbors.
+   *  \param target The target key used in the neighbor search.
+   *  \param k The number of neighbors to find.
+   *  \param first The start of the storage receiving the results.
+   *  \return The end of the results, which are fewer than \c k only when the
+   *  container holds fewer than \c k elements.
+   */
+  ///@{
+  template <typename Ct, typename Metric, typename RandomAccessIterator>
+  inline RandomAccessIterator
+  knn(Ct& container, const Metric& metric,
+      const typename container_traits<Ct>::key_type& target,
+      size_type k, RandomAccessIterator first)
+  {
+    typedef typename container_traits<Ct>::iterator::node_ptr node_ptr;
+    node_ptr root = container.end().node->parent;
+    details::Knn_data<Ct, Metric, node_ptr, RandomAccessIterator>
+      data(container, metric, target, k, first);
+    return details::knn_search(root, data);
+  }
+
+  template <typename Ct, typename Metric, typename RandomAccessIterator>
+  inline RandomAccessIterator
+  knn(const Ct& container, const Metric& metric,
+      const typename container_traits<Ct>::key_type& target,
+      size_type k, RandomAccessIterator first)
+  {
+    typedef typename container_traits<Ct>::const_iterator::node_ptr node_ptr;
+    node_ptr root = container.end().node->parent;
+    details::Knn_data<Ct, Metric, node_ptr, RandomAccessIterator>
+      data(container, metric, target, k, first);
+    return details::knn_search(root, data);
+  }
+  ///@}
+
+  /**
+   *  Finds the \c k nearest neighbors of \c target in \c container, assuming
+   *  an euclidian metric with distances expressed in double. It requires
+   *  that the container used was defined with a built-in key compare
+   *  functor.
+   *
+   *  The value type of \c RandomAccessIterator must be a
+   *  <tt>std::pair<double, iterator></tt>.
+   *
+   *  \see knn(Ct&, const Metric&, const typename
+   *  container_traits<Ct>::key_type&, size_type, RandomAccessIterator)
+   */
+  ///@{
+  template <typename Ct, typename RandomAccessIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            RandomAccessIterator>::type
+  knn(Ct& container, const typename container_traits<Ct>::key_type& target,
+      size_type k, RandomAccessIterator first)
+  {
+    return knn
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, k, first);
+  }
+
+  template <typename Ct, typename RandomAccessIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            RandomAccessIterator>::type
+  knn(const Ct& container,
+      const typename container_traits<Ct>::key_type& target,
+      size_type k, RandomAccessIterator first)
+  {
+    return knn
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, k, first);
+  }
+  ///@}
+
+  /**
+   *  Finds the \c k nearest neighbors of each of the targets in \c
+   *  [target, last) according to a user-defined \metric. The results for
+   *  the n-th target are written from the closest to the furthest at \c
+   *  first + n * k, so the storage must have room for \c k results per
+   *  target.
+   *
+   *  Each search starts with the neighbors found for the previous target as
+   *  its first guess, which prunes most of the tree when the targets are
+   *  close to each other, and the nodes visited are still in cache. Give
+   *  the targets in an order that keeps consecutive targets close, for
+   *  instance grouped by squad, to get the most of it.
+   *
+   *  \param container The container in which neighbors must be found.
+   *  \param metric The metric to use in search of the neighbors.
+   *  \param target The first of the targets, a model of \c InputIterator.
+   *  \param last The end of the targets.
+   *  \param k The number of neighbors to find for each target.
+   *  \param first The start of the storage receiving the results.
+   *  \return The number of neighbors found for each target: \c k, or the
+   *  size of the container if it is smaller.
+   *  \see knn
+   */
+  ///@{
+  template <typename Ct, typename Metric, typename InputIterator,
+            typename RandomAccessIterator>
+  inline size_type
+  knn_batch(Ct& container, const Metric& metric, InputIterator target,
+            InputIterator last, size_type k, RandomAccessIterator first)
+  {
+    typedef typename container_traits<Ct>::iterator::node_ptr node_ptr;
+    node_ptr root = container.end().node->parent;
+    return details::knn_batch(container, metric, root, target, last, k,
+                              first);
+  }
+
+  template <typename Ct, typename Metric, typename InputIterator,
+            typename RandomAccessIterator>
+  inline size_type
+  knn_batch(const Ct& container, const Metric& metric, InputIterator target,
+            InputIterator last, size_type k, RandomAccessIterator first)
+  {
+    typedef typename container_traits<Ct>::const_iterator::node_ptr node_ptr;
+    node_ptr root = container.end().node->parent;
+    return details::knn_batch(container, metric, root, target, last, k,
+                              first);
+  }
+  ///@}
+
+  /**
+   *  Finds the \c k nearest neighbors of each of the targets in \c
+   *  [target, last), assuming an euclidian metric with distances expressed
+   *  in double. It requires that the container used was defined with a
+   *  built-in key compare functor.
+   *
+   *  \see knn_batch(Ct&, const Metric&, InputIterator, InputIterator,
+   *  size_type, RandomAccessIterator)
+   */
+  ///@{
+  template <typename Ct, typename InputIterator,
+            typename RandomAccessIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>, size_type>::type
+  knn_batch(Ct& container, InputIterator target, InputIterator last,
+            size_type k, RandomAccessIterator first)
+  {
+    return knn_batch
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, last, k, first);
+  }
+
+  template <typename Ct, typename InputIterator,
+            typename RandomAccessIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>, size_type>::type
+  knn_batch(const Ct& container, InputIterator target, InputIterator last,
+            size_type k, RandomAccessIterator first)
+  {
+    return knn_batch
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, last, k, first);
+  }
+  ///@}
+
+} // namespace spatial
+
+#endif // SPATIAL_KNN_HPP
@@ -0,0 +1,1154 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_morton.hpp
+ *  Defines a container of 2 dimensional keys with integer coordinates, kept
+ *  sorted by Morton code in a flat array, along with its region and neighbor
+ *  iterators.
+ *
+ *  The Morton code of a key interleaves the bits of its 2 coordinates: the
+ *  bits of the first coordinate go to the even bits of the code and the bits
+ *  of the second coordinate to the odd bits. Sorting the keys by code lays
+ *  them out along a Z-order curve, which keeps keys that are close in space
+ *  mostly close in the array.
+ *
+ *  A box of space covers a range of codes, from the code of its lower corner
+ *  to the code of its upper corner, but the range also holds codes of keys
+ *  outside of the box. When a region iterator meets such a code, it skips
+ *  straight to the next code in the box, given by morton_bigmin(), with a
+ *  binary search; and to the previous code in the box, given by
+ *  morton_litmax(), when it walks backward.
+ *
+ *  \see Morton_vector
+ */
+
+#ifndef SPATIAL_MORTON_HPP
+#define SPATIAL_MORTON_HPP
+
+#include <algorithm> // std::lower_bound, std::upper_bound, std::sort
+#include <cmath>     // std::sqrt
+#include <iterator>  // std::reverse_iterator, std::iterator_traits
+#include <stdexcept> // std::out_of_range
+#include <utility>   // std::pair
+#include <vector>
+
+#include "../function.hpp"
+#include "../traits.hpp"
+#include "spatial_rank.hpp"
+#include "spatial_builtin.hpp"
+#include "spatial_mutate.hpp"
+#include "spatial_value_compare.hpp"
+#include "spatial_except.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    //! The type of a Morton code, holding 2 coordinates of 16 bits.
+    typedef unsigned int morton_code;
+
+    //! The largest coordinate of a key held in a \ref Morton_vector.
+    enum { morton_coordinate_max = 0xffff };
+
+    //! Spreads the 16 lower bits of \c x over the even bits of a code.
+    inline morton_code
+    morton_spread(morton_code x)
+    {
+      x &= 0x0000ffffu;
+      x = (x | (x << 8)) & 0x00ff00ffu;
+      x = (x | (x << 4)) & 0x0f0f0f0fu;
+      x = (x | (x << 2)) & 0x33333333u;
+      x = (x | (x << 1)) & 0x55555555u;
+      return x;
+    }
+
+    //! Returns the Morton code of the coordinates \c x and \c y.
+    inline morton_code
+    morton_encode(morton_code x, morton_code y)
+    { return morton_spread(x) | (morton_spread(y) << 1); }
+
+    //! Returns true if \c z is in the box with corners \c zmin and \c zmax.
+    inline bool
+    morton_within(morton_code z, morton_code zmin, morton_code zmax)
+    {
+      // Masking a code keeps the order of the coordinate it holds
+      const morton_code x = 0x55555555u;
+      const morton_code y = 0xaaaaaaaau;
+      return (z & x) >= (zmin & x) && (z & x) <= (zmax & x)
+        && (z & y) >= (zmin & y) && (z & y) <= (zmax & y);
+    }
+
+    //! The bits lower than \c bit that hold the same coordinate as \c bit.
+    inline morton_code
+    morton_below(morton_code bit)
+    { return (bit & 0x55555555u ? 0x55555555u : 0xaaaaaaaau) & (bit - 1); }
+
+    /**
+     *  Returns the smallest code greater than \c z that is in the box with
+     *  corners \c zmin and \c zmax, as described by Tropf and Herzog. \c z
+     *  must be in <tt>[zmin, zmax]</tt> but outside of the box.
+     */
+    inline morton_code
+    morton_bigmin(morton_code z, morton_code zmin, morton_code zmax)
+    {
+      morton_code bigmin = 0;
+      for (morton_code bit = 0x80000000u; bit != 0; bit >>= 1)
+        {
+          switch (((z & bit) ? 4 : 0) | ((zmin & bit) ? 2 : 0)
+                  | ((zmax & bit) ? 1 : 0))
+            {
+            case 1: // 0 0 1: the box is split along this bit
+              bigmin = (zmin | bit) & ~morton_below(bit);
+              zmax = (zmax & ~bit) | morton_below(bit);
+              break;
+            case 3: return zmin; // 0 1 1: z is below the box
+            case 4: return bigmin; // 1 0 0: z is above the box
+            case 5: // 1 0 1: z is in the upper half of the box
+              zmin = (zmin | bit) & ~morton_below(bit);
+              break;
+            default: break; // bits are equal, 2 and 6 cannot happen
+            }
+        }
+      return bigmin;
+    }
+
+    /**
+     *  Returns the greatest code less than \c z that is in the box with
+     *  corners \c zmin and \c zmax. \c z must be in <tt>[zmin, zmax]</tt> but
+     *  outside of the box.
+     */
+    inline morton_code
+    morton_litmax(morton_code z, morton_code zmin, morton_code zmax)
+    {
+      morton_code litmax = 0;
+      for (morton_code bit = 0x80000000u; bit != 0; bit >>= 1)
+        {
+          switch (((z & bit) ? 4 : 0) | ((zmin & bit) ? 2 : 0)
+                  | ((zmax & bit) ? 1 : 0))
+            {
+            case 1: // 0 0 1: z is in the lower half of the box
+              zmax = (zmax & ~bit) | morton_below(bit);
+              break;
+            case 3: return litmax; // 0 1 1: z is below the box
+            case 4: return zmax; // 1 0 0: z is above the box
+            case 5: // 1 0 1: the box is split along this bit
+              litmax = (zmax & ~bit) | morton_below(bit);
+              zmin = (zmin | bit) & ~morton_below(bit);
+              break;
+            default: break; // bits are equal, 2 and 6 cannot happen
+            }
+        }
+      return litmax;
+    }
+
+    //! Clamps \c x to the coordinates of a \ref Morton_vector.
+    inline morton_code
+    morton_clamp(long x)
+    {
+      return x < 0 ? 0 : (x > morton_coordinate_max
+                          ? static_cast<morton_code>(morton_coordinate_max)
+                          : static_cast<morton_code>(x));
+    }
+
+    /**
+     *  Accessors for the keys of a \ref Morton_vector, when values are pairs
+     *  of a key and a mapped value.
+     */
+    template <typename Key, typename Value>
+    struct Morton_values
+    {
+      template <typename Compare>
+      struct compare
+      { typedef ValueCompare<typename mutate<Value>::type, Compare> type; };
+
+      template <typename Vector>
+      struct iterators
+      {
+        typedef typename Vector::iterator             iterator;
+        typedef typename Vector::const_iterator       const_iterator;
+      };
+
+      static const Key&
+      key_of(const Value& value) { return value.first; }
+    };
+
+    /**
+     *  Accessors for the keys of a \ref Morton_vector, when values are the
+     *  keys. The values cannot be modified through the iterators.
+     */
+    template <typename Key>
+    struct Morton_values<Key, Key>
+    {
+      template <typename Compare>
+      struct compare
+      { typedef Compare type; };
+
+      template <typename Vector>
+      struct iterators
+      {
+        typedef typename Vector::const_iterator       iterator;
+        typedef typename Vector::const_iterator       const_iterator;
+      };
+
+      static const Key&
+      key_of(const Key& value) { return value; }
+    };
+
+    /**
+     *  A container of 2 dimensional keys with integer coordinates in
+     *  <tt>[0, 65535]</tt>, kept sorted by Morton code in a single array,
+     *  used by morton_point_multiset and morton_point_multimap.
+     *
+     *  The codes of the keys are stored in an array of their own, next to the
+     *  array of values, so that searches only read the codes. The coordinates
+     *  are read with the accessor of \c Compare, which must be one of the
+     *  builtin comparators of the library.
+     *
+     *  Inserting a range of values sorts them and merges them with the values
+     *  of the container in a single pass, in linear time plus the time to
+     *  sort the range. Inserting or erasing a single value also moves all the
+     *  values after it, so the container suits data that is built in bulk and
+     *  changes slowly. Inserting or erasing values invalidates all iterators.
+     */
+    template <typename Key, typename Value, typename Compare, typename Alloc>
+    class Morton_vector
+    {
+      typedef Morton_vector<Key, Value, Compare, Alloc>   Self;
+      typedef Morton_values<Key, Value>                   Values;
+      typedef std::vector<typename mutate<Value>::type, Alloc>
+      Value_vector;
+      typedef std::vector
+      <morton_code, typename Alloc::template rebind<morton_code>::other>
+      Code_vector;
+
+    public:
+      // Container intrincsic types
+      typedef Static_rank<2>                              rank_type;
+      typedef typename mutate<Key>::type                  key_type;
+      typedef typename mutate<Value>::type                value_type;
+      typedef void                                        mode_type;
+      typedef Compare                                     key_compare;
+      typedef typename Values::template compare<Compare>::type
+      value_compare;
+      typedef Alloc                                       allocator_type;
+
+      // Container iterator related types
+      typedef typename Value_vector::pointer              pointer;
+      typedef typename Value_vector::const_pointer        const_pointer;
+      typedef typename Value_vector::reference            reference;
+      typedef typename Value_vector::const_reference      const_reference;
+      typedef typename Value_vector::size_type            size_type;
+      typedef typename Value_vector::difference_type      difference_type;
+      typedef typename Values::template iterators<Value_vector>::iterator
+      iterator;
+      typedef typename Values::template iterators<Value_vector>
+      ::const_iterator                                    const_iterator;
+      typedef std::reverse_iterator<iterator>             reverse_iterator;
+      typedef std::reverse_iterator<const_iterator>
+      const_reverse_iterator;
+
+      Morton_vector() : _compare(), _values(), _codes() { }
+
+      explicit Morton_vector(const key_compare& compare)
+        : _compare(compare), _values(), _codes()
+      { }
+
+      Morton_vector(const key_compare& compare, const allocator_type& alloc)
+        : _compare(compare), _values(alloc), _codes(alloc)
+      { }
+
+      Morton_vector(const Morton_vector& other)
+        : _compare(other._compare), _values(other._values),
+          _codes(other._codes)
+      { }
+
+      /**
+       *  Assignment of \c other into the container. Keys may be constant, so
+       *  the copy is built aside and swapped in.
+       */
+      Morton_vector&
+      operator=(const Morton_vector& other)
+      {
+        if (&other != this)
+          {
+            Morton_vector copy(other);
+            swap(copy);
+          }
+        return *this;
+      }
+
+      iterator begin() { return _values.begin(); }
+      const_iterator begin() const { return _values.begin(); }
+      const_iterator cbegin() const { return _values.begin(); }
+
+      iterator end() { return _values.end(); }
+      const_iterator end() const { return _values.end(); }
+      const_iterator cend() const { return _values.end(); }
+
+      reverse_iterator rbegin() { return reverse_iterator(end()); }
+      const_reverse_iterator rbegin() const
+      { return const_reverse_iterator(end()); }
+      const_reverse_iterator crbegin() const
+      { return const_reverse_iterator(end()); }
+
+      reverse_iterator rend() { return reverse_iterator(begin()); }
+      const_reverse_iterator rend() const
+      { return const_reverse_iterator(begin()); }
+      const_reverse_iterator crend() const
+      { return const_reverse_iterator(begin()); }
+
+      //! Returns the rank of the container, which is always 2.
+      rank_type rank() const { return rank_type(); }
+
+      //! Returns the number of dimensions of the keys, which is always 2.
+      dimension_type dimension() const { return 2; }
+
+      key_compare key_comp() const { return _compare; }
+
+      value_compare value_comp() const { return value_compare(_compare); }
+
+      allocator_type get_allocator() const
+      { return _values.get_allocator(); }
+
+      size_type size() const { return _values.size(); }
+
+      size_type count() const { return _values.size(); }
+
+      bool empty() const { return _values.empty(); }
+
+      size_type max_size() const { return _codes.max_size(); }
+
+      //! Returns the number of values the container can hold without
+      //! reallocating its arrays.
+      size_type capacity() const { return _values.capacity(); }
+
+      //! Reserves room for \c n values in the container.
+      void
+      reserve(size_type n)
+      {
+        _values.reserve(n);
+        _codes.reserve(n);
+      }
+
+      void
+      clear()
+      {
+        _values.clear();
+        _codes.clear();
+      }
+
+      void
+      swap(Morton_vector& other)
+      {
+        std::swap(_compare, other._compare);
+        _values.swap(other._values);
+        _codes.swap(other._codes);
+      }
+
+      /**
+       *  Inserts \c value in the container, after the values with the same
+       *  key, and returns an iterator to it.
+       *
+       *  All the values after it are moved, prefer inserting a whole range
+       *  when possible.
+       *
+       *  \throws std::out_of_range if a coordinate of the key of \c value is
+       *  not in <tt>[0, 65535]</tt>.
+       */
+      iterator
+      insert(const value_type& value)
+      {
+        morton_code code = checked_code(Values::key_of(value));
+        size_type pos = std::upper_bound(_codes.begin(), _codes.end(), code)
+          - _codes.begin();
+        Value_vector values(_values.get_allocator());
+        values.reserve(_values.size() + 1);
+        append(values, 0, pos);
+        values.push_back(value);
+        append(values, pos, _values.size());
+        _codes.insert(_codes.begin() + pos, code);
+        _values.swap(values);
+        SPATIAL_STATS_COUNT(inserts);
+        return begin() + pos;
+      }
+
+      /**
+       *  Inserts all the values in <tt>[first, last)</tt> in the container.
+       *  The values are sorted on their own and merged with the values of the
+       *  container in one pass. Values with the same key remain in the order
+       *  of their insertion.
+       *
+       *  \throws std::out_of_range if a coordinate of a key is not in <tt>[0,
+       *  65535]</tt>. The container is left unchanged.
+       */
+      template <typename InputIterator>
+      void
+      insert(InputIterator first, InputIterator last)
+      {
+        Value_vector batch(first, last, _values.get_allocator());
+        if (batch.empty()) return;
+        std::vector<std::pair<morton_code, size_type> > order;
+        order.reserve(batch.size());
+        for (size_type i = 0; i < batch.size(); ++i)
+          {
+            order.push_back(std::make_pair
+                            (checked_code(Values::key_of(batch[i])), i));
+          }
+        std::sort(order.begin(), order.end()); // ties broken by position
+        Value_vector values(_values.get_allocator());
+        Code_vector codes(_codes.get_allocator());
+        values.reserve(_values.size() + batch.size());
+        codes.reserve(_values.size() + batch.size());
+        size_type i = 0, j = 0;
+        while (i < _codes.size() || j < order.size())
+          {
+            if (j == order.size()
+                || (i < _codes.size() && _codes[i] <= order[j].first))
+              {
+                values.push_back(_values[i]);
+                codes.push_back(_codes[i]);
+                ++i;
+              }
+            else
+              {
+                values.push_back(batch[order[j].second]);
+                codes.push_back(order[j].first);
+                SPATIAL_STATS_COUNT(inserts);
+                ++j;
+              }
+          }
+        _values.swap(values);
+        _codes.swap(codes);
+      }
+
+      /**
+       *  Erases the value pointed to by \c pos. All the values after it are
+       *  moved.
+       */
+      void
+      erase(iterator pos)
+      {
+        size_type at = pos - begin();
+        SPATIAL_ASSERT_CHECK(at < size());
+        Value_vector values(_values.get_allocator());
+        values.reserve(_values.size() - 1);
+        append(values, 0, at);
+        append(values, at + 1, _values.size());
+        _codes.erase(_codes.begin() + at);
+        _values.swap(values);
+        SPATIAL_STATS_COUNT(erases);
+      }
+
+      /**
+       *  Erases all the values whose key has the same coordinates as \c key
+       *  and returns the number of values erased.
+       */
+      size_type
+      erase(const key_type& key)
+      {
+        if (!in_grid(key)) return 0;
+        morton_code code = key_code(key);
+        size_type first = std::lower_bound(_codes.begin(), _codes.end(), code)
+          - _codes.begin();
+        size_type last = std::upper_bound(_codes.begin() + first,
+                                          _codes.end(), code)
+          - _codes.begin();
+        if (first == last) return 0;
+        Value_vector values(_values.get_allocator());
+        values.reserve(_values.size() - (last - first));
+        append(values, 0, first);
+        append(values, last, _values.size());
+        _codes.erase(_codes.begin() + first, _codes.begin() + last);
+        _values.swap(values);
+        SPATIAL_STATS_ADD(erases, last - first);
+        return last - first;
+      }
+
+      //! Returns an iterator to the first value with the same coordinates as
+      //! \c key, or end() if there are none.
+      ///@{
+      iterator
+      find(const key_type& key)
+      { return begin() + find_index(key); }
+
+      const_iterator
+      find(const key_type& key) const
+      { return begin() + find_index(key); }
+      ///@}
+
+      //! Returns the coordinate of \c key along \c dim.
+      long
+      coordinate(dimension_type dim, const key_type& key) const
+      { return static_cast<long>(builtin_coordinate(_compare, dim, key)); }
+
+      //! Returns the Morton code of \c key, whose coordinates must be in the
+      //! grid.
+      morton_code
+      key_code(const key_type& key) const
+      {
+        return morton_encode(static_cast<morton_code>(coordinate(0, key)),
+                             static_cast<morton_code>(coordinate(1, key)));
+      }
+
+      //! Returns the Morton code of the value at \c i.
+      morton_code code(size_type i) const { return _codes[i]; }
+
+      //! Returns the position of the first value whose code is not less
+      //! than \c code, searching from \c first.
+      size_type
+      lower_bound_code(morton_code code, size_type first = 0) const
+      {
+        return std::lower_bound(_codes.begin() + first, _codes.end(), code)
+          - _codes.begin();
+      }
+
+      /**
+       *  Returns the position of the first value at or after \c i in the box
+       *  with corners \c zmin and \c zmax, or size() if there is none.
+       *  Codes outside of the box are skipped with morton_bigmin().
+       */
+      size_type
+      next_within(size_type i, morton_code zmin, morton_code zmax) const
+      {
+        while (i < _codes.size() && _codes[i] <= zmax)
+          {
+            SPATIAL_STATS_COUNT(nodes_visited);
+            if (morton_within(_codes[i], zmin, zmax)) return i;
+            i = lower_bound_code(morton_bigmin(_codes[i], zmin, zmax), i);
+          }
+        return _codes.size();
+      }
+
+      /**
+       *  Returns the position of the last value before \c i in the box with
+       *  corners \c zmin and \c zmax, or size() if there is none. Codes
+       *  outside of the box are skipped with morton_litmax().
+       */
+      size_type
+      prev_within(size_type i, morton_code zmin, morton_code zmax) const
+      {
+        while (i > 0 && _codes[i - 1] >= zmin)
+          {
+            --i;
+            SPATIAL_STATS_COUNT(nodes_visited);
+            if (morton_within(_codes[i], zmin, zmax)) return i;
+            i = std::upper_bound(_codes.begin(), _codes.begin() + i,
+                                 morton_litmax(_codes[i], zmin, zmax))
+              - _codes.begin();
+          }
+        return _codes.size();
+      }
+
+      //! Returns the key of the value at \c i.
+      const key_type&
+      key(size_type i) const { return Values::key_of(_values[i]); }
+
+    private:
+      /**
+       *  Copies the values in <tt>[first, last)</tt> at the end of \c to. Keys
+       *  may be constant, so values are never assigned, only copied.
+       */
+      void
+      append(Value_vector& to, size_type first, size_type last) const
+      { for (; first != last; ++first) { to.push_back(_values[first]); } }
+
+      bool
+      in_grid(const key_type& key) const
+      {
+        long x = coordinate(0, key);
+        long y = coordinate(1, key);
+        return x >= 0 && x <= morton_coordinate_max
+          && y >= 0 && y <= morton_coordinate_max;
+      }
+
+      morton_code
+      checked_code(const key_type& key) const
+      {
+        if (!in_grid(key))
+          throw std::out_of_range("key coordinate is not in [0, 65535]");
+        return key_code(key);
+      }
+
+      size_type
+      find_index(const key_type& key) const
+      {
+        if (!in_grid(key)) return size();
+        morton_code code = key_code(key);
+        size_type i = lower_bound_code(code);
+        return (i < size() && _codes[i] == code) ? i : size();
+      }
+
+      key_compare _compare;
+      Value_vector _values;
+      Code_vector _codes;
+    };
+
+    //! The iterator of a \ref Morton_vector on which \c Ct iterates.
+    ///@{
+    template <typename Ct>
+    struct Morton_iterator
+    { typedef typename Ct::iterator type; };
+
+    template <typename Ct>
+    struct Morton_iterator<const Ct>
+    { typedef typename Ct::const_iterator type; };
+    ///@}
+  } // namespace details
+
+  /**
+   *  Iterates over the values of a morton_point_multiset or a
+   *  morton_point_multimap whose keys are in a box, in the order of their
+   *  Morton codes.
+   *
+   *  The iterator only reads the codes of the values between the corners of
+   *  the box that are in the box, and jumps over the runs of codes outside
+   *  of the box with a binary search.
+   *
+   *  \tparam Ct The container type, const-qualified for constant iterators.
+   */
+  template <typename Ct>
+  class morton_region_iterator
+  {
+    typedef typename details::Morton_iterator<Ct>::type base_iterator;
+
+  public:
+    typedef std::bidirectional_iterator_tag           iterator_category;
+    typedef typename std::iterator_traits<base_iterator>::value_type
+    value_type;
+    typedef typename std::iterator_traits<base_iterator>::difference_type
+    difference_type;
+    typedef typename std::iterator_traits<base_iterator>::pointer pointer;
+    typedef typename std::iterator_traits<base_iterator>::reference
+    reference;
+
+    //! Uninitialized iterator.
+    morton_region_iterator() { }
+
+    /**
+     *  Build an iterator on the values of \c container with keys in the box
+     *  <tt>[xmin, xmax] x [ymin, ymax]</tt>, pointing to the value at \c
+     *  index, which must be in the box or equal to <tt>container.size()</tt>.
+     */
+    morton_region_iterator(Ct& container, details::morton_code zmin,
+                           details::morton_code zmax,
+                           typename Ct::size_type index)
+      : _container(&container), _zmin(zmin), _zmax(zmax), _index(index)
+    { }
+
+    //! Convert a mutable iterator into a constant one.
+    template <typename Other>
+    morton_region_iterator(const morton_region_iterator<Other>& other)
+      : _container(other.container()), _zmin(other.zmin()),
+        _zmax(other.zmax()), _index(other.index())
+    { }
+
+    reference operator*() const
+    { return *(base_iterator(_container->begin()) + _index); }
+
+    pointer operator->() const
+    { return &operator*(); }
+
+    morton_region_iterator&
+    operator++()
+    {
+      _index = _container->next_within(_index + 1, _zmin, _zmax);
+      return *this;
+    }
+
+    morton_region_iterator
+    operator++(int)
+    {
+      morton_region_iterator x(*this);
+      ++*this;
+      return x;
+    }
+
+    morton_region_iterator&
+    operator--()
+    {
+      _index = _container->prev_within(_index, _zmin, _zmax);
+      return *this;
+    }
+
+    morton_region_iterator
+    operator--(int)
+    {
+      morton_region_iterator x(*this);
+      --*this;
+      return x;
+    }
+
+    Ct* container() const { return _container; }
+    details::morton_code zmin() const { return _zmin; }
+    details::morton_code zmax() const { return _zmax; }
+    typename Ct::size_type index() const { return _index; }
+
+    template <typename Other>
+    bool operator==(const morton_region_iterator<Other>& other) const
+    { return _index == other.index(); }
+
+    template <typename Other>
+    bool operator!=(const morton_region_iterator<Other>& other) const
+    { return _index != other.index(); }
+
+  private:
+    Ct* _container;
+    details::morton_code _zmin;
+    details::morton_code _zmax;
+    typename Ct::size_type _index;
+  };
+
+  namespace details
+  {
+    /**
+     *  Returns a region iterator on the values of \c container with keys in
+     *  <tt>[lower, upper)</tt>, pointing to the first of them if \c first is
+     *  true, or past the last of them otherwise.
+     */
+    template <typename Ct>
+    inline morton_region_iterator<Ct>
+    morton_region(Ct& container, const typename Ct::key_type& lower,
+                  const typename Ct::key_type& upper, bool first)
+    {
+      except::check_bounds(container, lower, upper);
+      long xmin = container.coordinate(0, lower);
+      long ymin = container.coordinate(1, lower);
+      long xmax = container.coordinate(0, upper) - 1;
+      long ymax = container.coordinate(1, upper) - 1;
+      morton_code zmin = morton_encode(morton_clamp(xmin),
+                                       morton_clamp(ymin));
+      morton_code zmax = morton_encode(morton_clamp(xmax),
+                                       morton_clamp(ymax));
+      typename Ct::size_type end = container.size();
+      if (!first || xmax < 0 || ymax < 0 || xmin > morton_coordinate_max
+          || ymin > morton_coordinate_max)
+        { return morton_region_iterator<Ct>(container, zmin, zmax, end); }
+      return morton_region_iterator<Ct>
+        (container, zmin, zmax,
+         container.next_within(container.lower_bound_code(zmin), zmin, zmax));
+    }
+  } // namespace details
+
+  /**
+   *  Iterates over the values of a morton_point_multiset or a
+   *  morton_point_multimap from the nearest to the furthest of a target key,
+   *  by euclidian distance.
+   *
+   *  The search starts with the values around the position of the target's
+   *  Morton code, whose nearest distance bounds the distance to the nearest
+   *  value. The values in a box of that size around the target are sorted by
+   *  distance and returned in turn; the box then doubles in size, and only
+   *  the values that were not in the previous round are kept, until all the
+   *  values have been returned.
+   *
+   *  Distances are measured on the integer coordinates of the keys. Values
+   *  at the same distance are returned in the order of the container.
+   *
+   *  \tparam Ct The container type, const-qualified for constant iterators.
+   */
+  template <typename Ct>
+  class morton_neighbor_iterator
+  {
+    typedef typename details::Morton_iterator<Ct>::type base_iterator;
+    typedef typename Ct::size_type size_type;
+    typedef std::pair<double, size_type> candidate;
+
+  public:
+    typedef std::forward_iterator_tag                 iterator_category;
+    typedef typename std::iterator_traits<base_iterator>::value_type
+    value_type;
+    typedef typename std::iterator_traits<base_iterator>::difference_type
+    difference_type;
+    typedef typename std::iterator_traits<base_iterator>::pointer pointer;
+    typedef typename std::iterator_traits<base_iterator>::reference
+    reference;
+    typedef typename Ct::key_type                     key_type;
+    typedef double                                    distance_type;
+
+    //! Uninitialized iterator.
+    morton_neighbor_iterator() { }
+
+    /**
+     *  Build an iterator on the values of \c container from the nearest to
+     *  the furthest of \c target, pointing to the nearest if \c first is
+     *  true, or past the furthest otherwise.
+     */
+    morton_neighbor_iterator(Ct& container, const key_type& target,
+                             bool first)
+      : _container(&container), _target(target),
+        _x(container.coordinate(0, target)),
+        _y(container.coordinate(1, target)),
+        _radius(-1.0), _found(0), _next(0)
+    {
+      if (!first || container.empty()) { _found = container.size(); return; }
+      // The nearest of the values around the target on the Z-order curve
+      // bounds the distance to the nearest value.
+      size_type at = container.lower_bound_code
+        (details::morton_encode(details::morton_clamp(_x),
+                                details::morton_clamp(_y)));
+      size_type lo = at > 4 ? at - 4 : 0;
+      size_type hi = at + 4 < container.size() ? at + 4 : container.size();
+      double radius = distance_to(lo);
+      for (size_type i = lo + 1; i < hi; ++i)
+        { if (distance_to(i) < radius) radius = distance_to(i); }
+      gather(radius);
+    }
+
+    //! Convert a mutable iterator into a constant one.
+    template <typename Other>
+    morton_neighbor_iterator(const morton_neighbor_iterator<Other>& other)
+      : _container(other._container), _target(other._target),
+        _x(other._x), _y(other._y), _radius(other._radius),
+        _found(other._found), _next(other._next),
+        _candidates(other._candidates)
+    { }
+
+    reference operator*() const
+    {
+      return *(base_iterator(_container->begin())
+               + _candidates[_next].second);
+    }
+
+    pointer operator->() const
+    { return &operator*(); }
+
+    morton_neighbor_iterator&
+    operator++()
+    {
+      if (++_next == _candidates.size())
+        {
+          while (_found < _container->size())
+            {
+              gather(_radius > 0.5 ? 2.0 * _radius : 1.0);
+              if (!_candidates.empty()) break;
+            }
+        }
+      return *this;
+    }
+
+    morton_neighbor_iterator
+    operator++(int)
+    {
+      morton_neighbor_iterator x(*this);
+      ++*this;
+      return x;
+    }
+
+    //! The distance between the current value and the target.
+    distance_type distance() const { return _candidates[_next].first; }
+
+    //! The target of the iteration.
+    const key_type& target_key() const { return _target; }
+
+    //! The position of the current value in the container, or its size
+    //! past the end.
+    size_type
+    index() const
+    {
+      return _next < _candidates.size() ? _candidates[_next].second
+        : _container->size();
+    }
+
+    template <typename Other>
+    bool operator==(const morton_neighbor_iterator<Other>& other) const
+    { return index() == other.index(); }
+
+    template <typename Other>
+    bool operator!=(const morton_neighbor_iterator<Other>& other) const
+    { return index() != other.index(); }
+
+  private:
+    template <typename> friend class morton_neighbor_iterator;
+
+    double
+    distance_to(size_type i) const
+    {
+      const key_type& key = _container->key(i);
+      double dx = static_cast<double>(_container->coordinate(0, key) - _x);
+      double dy = static_cast<double>(_container->coordinate(1, key) - _y);
+      return std::sqrt(dx * dx + dy * dy);
+    }
+
+    /**
+     *  Collects and sorts the values further than the current radius and
+     *  no further than \c radius, which becomes the current radius.
+     */
+    void
+    gather(double radius)
+    {
+      _candidates.clear();
+      _next = 0;
+      long reach = static_cast<long>(std::ceil(radius));
+      details::morton_code zmin
+        = details::morton_encode(details::morton_clamp(_x - reach),
+                                 details::morton_clamp(_y - reach));
+      details::morton_code zmax
+        = details::morton_encode(details::morton_clamp(_x + reach),
+                                 details::morton_clamp(_y + reach));
+      for (size_type i = _container->next_within
+             (_container->lower_bound_code(zmin), zmin, zmax);
+           i < _container->size();
+           i = _container->next_within(i + 1, zmin, zmax))
+        {
+          SPATIAL_STATS_COUNT(distance_evaluations);
+          double d = distance_to(i);
+          if (d > _radius && d <= radius)
+            { _candidates.push_back(candidate(d, i)); }
+        }
+      std::sort(_candidates.begin(), _candidates.end());
+      _found += _candidates.size();
+      _radius = radius;
+    }
+
+    Ct* _container;
+    key_type _target;
+    long _x;
+    long _y;
+    double _radius;
+    size_type _found;
+    size_type _next;
+    std::vector<candidate> _candidates;
+  };
+
+  //! Returns the distance between the value pointed to by \c iter and the
+  //! target of the iteration.
+  template <typename Ct>
+  inline double
+  distance(const morton_neighbor_iterator<Ct>& iter)
+  { return iter.distance(); }
+
+  //! Returns the target of the iteration of \c iter.
+  template <typename Ct>
+  inline const typename Ct::key_type&
+  target_key(const morton_neighbor_iterator<Ct>& iter)
+  { return iter.target_key(); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  class morton_point_multiset;
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  class morton_point_multimap;
+
+  /**
+   *  Region and neighbor iterators for morton_point_multiset and
+   *  morton_point_multimap, with the same interface as those of the other
+   *  containers. Regions are given by their bounds: the keys \c x such that
+   *  <tt>lower <= x < upper</tt> along both dimensions. Neighbors are sorted
+   *  by euclidian distance.
+   */
+  ///@{
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator<morton_point_multiset<Key, Compare, Alloc> >
+  region_begin(morton_point_multiset<Key, Compare, Alloc>& container,
+               const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  region_begin(const morton_point_multiset<Key, Compare, Alloc>& container,
+               const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  region_cbegin(const morton_point_multiset<Key, Compare, Alloc>& container,
+                const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator<morton_point_multiset<Key, Compare, Alloc> >
+  region_end(morton_point_multiset<Key, Compare, Alloc>& container,
+             const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  region_end(const morton_point_multiset<Key, Compare, Alloc>& container,
+             const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  region_cend(const morton_point_multiset<Key, Compare, Alloc>& container,
+              const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_begin(morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+               const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_begin
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_cbegin
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, true); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_end(morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+             const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_end
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_region_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  region_cend
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return details::morton_region(container, lower, upper, false); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_begin(morton_point_multiset<Key, Compare, Alloc>& container,
+                 const Key& target)
+  {
+    return morton_neighbor_iterator
+      <morton_point_multiset<Key, Compare, Alloc> >(container, target, true);
+  }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_begin(const morton_point_multiset<Key, Compare, Alloc>& container,
+                 const Key& target)
+  {
+    return morton_neighbor_iterator
+      <const morton_point_multiset<Key, Compare, Alloc> >
+      (container, target, true);
+  }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_cbegin(const morton_point_multiset<Key, Compare, Alloc>& container,
+                  const Key& target)
+  { return neighbor_begin(container, target); }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_end(morton_point_multiset<Key, Compare, Alloc>& container,
+               const Key& target)
+  {
+    return morton_neighbor_iterator
+      <morton_point_multiset<Key, Compare, Alloc> >(container, target, false);
+  }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_end(const morton_point_multiset<Key, Compare, Alloc>& container,
+               const Key& target)
+  {
+    return morton_neighbor_iterator
+      <const morton_point_multiset<Key, Compare, Alloc> >
+      (container, target, false);
+  }
+
+  template <typename Key, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multiset<Key, Compare, Alloc> >
+  neighbor_cend(const morton_point_multiset<Key, Compare, Alloc>& container,
+                const Key& target)
+  { return neighbor_end(container, target); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_begin
+  (morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return morton_neighbor_iterator
+      <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+      (container, target, true);
+  }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_begin
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return morton_neighbor_iterator
+      <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+      (container, target, true);
+  }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_cbegin
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  { return neighbor_begin(container, target); }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_end
+  (morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return morton_neighbor_iterator
+      <morton_point_multimap<Key, Mapped, Compare, Alloc> >
+      (container, target, false);
+  }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_end
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return morton_neighbor_iterator
+      <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+      (container, target, false);
+  }
+
+  template <typename Key, typename Mapped, typename Compare, typename Alloc>
+  inline morton_neighbor_iterator
+  <const morton_point_multimap<Key, Mapped, Compare, Alloc> >
+  neighbor_cend
+  (const morton_point_multimap<Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  { return neighbor_end(container, target); }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_MORTON_HPP
@@ -19,6 +19,7 @@
 #include "../metric.hpp"
 #include "../traits.hpp"
 #include "spatial_bidirectional.hpp"
+#include "spatial_stats.hpp"
 
 namespace spatial
 {
@@ -1141,6 +1142,8 @@ namespace spatial
       dimension_type best_dim = 0;
       for (;;)
         {
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist >= best_dist)
@@ -1158,6 +1161,7 @@ namespace spatial
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
                 {
+                  SPATIAL_STATS_COUNT(backtracks);
                   import::tuple<NodePtr, dimension_type,
                                 typename Metric::distance_type>
                     triplet = last_neighbor_sub(near, child_dim, rank,
@@ -1203,6 +1207,8 @@ namespace spatial
       dimension_type best_dim = 0;
       for (;;)
         {
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist < best_dist)
@@ -1221,6 +1227,7 @@ namespace spatial
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
                 {
+                  SPATIAL_STATS_COUNT(backtracks);
                   import::tuple<NodePtr, dimension_type,
                                 typename Metric::distance_type>
                     triplet = first_neighbor_sub(near, child_dim, rank,
@@ -1275,6 +1282,8 @@ namespace spatial
       dimension_type best_dim = decr_dim(rank, dim);
       for (;;)
         {
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist > bound)
@@ -1298,6 +1307,7 @@ namespace spatial
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
                 {
+                  SPATIAL_STATS_COUNT(backtracks);
                   import::tuple<NodePtr, dimension_type,
                                 typename Metric::distance_type>
                     triplet = lower_bound_neighbor_sub(near, child_dim, rank,
@@ -1354,6 +1364,8 @@ namespace spatial
       dimension_type best_dim = decr_dim(rank, dim);
       for (;;)
         {
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist > bound && test_dist < best_dist)
@@ -1372,6 +1384,7 @@ namespace spatial
               dimension_type child_dim = incr_dim(rank, dim);
               if (near != 0)
                 {
+                  SPATIAL_STATS_COUNT(backtracks);
                   import::tuple<NodePtr, dimension_type,
                                 typename Metric::distance_type>
                     triplet = upper_bound_neighbor_sub(near, child_dim, rank,
@@ -1445,6 +1458,7 @@ namespace spatial
             { node = far; dim = incr_dim(rank, dim); }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               NodePtr prev_node = node;
               node = node->parent; dim = decr_dim(rank, dim);
               while (!header(node)
@@ -1465,6 +1479,8 @@ namespace spatial
               else break;
             }
           // Test node here and stops as soon as it finds an equal
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist == node_dist)
@@ -1495,6 +1511,7 @@ namespace spatial
             : import::make_tuple(node->left, node->right);
           if (far == prev_node && near != 0)
             {
+              SPATIAL_STATS_COUNT(backtracks);
               node = near;
               dim = prev_dim;
               for (;;)
@@ -1514,6 +1531,8 @@ namespace spatial
                 }
             }
           // Test node here for new best
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist > node_dist && (best == 0 || test_dist <= best_dist))
@@ -1566,6 +1585,7 @@ namespace spatial
             : import::make_tuple(node->left, node->right);
           if (prev_node == far && near != 0)
             {
+              SPATIAL_STATS_COUNT(backtracks);
               node = near;
               dim = prev_dim;
               for (;;)
@@ -1584,6 +1604,8 @@ namespace spatial
                 }
             }
           // Test node here and stops as soon as it finds an equal
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist == node_dist)
@@ -1623,6 +1645,7 @@ namespace spatial
             { node = far; dim = incr_dim(rank, dim); }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               prev_node = node;
               node = node->parent; dim = decr_dim(rank, dim);
               while (!header(node)
@@ -1641,6 +1664,8 @@ namespace spatial
                 { node = far; dim = incr_dim(rank, dim); }
               else break;
             }
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
           typename Metric::distance_type test_dist
             = met.distance_to_key(rank(), target, const_key(node));
           if (test_dist < node_dist && (best == 0 || test_dist >= best_dist))
@@ -884,6 +884,44 @@ namespace spatial
       return x;
     }
 
+    /**
+     *  Returns the length of \c [first, last) when it is a random access range,
+     *  0 otherwise. Used to reserve memory ahead of building a tree.
+     */
+    ///@{
+    template <typename InputIterator>
+    inline std::ptrdiff_t
+    random_access_iterator_distance
+    (InputIterator first, InputIterator last, std::random_access_iterator_tag)
+    { return last - first; }
+
+    template <typename InputIterator>
+    inline std::ptrdiff_t
+    random_access_iterator_distance
+    (InputIterator, InputIterator, std::input_iterator_tag)
+    { return 0; }
+    ///@}
+
+    /**
+     *  Compares two node pointers by their keys along a single dimension.
+     *  Used to order nodes when a tree is built from a range of nodes.
+     */
+    template<typename Compare, typename Node_ptr>
+    struct mapping_compare
+    {
+      Compare compare;
+      dimension_type dimension;
+
+      mapping_compare(const Compare& c, dimension_type d)
+        : compare(c), dimension(d) { }
+
+      bool
+      operator() (const Node_ptr& x, const Node_ptr& y) const
+      {
+        return compare(dimension, const_key(x), const_key(y));
+      }
+    };
+
   } // namespace details
 } // namespace spatial
 
@@ -66,7 +66,21 @@ namespace spatial
     template<typename Rank>
     inline dimension_type
     incr_dim(Rank rank, dimension_type node_dim)
-    { return (node_dim + 1) % rank(); }
+    { return (node_dim + 1 < rank()) ? node_dim + 1 : 0; }
+
+    /**
+     *  Increment dimension \c node_dim, for ranks known at compile time that
+     *  do not need a comparison.
+     *  @{
+     */
+    inline dimension_type
+    incr_dim(Static_rank<1>, dimension_type)
+    { return 0; }
+
+    inline dimension_type
+    incr_dim(Static_rank<2>, dimension_type node_dim)
+    { return node_dim ^ 1; }
+    /** @} */
 
     /**
      *  Decrement dimension \c node_dim, given \c rank.
@@ -77,7 +91,21 @@ namespace spatial
     template<typename Rank>
     inline dimension_type
     decr_dim(Rank rank, dimension_type node_dim)
-    { return (rank() + node_dim - 1) % rank(); }
+    { return (node_dim != 0) ? node_dim - 1 : rank() - 1; }
+
+    /**
+     *  Decrement dimension \c node_dim, for ranks known at compile time that
+     *  do not need a comparison.
+     *  @{
+     */
+    inline dimension_type
+    decr_dim(Static_rank<1>, dimension_type)
+    { return 0; }
+
+    inline dimension_type
+    decr_dim(Static_rank<2>, dimension_type node_dim)
+    { return node_dim ^ 1; }
+    /** @} */
 
     /**
      *  Returns the modulo of a node's heigth by a container's rank. This, in
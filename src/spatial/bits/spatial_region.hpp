@@ -20,6 +20,7 @@
 #include "spatial_bidirectional.hpp"
 #include "spatial_rank.hpp"
 #include "spatial_except.hpp"
+#include "spatial_stats.hpp"
 
 namespace spatial
 {
@@ -637,6 +638,7 @@ namespace spatial
     inline bool
     match_all(const Rank& rank, const Key& key, const Predicate& predicate)
     {
+      SPATIAL_STATS_COUNT(nodes_visited);
       for (dimension_type i = 0; i < rank(); ++i)
         { if (predicate(i, rank(), key) != matching) { return false; } }
       return true;
@@ -668,6 +670,7 @@ namespace spatial
             }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               typename region_iterator<Container, Predicate>::node_ptr p
                 = iter.node->parent;
               while (!header(p) && iter.node == p->right)
@@ -718,6 +721,7 @@ namespace spatial
             }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               typename region_iterator<Container, Predicate>::node_ptr p
                 = iter.node->parent;
               while (!header(p) && iter.node == p->left)
@@ -781,6 +785,7 @@ namespace spatial
             }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               typename region_iterator<Container, Predicate>::node_ptr p
                 = iter.node->parent;
               while (p != end && iter.node == p->right)
@@ -842,6 +847,7 @@ namespace spatial
             }
           else
             {
+              SPATIAL_STATS_COUNT(backtracks);
               typename region_iterator<Container, Predicate>::node_ptr p
                 = iter.node->parent;
               while (p != end && iter.node == p->left)
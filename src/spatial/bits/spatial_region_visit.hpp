@@ -0,0 +1,365 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_region_visit.hpp
+ *  Provides region_visit() and region_reduce(), which call a function on all
+ *  the elements of a container that match a \region_predicate, and the
+ *  functions they rely upon.
+ */
+
+#ifndef SPATIAL_REGION_VISIT_HPP
+#define SPATIAL_REGION_VISIT_HPP
+
+#include <vector>
+
+#include "spatial_import_thread.hpp"
+#ifdef SPATIAL_THREAD
+#  include <atomic>
+#  include <exception> // std::exception_ptr
+#endif
+
+#include "../traits.hpp"
+#include "spatial_region.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Visits, in order, all the nodes of the sub-tree under \c node that
+     *  match \c pred, and calls \c visit with an \c Iterator on each of them.
+     *  Only walks into the children of a node that may hold a match.
+     */
+    template <typename Iterator, typename Rank, typename Predicate,
+              typename NodePtr, typename Visitor>
+    inline void
+    region_visit_sub(const Rank& rank, const Predicate& pred, NodePtr node,
+                     dimension_type dim, Visitor& visit)
+    {
+      for (;;)
+        {
+          relative_order order = pred(dim, rank(), const_key(node));
+          dimension_type child_dim = incr_dim(rank, dim);
+          if (node->left != 0 && order != below)
+            {
+              region_visit_sub<Iterator>(rank, pred, node->left, child_dim,
+                                         visit);
+            }
+          if (match_all(rank, const_key(node), pred))
+            { visit(Iterator(node)); }
+          if (node->right == 0 || order == above) return;
+          node = node->right;
+          dim = child_dim;
+        }
+    }
+
+    //! Adapts a reducing visitor to region_visit_sub().
+    template <typename Result, typename Visitor>
+    struct Region_accumulate
+    {
+      Region_accumulate(Result& result_, const Visitor& visit_)
+        : result(result_), visit(visit_) { }
+
+      template <typename Iterator>
+      void
+      operator()(const Iterator& iter)
+      { visit(result, iter); }
+
+      Result& result;
+      Visitor visit;
+    };
+
+    /**
+     *  A part of a region_reduce(): either a whole sub-tree or a single node
+     *  of the top of the tree.
+     */
+    template <typename NodePtr>
+    struct Region_task
+    {
+      Region_task(NodePtr node_, dimension_type dim_, bool whole_)
+        : node(node_), dim(dim_), whole(whole_) { }
+
+      NodePtr node;
+      dimension_type dim;
+      bool whole;
+    };
+
+    /**
+     *  Splits the top \c depth levels of the sub-tree under \c node into
+     *  tasks, stored in order so that visiting the tasks one after the other
+     *  visits the nodes in the same order as region_visit_sub(). Sub-trees
+     *  and nodes that cannot match \c pred are left out.
+     */
+    template <typename Rank, typename Predicate, typename NodePtr>
+    inline void
+    region_split(const Rank& rank, const Predicate& pred, NodePtr node,
+                 dimension_type dim, size_type depth,
+                 std::vector<Region_task<NodePtr> >& tasks)
+    {
+      if (depth == 0)
+        {
+          tasks.push_back(Region_task<NodePtr>(node, dim, true));
+          return;
+        }
+      relative_order order = pred(dim, rank(), const_key(node));
+      dimension_type child_dim = incr_dim(rank, dim);
+      if (node->left != 0 && order != below)
+        {
+          region_split(rank, pred, NodePtr(node->left), child_dim, depth - 1,
+                       tasks);
+        }
+      if (match_all(rank, const_key(node), pred))
+        { tasks.push_back(Region_task<NodePtr>(node, dim, false)); }
+      if (node->right != 0 && order != above)
+        {
+          region_split(rank, pred, NodePtr(node->right), child_dim,
+                       depth - 1, tasks);
+        }
+    }
+
+    /**
+     *  The partial result of a task, wrapped so that tasks never share a
+     *  word of memory, as they would in a <tt>std::vector<bool></tt>.
+     */
+    template <typename Result>
+    struct Region_partial
+    {
+      explicit Region_partial(const Result& result_) : result(result_) { }
+      Result result;
+    };
+
+    //! Containers smaller than this are not worth splitting across threads.
+    enum { region_parallel_threshold = 4096 };
+
+    //! The number of threads used by region_reduce() by default.
+    inline size_type
+    region_threads()
+    {
+      size_type threads = 1;
+#ifdef SPATIAL_THREAD
+      threads = std::thread::hardware_concurrency();
+      if (threads == 0) threads = 1;
+#endif
+      return threads;
+    }
+
+    template <typename Iterator, typename Ct, typename Predicate,
+              typename NodePtr, typename Result, typename Visitor,
+              typename Merge>
+    inline Result
+    region_reduce(const Ct& container, NodePtr root, const Predicate& pred,
+                  const Result& identity, const Visitor& visit, Merge merge,
+                  size_type threads)
+    {
+      Result result(identity);
+      if (header(root)) return result;
+      typename container_traits<Ct>::rank_type rank(container.rank());
+#ifdef SPATIAL_THREAD
+      if (threads > 1 && container.size()
+          >= static_cast<size_type>(region_parallel_threshold))
+        {
+          // Several sub-trees per thread balance the load when the region
+          // only covers part of the tree.
+          size_type depth = 0;
+          while ((static_cast<size_type>(1) << depth) < 4 * threads) ++depth;
+          std::vector<Region_task<NodePtr> > tasks;
+          region_split(rank, pred, root, 0, depth, tasks);
+          std::vector<Region_partial<Result> >
+            partials(tasks.size(), Region_partial<Result>(identity));
+          // An exception thrown by a task is kept until all the threads are
+          // joined, then the first one, in the order of the tasks, is thrown
+          std::vector<std::exception_ptr> errors(tasks.size());
+          std::atomic<bool> failed(false);
+          std::atomic<size_type> next(0);
+          auto work = [&]()
+            {
+              for (size_type i = next++; i < tasks.size() && !failed;
+                   i = next++)
+                {
+                  try
+                    {
+                      // Accumulate on the stack, away from the other threads
+                      Result partial(identity);
+                      Region_accumulate<Result, Visitor>
+                        accumulate(partial, visit);
+                      if (tasks[i].whole)
+                        {
+                          region_visit_sub<Iterator>
+                            (rank, pred, tasks[i].node, tasks[i].dim,
+                             accumulate);
+                        }
+                      else { accumulate(Iterator(tasks[i].node)); }
+                      partials[i].result = partial;
+                    }
+                  catch (...)
+                    {
+                      errors[i] = std::current_exception();
+                      failed = true;
+                    }
+                }
+            };
+          std::vector<std::thread> workers;
+          try
+            {
+              // Reserved first, so that a started thread is never dropped
+              workers.reserve(threads - 1);
+              for (size_type i = 1; i < threads && i < tasks.size(); ++i)
+                { workers.push_back(std::thread(work)); }
+            }
+          catch (...) { } // the threads already started do the work
+          work();
+          for (size_type i = 0; i < workers.size(); ++i)
+            { workers[i].join(); }
+          for (size_type i = 0; i < errors.size(); ++i)
+            { if (errors[i]) std::rethrow_exception(errors[i]); }
+          for (size_type i = 0; i < partials.size(); ++i)
+            { merge(result, partials[i].result); }
+          return result;
+        }
+#else
+      (void)threads;
+      (void)merge;
+#endif
+      Region_accumulate<Result, Visitor> accumulate(result, visit);
+      region_visit_sub<Iterator>(rank, pred, root, 0, accumulate);
+      return result;
+    }
+  } // namespace details
+
+  /**
+   *  Calls \c visit on an iterator to each element of \c container that
+   *  matches \c pred, in the same order as a \region_iterator would visit
+   *  them.
+   *
+   *  The tree is walked recursively in one go, so this is faster than
+   *  incrementing a \region_iterator, which has to walk back up the tree to
+   *  find the next match.
+   *
+   *  \tparam Predicate A model of \region_predicate.
+   *  \tparam Visitor A unary function accepting <tt>Ct::iterator</tt>, or
+   *  <tt>Ct::const_iterator</tt> when the container is constant.
+   *  \return A copy of \c visit after it has visited all the elements.
+   */
+  ///@{
+  template <typename Ct, typename Predicate, typename Visitor>
+  inline Visitor
+  region_visit(Ct& container, const Predicate& pred, Visitor visit)
+  {
+    typedef typename container_traits<Ct>::iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    if (!header(root))
+      {
+        details::region_visit_sub<iterator>(container.rank(), pred, root, 0,
+                                            visit);
+      }
+    return visit;
+  }
+
+  template <typename Ct, typename Predicate, typename Visitor>
+  inline Visitor
+  region_visit(const Ct& container, const Predicate& pred, Visitor visit)
+  {
+    typedef typename container_traits<Ct>::const_iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    if (!header(root))
+      {
+        details::region_visit_sub<iterator>(container.rank(), pred, root, 0,
+                                            visit);
+      }
+    return visit;
+  }
+
+  template <typename Ct, typename Visitor>
+  inline Visitor
+  region_visit(Ct& container,
+               const typename container_traits<Ct>::key_type& lower,
+               const typename container_traits<Ct>::key_type& upper,
+               Visitor visit)
+  {
+    return region_visit(container, make_bounds(container, lower, upper),
+                        visit);
+  }
+
+  template <typename Ct, typename Visitor>
+  inline Visitor
+  region_visit(const Ct& container,
+               const typename container_traits<Ct>::key_type& lower,
+               const typename container_traits<Ct>::key_type& upper,
+               Visitor visit)
+  {
+    return region_visit(container, make_bounds(container, lower, upper),
+                        visit);
+  }
+  ///@}
+
+  /**
+   *  Reduces all the elements of \c container that match \c pred into a
+   *  single result, splitting the work across \c threads threads.
+   *
+   *  The top levels of the tree are split into independent sub-trees, a few
+   *  per thread, that the threads take one after the other. Each of them is
+   *  reduced into its own copy of \c identity by calling <tt>visit(result,
+   *  iter)</tt> on each match. The partial results are then merged into a
+   *  copy of \c identity with <tt>merge(result, partial)</tt>, in the order
+   *  of the sub-trees.
+   *
+   *  The sub-trees only depend on the shape of the tree, and each partial
+   *  result visits its elements in order, so the result is the same from
+   *  one run to the next and does not depend on the number of threads, as
+   *  long as \c merge is associative: appending partial vectors gives the
+   *  matches in the same order as a \region_iterator.
+   *
+   *  Small containers, or a library built without threads, are reduced in
+   *  the calling thread, which still calls \c visit but never \c merge.
+   *
+   *  If \c pred or \c visit throws on any thread, the remaining sub-trees
+   *  are skipped, and the exception of the first failed sub-tree is thrown
+   *  again on the calling thread once all the threads have finished.
+   *
+   *  \tparam Predicate A model of \region_predicate.
+   *  \tparam Result A copy-constructible type. \c identity must be neutral
+   *  for \c merge.
+   *  \tparam Visitor A function accepting a <tt>Result&</tt> and a
+   *  <tt>Ct::iterator</tt>, or <tt>Ct::const_iterator</tt> when the
+   *  container is constant. Each thread uses its own copy, called
+   *  concurrently with the others.
+   *  \tparam Merge A function accepting a <tt>Result&</tt> and a
+   *  <tt>const Result&</tt>.
+   *  \param threads The number of threads to use, including the calling
+   *  thread. The number of hardware threads by default.
+   */
+  ///@{
+  template <typename Ct, typename Predicate, typename Result,
+            typename Visitor, typename Merge>
+  inline Result
+  region_reduce(Ct& container, const Predicate& pred, const Result& identity,
+                Visitor visit, Merge merge,
+                size_type threads = details::region_threads())
+  {
+    typedef typename container_traits<Ct>::iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    return details::region_reduce<iterator>(container, root, pred, identity,
+                                            visit, merge, threads);
+  }
+
+  template <typename Ct, typename Predicate, typename Result,
+            typename Visitor, typename Merge>
+  inline Result
+  region_reduce(const Ct& container, const Predicate& pred,
+                const Result& identity, Visitor visit, Merge merge,
+                size_type threads = details::region_threads())
+  {
+    typedef typename container_traits<Ct>::const_iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    return details::region_reduce<iterator>(container, root, pred, identity,
+                                            visit, merge, threads);
+  }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_REGION_VISIT_HPP
@@ -0,0 +1,202 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_snapshot.hpp
+ *  Provides snapshot_container, which lets threads query a container while
+ *  another thread updates it.
+ */
+
+#ifndef SPATIAL_SNAPSHOT_HPP
+#define SPATIAL_SNAPSHOT_HPP
+
+#include "spatial_import_thread.hpp"
+#ifdef SPATIAL_THREAD
+#  include <atomic>
+#endif
+
+#include "../spatial.hpp"
+#include "spatial_assert.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  The type of the counters shared between the readers and the writer of
+     *  a snapshot_container. Without threads, a plain integer does.
+     */
+#ifdef SPATIAL_THREAD
+    typedef std::atomic<size_type> Snapshot_count;
+#else
+    typedef size_type Snapshot_count;
+#endif
+  } // namespace details
+
+  /**
+   *  Holds two copies of a container \c Ct: the published copy, which any
+   *  number of threads may query, and a working copy, which one thread
+   *  updates before publishing it in place of the other.
+   *
+   *  Readers pin the published copy with a \ref reader for the duration of
+   *  their queries. Taking a reader never blocks and never waits on the
+   *  writer: the reader retries only if a new copy was published while it
+   *  was being taken. A reader always sees the whole of a published copy,
+   *  never a copy being updated.
+   *
+   *  \code
+   *  typedef point_multiset<2, point> container_type;
+   *  snapshot_container<container_type> units;
+   *
+   *  // Main thread, once per frame:
+   *  units.edit().insert(p);   // or units.overwrite().assign(first, last)
+   *  units.publish();
+   *
+   *  // Worker threads, at any time:
+   *  snapshot_container<container_type>::reader view(units);
+   *  neighbor_iterator<const container_type> i = neighbor_begin(*view, p);
+   *  \endcode
+   *
+   *  Before it is updated again, the copy that was published last time must
+   *  be released by all the readers that pinned it: edit() and overwrite()
+   *  wait for it. Readers must therefore be short lived, and the thread that
+   *  edits the container must not hold a reader itself while doing so.
+   *
+   *  All the writer functions must be called from the same thread, or under
+   *  a lock of the caller's choosing.
+   *
+   *  \tparam Ct A container type, which must be copy assignable.
+   */
+  template <typename Ct>
+  class snapshot_container
+  {
+  public:
+    typedef Ct container_type;
+
+    /**
+     *  Pins the copy of the container published when it was created, and
+     *  gives read access to it until it is destroyed.
+     */
+    class reader
+    {
+    public:
+      explicit reader(const snapshot_container& snapshot)
+      {
+        for (;;)
+          {
+            size_type front = snapshot._front;
+            ++snapshot._readers[front];
+            // Only once the count is raised may the writer be trusted not
+            // to touch the copy; it may have moved on in the meantime.
+            if (snapshot._front == front)
+              {
+                _count = &snapshot._readers[front];
+                _container = &snapshot.buffer(front);
+                return;
+              }
+            --snapshot._readers[front];
+          }
+      }
+
+      ~reader() { --*_count; }
+
+      const Ct& operator*() const { return *_container; }
+      const Ct* operator->() const { return _container; }
+
+      //! The pinned copy of the container.
+      const Ct& get() const { return *_container; }
+
+    private:
+      reader(const reader&);             // not copyable
+      reader& operator=(const reader&);  // not assignable
+
+      details::Snapshot_count* _count;
+      const Ct* _container;
+    };
+
+    //! Publishes a default constructed container.
+    snapshot_container() : _front(0), _stale(false)
+    { _readers[0] = 0; _readers[1] = 0; }
+
+    //! Publishes a copy of \c container.
+    explicit snapshot_container(const Ct& container)
+      : _first(container), _second(container), _front(0), _stale(false)
+    { _readers[0] = 0; _readers[1] = 0; }
+
+    /**
+     *  The copy of the container published last, as seen by the writer. No
+     *  reader is needed to read it from the thread that publishes.
+     */
+    const Ct& published() const { return buffer(_front); }
+
+    /**
+     *  Returns the working copy of the container, made equal to the copy
+     *  published last if needed, for the writer to update.
+     *
+     *  Waits for the readers of the copy published the time before last to
+     *  release it. Copying the published container reuses the memory of the
+     *  working copy whenever \c Ct supports it.
+     */
+    Ct& edit()
+    {
+      Ct& back = drain();
+      if (_stale) { back = published(); _stale = false; }
+      return back;
+    }
+
+    /**
+     *  Returns the working copy of the container without bringing it up to
+     *  date: it holds an older version, that the writer is expected to
+     *  replace entirely, with \c assign() or \c clear() for instance.
+     */
+    Ct& overwrite()
+    {
+      Ct& back = drain();
+      _stale = false;
+      return back;
+    }
+
+    /**
+     *  Publishes the working copy. The readers created from now on see it,
+     *  while the existing readers keep the previous copy.
+     */
+    void publish()
+    {
+      _front = 1 - static_cast<size_type>(_front);
+      _stale = true;
+    }
+
+  private:
+    snapshot_container(const snapshot_container&);             // not copyable
+    snapshot_container& operator=(const snapshot_container&);  // not assignable
+
+    Ct& buffer(size_type i) { return i == 0 ? _first : _second; }
+    const Ct& buffer(size_type i) const { return i == 0 ? _first : _second; }
+
+    //! Waits until no reader holds the working copy and returns it.
+    Ct& drain()
+    {
+      size_type back = 1 - static_cast<size_type>(_front);
+#ifdef SPATIAL_THREAD
+      while (_readers[back] != 0) { std::this_thread::yield(); }
+#else
+      // Without threads, waiting would never end
+      SPATIAL_ASSERT_CHECK(_readers[back] == 0);
+#endif
+      return buffer(back);
+    }
+
+    Ct _first;
+    Ct _second;
+    details::Snapshot_count _front;
+    mutable details::Snapshot_count _readers[2];
+    bool _stale;
+  };
+
+} // namespace spatial
+
+#endif // SPATIAL_SNAPSHOT_HPP
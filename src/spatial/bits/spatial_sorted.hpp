@@ -0,0 +1,338 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_sorted.hpp
+ *  Provides the functions that list the elements of a container in the order
+ *  of \mapping_iterator or \ordered_iterator in one walk through the tree,
+ *  and \ref mapping_index, which keeps that list for a container that no
+ *  longer changes.
+ */
+
+#ifndef SPATIAL_SORTED_HPP
+#define SPATIAL_SORTED_HPP
+
+#include <algorithm> // std::sort, std::stable_sort, std::lower_bound
+#include <utility>   // std::pair
+#include <vector>
+
+#include "../traits.hpp"
+#include "spatial_node.hpp"
+#include "spatial_rank.hpp"
+#include "spatial_except.hpp"
+#include "spatial_ordered.hpp"
+#include "spatial_assert.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  Visits, in in-order, all the nodes in the sub-tree under \c node whose
+     *  key along \c map is in the interval <tt>[lower, upper)</tt>. The left
+     *  side of a node that divides \c map is skipped when its key is below \c
+     *  lower, and its right side when its key is not below \c upper.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Visitor>
+    inline void
+    mapping_range_sub(NodePtr node, dimension_type dim, const Rank& rank,
+                      const KeyCompare& key_comp, dimension_type map,
+                      const Key& lower, const Key& upper, Visitor& visitor)
+    {
+      SPATIAL_ASSERT_CHECK(dim < rank());
+      SPATIAL_ASSERT_CHECK(node != 0);
+      SPATIAL_ASSERT_CHECK(!header(node));
+      for (;;)
+        {
+          const Key& key = const_key(node);
+          SPATIAL_STATS_COUNT(nodes_visited);
+          bool above_lower = !key_comp(map, key, lower);
+          bool below_upper = key_comp(map, key, upper);
+          dimension_type child_dim = incr_dim(rank, dim);
+          if (node->left != 0 && (dim != map || above_lower))
+            {
+              SPATIAL_STATS_COUNT(backtracks);
+              mapping_range_sub(NodePtr(node->left), child_dim, rank,
+                                key_comp, map, lower, upper, visitor);
+            }
+          if (above_lower && below_upper) { visitor(node); }
+          if (node->right == 0 || (dim == map && !below_upper)) return;
+          node = node->right; dim = child_dim;
+        }
+    }
+
+    //! Appends an iterator on each node visited to a sequence.
+    template <typename Iterator, typename Sequence>
+    struct Sorted_append
+    {
+      explicit Sorted_append(Sequence& out_) : out(out_) { }
+
+      template <typename NodePtr>
+      void
+      operator()(NodePtr node) { out.push_back(Iterator(node)); }
+
+      Sequence& out;
+    };
+
+    /**
+     *  Orders iterators along the dimension \c map, and compares them with
+     *  keys for the binary searches of \ref mapping_index.
+     */
+    template <typename Iterator, typename KeyCompare, typename Key>
+    struct Mapping_less
+    {
+      Mapping_less(const KeyCompare& key_comp_, dimension_type map_)
+        : key_comp(key_comp_), map(map_) { }
+
+      bool
+      operator()(const Iterator& x, const Iterator& y) const
+      { return key_comp(map, const_key(x.node), const_key(y.node)); }
+
+      bool
+      operator()(const Iterator& x, const Key& y) const
+      { return key_comp(map, const_key(x.node), y); }
+
+      bool
+      operator()(const Key& x, const Iterator& y) const
+      { return key_comp(map, x, const_key(y.node)); }
+
+      KeyCompare key_comp;
+      dimension_type map;
+    };
+
+    //! Orders iterators like \ordered_iterator does.
+    template <typename Iterator, typename KeyCompare, typename Rank>
+    struct Ordered_less
+    {
+      Ordered_less(const KeyCompare& key_comp_, const Rank& rank_)
+        : key_comp(key_comp_), rank(rank_) { }
+
+      bool
+      operator()(const Iterator& x, const Iterator& y) const
+      {
+        return order_ref(key_comp, rank, const_key(x.node),
+                         const_key(y.node));
+      }
+
+      KeyCompare key_comp;
+      Rank rank;
+    };
+
+    /**
+     *  Appends iterators on the elements of \c container whose key along \c
+     *  map is in <tt>[lower, upper)</tt> to \c out, and sorts them in the
+     *  order of \mapping_iterator.
+     */
+    template <typename Iterator, typename Ct, typename Sequence>
+    inline void
+    mapping_range_sorted
+    (Ct& container, dimension_type map,
+     const typename container_traits<Ct>::key_type& lower,
+     const typename container_traits<Ct>::key_type& upper, Sequence& out)
+    {
+      typedef typename container_traits<Ct>::key_type key_type;
+      typedef typename container_traits<Ct>::key_compare key_compare;
+      except::check_dimension(container.dimension(), map);
+      typename Iterator::node_ptr root = container.end().node->parent;
+      if (header(root)) return;
+      typename Sequence::size_type size = out.size();
+      Sorted_append<Iterator, Sequence> visitor(out);
+      mapping_range_sub(root, 0, container.rank(), container.key_comp(),
+                        map, lower, upper, visitor);
+      // The walk is in-order, so that a stable sort leaves equal elements in
+      // the order in which mapping_iterator finds them.
+      std::stable_sort(out.begin() + size, out.end(),
+                       Mapping_less<Iterator, key_compare, key_type>
+                       (container.key_comp(), map));
+    }
+  } // namespace details
+
+  /**
+   *  Appends all the elements of \c container whose coordinate along \c
+   *  mapping_dim is in the interval <tt>[lower, upper)</tt> to \c out, from
+   *  the smallest to the largest coordinate, in the same order as a
+   *  \mapping_iterator going from mapping_lower_bound() on \c lower.
+   *
+   *  The search walks the tree once, skipping every part of it that lies
+   *  outside the interval, and sorts what it found. Listing \e n elements
+   *  therefore costs \Onlogn, against many more steps through the tree for
+   *  the \mapping_iterator, which searches the tree again for every element.
+   *  Prefer it whenever all the elements of an interval are needed.
+   *
+   *  \param container The container to search.
+   *  \param mapping_dim The dimension along which elements are sorted.
+   *  \param lower Only the coordinate of \c lower along \c mapping_dim is
+   *  used: the smallest coordinate found.
+   *  \param upper Only the coordinate of \c upper along \c mapping_dim is
+   *  used: all coordinates found are strictly smaller.
+   *  \param out A sequence with random access iterators, such as a \c
+   *  std::vector, of \c Ct::iterator, or of \c Ct::const_iterator when the
+   *  container is constant. Elements already in \c out are left untouched.
+   *  \throw invalid_dimension If \c mapping_dim is not less than the rank of
+   *  the container.
+   */
+  ///@{
+  template <typename Ct, typename Sequence>
+  inline void
+  mapping_range_sorted(Ct& container, dimension_type mapping_dim,
+                       const typename container_traits<Ct>::key_type& lower,
+                       const typename container_traits<Ct>::key_type& upper,
+                       Sequence& out)
+  {
+    details::mapping_range_sorted<typename container_traits<Ct>::iterator>
+      (container, mapping_dim, lower, upper, out);
+  }
+
+  template <typename Ct, typename Sequence>
+  inline void
+  mapping_range_sorted(const Ct& container, dimension_type mapping_dim,
+                       const typename container_traits<Ct>::key_type& lower,
+                       const typename container_traits<Ct>::key_type& upper,
+                       Sequence& out)
+  {
+    details::mapping_range_sorted
+      <typename container_traits<Ct>::const_iterator>
+      (container, mapping_dim, lower, upper, out);
+  }
+  ///@}
+
+  /**
+   *  Appends all the elements of \c container to \c out in the same order as
+   *  the \ordered_iterator, in \Onlogn for \e n elements.
+   *
+   *  \param container The container to list.
+   *  \param out A sequence with random access iterators, such as a \c
+   *  std::vector, of \c Ct::iterator, or of \c Ct::const_iterator when the
+   *  container is constant. Elements already in \c out are left untouched.
+   */
+  ///@{
+  template <typename Ct, typename Sequence>
+  inline void
+  ordered_range_sorted(Ct& container, Sequence& out)
+  {
+    typedef typename container_traits<Ct>::iterator iterator;
+    typename Sequence::size_type size = out.size();
+    for (iterator i = container.begin(); i != container.end(); ++i)
+      { out.push_back(i); }
+    std::sort(out.begin() + size, out.end(),
+              details::Ordered_less
+              <iterator, typename container_traits<Ct>::key_compare,
+               typename container_traits<Ct>::rank_type>
+              (container.key_comp(), container.rank()));
+  }
+
+  template <typename Ct, typename Sequence>
+  inline void
+  ordered_range_sorted(const Ct& container, Sequence& out)
+  {
+    typedef typename container_traits<Ct>::const_iterator iterator;
+    typename Sequence::size_type size = out.size();
+    for (iterator i = container.begin(); i != container.end(); ++i)
+      { out.push_back(i); }
+    std::sort(out.begin() + size, out.end(),
+              details::Ordered_less
+              <iterator, typename container_traits<Ct>::key_compare,
+               typename container_traits<Ct>::rank_type>
+              (container.key_comp(), container.rank()));
+  }
+  ///@}
+
+  /**
+   *  The elements of a container sorted along one dimension, for a
+   *  container that is queried many times along that dimension but rarely
+   *  modified, such as the \c frozen_ containers.
+   *
+   *  Building the index costs \Onlogn and keeps one iterator per element.
+   *  Afterwards, the elements are found by binary search and walked in
+   *  constant time per element, in the same order as with \mapping_iterator:
+   *  \code
+   *  mapping_index<container_type> by_x(container, 0);
+   *  for (mapping_index<container_type>::iterator i = by_x.lower_bound(low);
+   *       i != by_x.lower_bound(high); ++i)
+   *    { use((*i)->second); }
+   *  \endcode
+   *
+   *  The index holds iterators on the container: it must be rebuilt with
+   *  rebuild() after the container is modified, and must not outlive it.
+   *
+   *  \tparam Ct The type of container indexed.
+   */
+  template <typename Ct>
+  class mapping_index
+  {
+  public:
+    typedef typename container_traits<Ct>::key_type       key_type;
+    typedef typename container_traits<Ct>::key_compare    key_compare;
+    typedef typename container_traits<Ct>::const_iterator value_type;
+    typedef typename std::vector<value_type>::const_iterator iterator;
+    typedef iterator                                      const_iterator;
+    typedef typename std::vector<value_type>::size_type   size_type;
+
+    /**
+     *  Indexes all the elements of \c container along \c mapping_dim.
+     *
+     *  \throw invalid_dimension If \c mapping_dim is not less than the rank
+     *  of the container.
+     */
+    mapping_index(const Ct& container, dimension_type mapping_dim)
+      : _less(container.key_comp(), mapping_dim)
+    {
+      except::check_dimension(container.dimension(), mapping_dim);
+      rebuild(container);
+    }
+
+    //! Indexes the elements of \c container again, along the same dimension.
+    void rebuild(const Ct& container)
+    {
+      _index.clear();
+      _index.reserve(container.size());
+      _less.key_comp = container.key_comp();
+      for (value_type i = container.begin(); i != container.end(); ++i)
+        { _index.push_back(i); }
+      // The container iterates in-order, like mapping_range_sorted() does
+      std::stable_sort(_index.begin(), _index.end(), _less);
+    }
+
+    //! The dimension along which the elements are sorted.
+    dimension_type mapping_dim() const { return _less.map; }
+
+    iterator begin() const { return _index.begin(); }
+    iterator end() const { return _index.end(); }
+    size_type size() const { return _index.size(); }
+    bool empty() const { return _index.empty(); }
+
+    //! The element with the given position in the index.
+    const value_type& operator[](size_type i) const { return _index[i]; }
+
+    /**
+     *  The first element whose coordinate along mapping_dim() is not less
+     *  than that of \c bound, in \Ologn.
+     */
+    iterator lower_bound(const key_type& bound) const
+    { return std::lower_bound(_index.begin(), _index.end(), bound, _less); }
+
+    /**
+     *  The first element whose coordinate along mapping_dim() is greater
+     *  than that of \c bound, in \Ologn.
+     */
+    iterator upper_bound(const key_type& bound) const
+    { return std::upper_bound(_index.begin(), _index.end(), bound, _less); }
+
+    //! The elements whose coordinate along mapping_dim() equals \c bound's.
+    std::pair<iterator, iterator> equal_range(const key_type& bound) const
+    { return std::equal_range(_index.begin(), _index.end(), bound, _less); }
+
+  private:
+    std::vector<value_type> _index;
+    details::Mapping_less<value_type, key_compare, key_type> _less;
+  };
+
+} // namespace spatial
+
+#endif // SPATIAL_SORTED_HPP
@@ -0,0 +1,292 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_stats.hpp
+ *  Provide counters on the work done by the algorithms of the library, to
+ *  find out why a query is slow or which container suits a workload best.
+ *
+ *  The counters are only updated when SPATIAL_ENABLE_STATS is defined before
+ *  including any header of the library. Otherwise \ref SPATIAL_STATS_COUNT
+ *  expands to nothing and the algorithms are left untouched; the functions
+ *  below remain available and simply report zeros.
+ *
+ *  Each thread updates its own counters, so that counting does not need any
+ *  synchronization. To attribute the work to one container, sample the
+ *  counters of the current thread around the calls made on it:
+ *  \code
+ *  spatial::stats::sample sample;
+ *  container.insert(key);
+ *  neighbor_begin(container, key);
+ *  std::cout << sample.elapsed() << std::endl;
+ *  \endcode
+ */
+
+#ifndef SPATIAL_STATS_HPP
+#define SPATIAL_STATS_HPP
+
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#ifdef SPATIAL_ENABLE_STATS
+#  include <iostream> // std::clog, only needed by the default report
+#endif
+#include "../spatial.hpp"
+#include "spatial_import_thread.hpp"
+#ifdef SPATIAL_THREAD
+#  include <mutex>
+#endif
+
+namespace spatial
+{
+  /**
+   *  This namespace isolates the instrumentation of the library.
+   */
+  namespace stats
+  {
+    /**
+     *  The work done by the algorithms of the library, since the counters
+     *  were last reset.
+     */
+    struct counters
+    {
+      counters()
+        : nodes_visited(0), distance_evaluations(0), backtracks(0),
+          inserts(0), erases(0), rebalances(0) { }
+
+      //! The number of keys tested against a region, a distance or a cell.
+      size_type nodes_visited;
+
+      //! The number of calls to \c distance_to_key() on a \metric.
+      size_type distance_evaluations;
+
+      //! The number of times a search climbed back up to resume elsewhere.
+      size_type backtracks;
+
+      //! The number of values inserted in a container.
+      size_type inserts;
+
+      //! The number of values erased from a container.
+      size_type erases;
+
+      //! The number of sub-trees rebuilt to restore the balance of a tree.
+      size_type rebalances;
+
+      counters& operator+=(const counters& other)
+      {
+        nodes_visited += other.nodes_visited;
+        distance_evaluations += other.distance_evaluations;
+        backtracks += other.backtracks;
+        inserts += other.inserts;
+        erases += other.erases;
+        rebalances += other.rebalances;
+        return *this;
+      }
+
+      counters& operator-=(const counters& other)
+      {
+        nodes_visited -= other.nodes_visited;
+        distance_evaluations -= other.distance_evaluations;
+        backtracks -= other.backtracks;
+        inserts -= other.inserts;
+        erases -= other.erases;
+        rebalances -= other.rebalances;
+        return *this;
+      }
+    };
+
+    inline counters operator+(counters x, const counters& y)
+    { return x += y; }
+
+    inline counters operator-(counters x, const counters& y)
+    { return x -= y; }
+
+    //! Writes all the counters on a single line.
+    inline std::ostream&
+    operator<<(std::ostream& o, const counters& x)
+    {
+      return o << "nodes visited: " << x.nodes_visited
+               << ", distance evaluations: " << x.distance_evaluations
+               << ", backtracks: " << x.backtracks
+               << ", inserts: " << x.inserts
+               << ", erases: " << x.erases
+               << ", rebalances: " << x.rebalances;
+    }
+
+    /**
+     *  The type of the function called by \ref report() with the counters of
+     *  all the threads.
+     */
+    typedef void (*report_hook)(const counters&);
+
+    namespace details
+    {
+      /**
+       *  Keeps track of the counters of all the threads, so that they can be
+       *  added up, along with those of the threads that have finished.
+       */
+      struct Registry
+      {
+        Registry() : hook(0) { }
+
+#ifdef SPATIAL_THREAD
+        std::mutex mutex;
+#endif
+        std::vector<const counters*> live;
+        counters retired;
+        report_hook hook;
+      };
+
+      inline Registry& registry()
+      {
+        static Registry instance;
+        return instance;
+      }
+
+#ifdef SPATIAL_THREAD
+      /**
+       *  The counters of one thread, which register themselves with the \ref
+       *  Registry for the lifetime of the thread.
+       */
+      struct Thread_counters
+      {
+        Thread_counters()
+        {
+          Registry& r = registry();
+          std::lock_guard<std::mutex> lock(r.mutex);
+          r.live.push_back(&value);
+        }
+
+        ~Thread_counters()
+        {
+          Registry& r = registry();
+          std::lock_guard<std::mutex> lock(r.mutex);
+          r.retired += value;
+          r.live.erase(std::find(r.live.begin(), r.live.end(), &value));
+        }
+
+        counters value;
+      };
+#endif
+    } // namespace details
+
+    /**
+     *  Returns the counters of the calling thread. They may be read or reset
+     *  at any time by that thread.
+     */
+    inline counters& thread_counters()
+    {
+#ifdef SPATIAL_THREAD
+      static thread_local details::Thread_counters instance;
+      return instance.value;
+#else
+      static counters instance;
+      return instance;
+#endif
+    }
+
+    /**
+     *  Returns the sum of the counters of all the threads, including the
+     *  threads that have finished. The counters of other threads are read
+     *  without synchronization: call this function when they are idle.
+     */
+    inline counters aggregate()
+    {
+#ifdef SPATIAL_THREAD
+      thread_counters(); // registers the calling thread
+      details::Registry& r = details::registry();
+      std::lock_guard<std::mutex> lock(r.mutex);
+      counters total = r.retired;
+      for (std::vector<const counters*>::const_iterator i = r.live.begin();
+           i != r.live.end(); ++i)
+        { total += **i; }
+      return total;
+#else
+      return thread_counters();
+#endif
+    }
+
+    /**
+     *  Sets the function called by \ref report() and returns the previous one.
+     *  Pass 0 to restore the default, which prints the counters on \c
+     *  std::clog when SPATIAL_ENABLE_STATS is defined and does nothing
+     *  otherwise.
+     */
+    inline report_hook set_report_hook(report_hook hook)
+    {
+      details::Registry& r = details::registry();
+#ifdef SPATIAL_THREAD
+      std::lock_guard<std::mutex> lock(r.mutex);
+#endif
+      std::swap(r.hook, hook);
+      return hook;
+    }
+
+    /**
+     *  Calls the report hook with the counters of all the threads, as given
+     *  by \ref aggregate().
+     */
+    inline void report()
+    {
+      counters total = aggregate();
+      report_hook hook;
+      {
+        details::Registry& r = details::registry();
+#ifdef SPATIAL_THREAD
+        std::lock_guard<std::mutex> lock(r.mutex);
+#endif
+        hook = r.hook;
+      }
+      if (hook != 0) { hook(total); }
+#ifdef SPATIAL_ENABLE_STATS
+      else { std::clog << total << std::endl; }
+#endif
+    }
+
+    /**
+     *  Records the counters of the calling thread on construction, and gives
+     *  the work done by that thread since then.
+     */
+    class sample
+    {
+    public:
+      sample() : _start(thread_counters()) { }
+
+      //! The work done by the calling thread since the sample was taken.
+      stats::counters elapsed() const { return thread_counters() - _start; }
+
+      //! Takes the sample again.
+      void restart() { _start = thread_counters(); }
+
+    private:
+      stats::counters _start;
+    };
+  } // namespace stats
+} // namespace spatial
+
+#ifdef SPATIAL_ENABLE_STATS
+#  define SPATIAL_STATS_COUNT(counter)                          \
+  (++::spatial::stats::thread_counters().counter)
+#  define SPATIAL_STATS_ADD(counter, n)                         \
+  (::spatial::stats::thread_counters().counter += (n))
+#else
+/**
+ *  \def SPATIAL_STATS_COUNT(counter)
+ *  Increments \c counter, one of the members of \ref stats::counters, for the
+ *  calling thread. Expands to nothing unless SPATIAL_ENABLE_STATS is defined.
+ */
+#  define SPATIAL_STATS_COUNT(counter) ((void)0)
+
+/**
+ *  \def SPATIAL_STATS_ADD(counter, n)
+ *  Adds \c n to \c counter for the calling thread, like \ref
+ *  SPATIAL_STATS_COUNT.
+ */
+#  define SPATIAL_STATS_ADD(counter, n) ((void)0)
+#endif
+
+#endif // SPATIAL_STATS_HPP
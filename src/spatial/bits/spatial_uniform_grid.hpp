@@ -0,0 +1,1172 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_uniform_grid.hpp
+ *  Defines a container that sorts its values into the cells of a uniform
+ *  grid, along with its region and neighbor iterators.
+ *
+ *  Space is cut into cubic cells of the same size. The values are stored in
+ *  a single array, and the values of a cell are chained to each other by
+ *  their indices. The cells that hold values are found in an open addressing
+ *  hash table, indexed by the coordinates of the cell.
+ *
+ *  Inserting, erasing or moving a value only touches its cell, in constant
+ *  time. Clearing the container keeps all the arrays, so a container that is
+ *  filled again every frame stops allocating memory once it has seen its
+ *  largest number of values and cells.
+ *
+ *  \see Uniform_grid
+ */
+
+#ifndef SPATIAL_UNIFORM_GRID_HPP
+#define SPATIAL_UNIFORM_GRID_HPP
+
+#include <algorithm> // std::make_heap, std::pop_heap
+#include <cmath>     // std::sqrt, std::floor
+#include <functional> // std::greater
+#include <iterator>  // std::reverse_iterator
+#include <stdexcept> // std::length_error
+#include <utility>   // std::pair
+#include <vector>
+
+#include "../function.hpp"
+#include "../traits.hpp"
+#include "spatial_rank.hpp"
+#include "spatial_builtin.hpp"
+#include "spatial_mutate.hpp"
+#include "spatial_value_compare.hpp"
+#include "spatial_template_member_swap.hpp"
+#include "spatial_except.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  A container of values sorted into the cells of a uniform grid, used
+     *  by grid_multimap.
+     *
+     *  The coordinates of the keys are read with the accessor of \c Compare,
+     *  which must be one of the builtin comparators of the library, and the
+     *  cell of a key along each dimension is its coordinate divided by the
+     *  cell size, rounded down.
+     *
+     *  Inserting a value never invalidates iterators, unless the array of
+     *  values grows. Erasing a value moves the last value of the array into
+     *  its place, which invalidates the iterators to the last value. Moving a
+     *  value with relocate() does not invalidate any iterator.
+     */
+    template <dimension_type Rank, typename Key, typename Value,
+              typename Compare, typename Alloc>
+    class Uniform_grid
+    {
+    public:
+      // Container intrincsic types
+      typedef Static_rank<Rank>                           rank_type;
+      typedef typename mutate<Key>::type                  key_type;
+      typedef typename mutate<Value>::type                value_type;
+      typedef void                                        mode_type;
+      typedef Compare                                     key_compare;
+      typedef ValueCompare<value_type, key_compare>       value_compare;
+      typedef Alloc                                       allocator_type;
+
+      //! The number of dimensions of the keys.
+      enum { static_rank = Rank };
+
+    private:
+      typedef std::vector<value_type, Alloc>              Value_vector;
+
+    public:
+      // Container iterator related types
+      typedef typename Value_vector::pointer              pointer;
+      typedef typename Value_vector::const_pointer        const_pointer;
+      typedef typename Value_vector::reference            reference;
+      typedef typename Value_vector::const_reference      const_reference;
+      typedef typename Value_vector::size_type            size_type;
+      typedef typename Value_vector::difference_type      difference_type;
+      typedef typename Value_vector::iterator             iterator;
+      typedef typename Value_vector::const_iterator       const_iterator;
+      typedef std::reverse_iterator<iterator>             reverse_iterator;
+      typedef std::reverse_iterator<const_iterator>
+      const_reverse_iterator;
+
+      //! The index of a missing value or cell.
+      static size_type npos() { return static_cast<size_type>(-1); }
+
+    private:
+      //! The links of a value to the other values of its cell.
+      struct Link
+      {
+        size_type prev;
+        size_type next;
+        size_type cell;
+      };
+
+      /**
+       *  A slot of the hash table of cells. The slot is used if its stamp is
+       *  the stamp of the table, so that clearing the table only takes a
+       *  new stamp.
+       */
+      struct Cell
+      {
+        long coord[Rank];
+        size_type head;
+        unsigned int stamp;
+      };
+
+      typedef std::vector
+      <Link, typename Alloc::template rebind<Link>::other> Link_vector;
+      typedef std::vector
+      <Cell, typename Alloc::template rebind<Cell>::other> Cell_vector;
+
+    public:
+      Uniform_grid()
+        : _compare(), _cell_size(1.0), _values(), _links(), _cells(),
+          _stamp(1), _used(0)
+      { }
+
+      explicit Uniform_grid(double cell_size)
+        : _compare(), _cell_size(cell_size), _values(), _links(), _cells(),
+          _stamp(1), _used(0)
+      { check_cell_size(cell_size); }
+
+      Uniform_grid(double cell_size, const key_compare& compare)
+        : _compare(compare), _cell_size(cell_size), _values(), _links(),
+          _cells(), _stamp(1), _used(0)
+      { check_cell_size(cell_size); }
+
+      Uniform_grid(double cell_size, const key_compare& compare,
+                   const allocator_type& alloc)
+        : _compare(compare), _cell_size(cell_size), _values(alloc),
+          _links(alloc), _cells(alloc), _stamp(1), _used(0)
+      { check_cell_size(cell_size); }
+
+      Uniform_grid(const Uniform_grid& other)
+        : _compare(other._compare), _cell_size(other._cell_size),
+          _values(other._values), _links(other._links),
+          _cells(other._cells), _stamp(other._stamp), _used(other._used)
+      { }
+
+      /**
+       *  Assignment of \c other into the container. Keys are constant, so the
+       *  copy is built aside and swapped in.
+       */
+      Uniform_grid&
+      operator=(const Uniform_grid& other)
+      {
+        if (&other != this)
+          {
+            Uniform_grid copy(other);
+            swap(copy);
+          }
+        return *this;
+      }
+
+      iterator begin() { return _values.begin(); }
+      const_iterator begin() const { return _values.begin(); }
+      const_iterator cbegin() const { return _values.begin(); }
+
+      iterator end() { return _values.end(); }
+      const_iterator end() const { return _values.end(); }
+      const_iterator cend() const { return _values.end(); }
+
+      reverse_iterator rbegin() { return reverse_iterator(end()); }
+      const_reverse_iterator rbegin() const
+      { return const_reverse_iterator(end()); }
+      const_reverse_iterator crbegin() const
+      { return const_reverse_iterator(end()); }
+
+      reverse_iterator rend() { return reverse_iterator(begin()); }
+      const_reverse_iterator rend() const
+      { return const_reverse_iterator(begin()); }
+      const_reverse_iterator crend() const
+      { return const_reverse_iterator(begin()); }
+
+      rank_type rank() const { return rank_type(); }
+
+      dimension_type dimension() const { return Rank; }
+
+      key_compare key_comp() const { return _compare; }
+
+      value_compare value_comp() const { return value_compare(_compare); }
+
+      allocator_type get_allocator() const
+      { return _values.get_allocator(); }
+
+      //! Returns the length of the side of the cells.
+      double cell_size() const { return _cell_size; }
+
+      size_type size() const { return _values.size(); }
+
+      size_type count() const { return _values.size(); }
+
+      bool empty() const { return _values.empty(); }
+
+      size_type max_size() const { return _links.max_size(); }
+
+      //! Returns the number of values the container can hold without
+      //! allocating memory, if they fall in the cells already known.
+      size_type capacity() const { return _values.capacity(); }
+
+      /**
+       *  Reserves room for \c n values spread over at most \c n cells, so
+       *  that inserting them does not allocate memory.
+       */
+      void
+      reserve(size_type n)
+      {
+        _values.reserve(n);
+        _links.reserve(n);
+        if (2 * n > _cells.size()) rehash(n);
+      }
+
+      /**
+       *  Erases all the values, keeping the memory of the container for the
+       *  next values.
+       */
+      void
+      clear()
+      {
+        _values.clear();
+        _links.clear();
+        new_stamp();
+      }
+
+      void
+      swap(Uniform_grid& other)
+      {
+        template_member_swap<key_compare>::do_it(_compare, other._compare);
+        std::swap(_cell_size, other._cell_size);
+        _values.swap(other._values);
+        _links.swap(other._links);
+        _cells.swap(other._cells);
+        std::swap(_stamp, other._stamp);
+        std::swap(_used, other._used);
+      }
+
+      /**
+       *  Inserts \c value in the container in constant amortized time and
+       *  returns an iterator to it.
+       */
+      iterator
+      insert(const value_type& value)
+      {
+        long coord[Rank];
+        cell_of(value.first, coord);
+        size_type cell = add_cell(coord); // may throw
+        _links.push_back(Link()); // may throw
+        try { _values.push_back(value); }
+        catch (...) { _links.pop_back(); throw; }
+        size_type i = _values.size() - 1;
+        link(i, cell);
+        SPATIAL_STATS_COUNT(inserts);
+        return begin() + i;
+      }
+
+      //! Inserts all the values in <tt>[first, last)</tt>.
+      template <typename InputIterator>
+      void
+      insert(InputIterator first, InputIterator last)
+      { for (; first != last; ++first) { insert(*first); } }
+
+      /**
+       *  Replaces all the values of the container with the values in
+       *  <tt>[first, last)</tt>, reusing the memory of the container.
+       */
+      template <typename InputIterator>
+      void
+      assign(InputIterator first, InputIterator last)
+      {
+        clear();
+        insert(first, last);
+      }
+
+      /**
+       *  Erases the value pointed to by \c position in constant time. The
+       *  last value of the container is moved into its place.
+       *
+       *  \exception invalid_iterator is thrown if \c position does not point
+       *  to an element of this container.
+       */
+      void
+      erase(iterator position)
+      {
+        size_type i = check_position(position);
+        size_type last = _values.size() - 1;
+        unlink(i);
+        if (i != last)
+          {
+            // The copy constructor of the value must not throw
+            allocator_type alloc = get_allocator();
+            alloc.destroy(mutate_pointer(&_values[i]));
+            alloc.construct(mutate_pointer(&_values[i]), _values[last]);
+            _links[i] = _links[last];
+            if (_links[i].prev == npos()) { _cells[_links[i].cell].head = i; }
+            else { _links[_links[i].prev].next = i; }
+            if (_links[i].next != npos()) { _links[_links[i].next].prev = i; }
+          }
+        _values.pop_back();
+        _links.pop_back();
+        SPATIAL_STATS_COUNT(erases);
+      }
+
+      /**
+       *  Erases all the values whose key is equal to \c key along all
+       *  dimensions and returns their number.
+       */
+      size_type
+      erase(const key_type& key)
+      {
+        long coord[Rank];
+        cell_of(key, coord);
+        size_type cell = find_cell(coord);
+        if (cell == npos()) return 0;
+        size_type n = 0;
+        size_type i = _cells[cell].head;
+        while (i != npos())
+          {
+            if (equal_key(_values[i].first, key))
+              {
+                erase(begin() + i);
+                ++n;
+                // The value moved into i, if any, may belong to this cell
+                i = _cells[cell].head;
+              }
+            else { i = _links[i].next; }
+          }
+        return n;
+      }
+
+      /**
+       *  Replaces the key of the value pointed to by \c position with \c key,
+       *  moving the value into the cell of \c key, in constant time. The
+       *  value keeps its place in the array, and iterators remain valid.
+       *
+       *  \exception invalid_iterator is thrown if \c position does not point
+       *  to an element of this container.
+       */
+      iterator
+      relocate(iterator position, const key_type& key)
+      {
+        size_type i = check_position(position);
+        long coord[Rank];
+        cell_of(key, coord);
+        size_type cell = add_cell(coord); // may throw, the cell may move
+        value_type tmp(key, _values[i].second); // may throw
+        allocator_type alloc = get_allocator();
+        alloc.destroy(mutate_pointer(&_values[i]));
+        alloc.construct(mutate_pointer(&_values[i]), tmp);
+        if (_links[i].cell != cell)
+          {
+            unlink(i);
+            link(i, cell);
+          }
+        return position;
+      }
+
+      ///@{
+      /**
+       *  Returns an iterator to a value whose key is equal to \c key along
+       *  all dimensions, or end() if there are none.
+       */
+      iterator
+      find(const key_type& key)
+      { return begin() + find_index(key); }
+
+      const_iterator
+      find(const key_type& key) const
+      { return begin() + find_index(key); }
+      ///@}
+
+    public:
+      // Accessors to the cells, used by the iterators
+      //! Returns the coordinate of \c key along \c dim.
+      double
+      coordinate(dimension_type dim, const key_type& key) const
+      { return builtin_coordinate(_compare, dim, key); }
+
+      //! Stores the coordinates of the cell of \c key in \c coord.
+      void
+      cell_of(const key_type& key, long* coord) const
+      {
+        for (dimension_type d = 0; d < Rank; ++d)
+          {
+            coord[d] = static_cast<long>
+              (std::floor(coordinate(d, key) / _cell_size));
+          }
+      }
+
+      //! Returns the cell at \c coord, or npos() if it holds no value.
+      size_type
+      find_cell(const long* coord) const
+      {
+        if (_cells.empty()) return npos();
+        size_type mask = _cells.size() - 1;
+        for (size_type c = hash(coord) & mask; ; c = (c + 1) & mask)
+          {
+            const Cell& cell = _cells[c];
+            if (cell.stamp != _stamp) return npos();
+            if (same_coord(cell.coord, coord)) return c;
+          }
+      }
+
+      //! Returns the first value of the cell at \c coord, or npos().
+      size_type
+      cell_head(const long* coord) const
+      {
+        size_type c = find_cell(coord);
+        return c == npos() ? npos() : _cells[c].head;
+      }
+
+      //! Returns the next value in the cell of the value \c i, or npos().
+      size_type next(size_type i) const { return _links[i].next; }
+
+      //! Returns the coordinates of the cell of the value \c i.
+      const long* cell_coord(size_type i) const
+      { return _cells[_links[i].cell].coord; }
+
+      //! Returns the number of cells in use, some of which may be empty.
+      size_type cell_count() const { return _used; }
+
+      //! Returns the key of the value \c i.
+      const key_type& key(size_type i) const { return _values[i].first; }
+
+    private:
+      static void
+      check_cell_size(double cell_size)
+      {
+        if (!(cell_size > 0.0))
+          { throw invalid_distance("cell size must be strictly positive"); }
+      }
+
+      static size_type
+      hash(const long* coord)
+      {
+        size_type h = 0;
+        for (dimension_type d = 0; d < Rank; ++d)
+          {
+            h = (h ^ static_cast<size_type>(coord[d]))
+              * static_cast<size_type>(0x9e3779b1u);
+          }
+        return h ^ (h >> 16);
+      }
+
+      static bool
+      same_coord(const long* a, const long* b)
+      {
+        for (dimension_type d = 0; d < Rank; ++d)
+          { if (a[d] != b[d]) return false; }
+        return true;
+      }
+
+      bool
+      equal_key(const key_type& a, const key_type& b) const
+      {
+        for (dimension_type d = 0; d < Rank; ++d)
+          { if (_compare(d, a, b) || _compare(d, b, a)) return false; }
+        return true;
+      }
+
+      size_type
+      find_index(const key_type& key) const
+      {
+        long coord[Rank];
+        cell_of(key, coord);
+        size_type cell = find_cell(coord);
+        if (cell == npos()) return size();
+        for (size_type i = _cells[cell].head; i != npos(); i = _links[i].next)
+          { if (equal_key(_values[i].first, key)) return i; }
+        return size();
+      }
+
+      size_type
+      check_position(const_iterator position) const
+      {
+        size_type i = static_cast<size_type>(position - begin());
+        if (i >= size())
+          {
+            throw invalid_iterator
+              ("iterator is invalid or does not belong to the container used");
+          }
+        return i;
+      }
+
+      //! Returns the cell at \c coord, adding it to the table if needed.
+      size_type
+      add_cell(const long* coord)
+      {
+        size_type c = find_cell(coord);
+        if (c != npos()) return c;
+        if (2 * (_used + 1) > _cells.size()) rehash(1);
+        size_type mask = _cells.size() - 1;
+        for (c = hash(coord) & mask; _cells[c].stamp == _stamp;
+             c = (c + 1) & mask) { }
+        Cell& cell = _cells[c];
+        for (dimension_type d = 0; d < Rank; ++d) { cell.coord[d] = coord[d]; }
+        cell.head = npos();
+        cell.stamp = _stamp;
+        ++_used;
+        return c;
+      }
+
+      /**
+       *  Rebuilds the table of cells with room for \c n more cells, dropping
+       *  the cells that became empty. The table is kept at most half full.
+       */
+      void
+      rehash(size_type n)
+      {
+        SPATIAL_STATS_COUNT(rebalances);
+        size_type live = 0;
+        for (size_type c = 0; c < _cells.size(); ++c)
+          {
+            if (_cells[c].stamp == _stamp && _cells[c].head != npos())
+              { ++live; }
+          }
+        size_type capacity = 16;
+        while (capacity < 2 * (live + n) || capacity < 4 * live)
+          { capacity *= 2; }
+        if (capacity > _cells.max_size())
+          { throw std::length_error("Uniform_grid::rehash"); }
+        Cell_vector cells(capacity, Cell(), _cells.get_allocator());
+        size_type mask = capacity - 1;
+        for (size_type c = 0; c < _cells.size(); ++c)
+          {
+            const Cell& cell = _cells[c];
+            if (cell.stamp != _stamp || cell.head == npos()) continue;
+            size_type to = hash(cell.coord) & mask;
+            while (cells[to].stamp == 1) { to = (to + 1) & mask; }
+            cells[to] = cell;
+            cells[to].stamp = 1;
+            for (size_type i = cell.head; i != npos(); i = _links[i].next)
+              { _links[i].cell = to; }
+          }
+        _cells.swap(cells);
+        _stamp = 1;
+        _used = live;
+      }
+
+      //! Marks all the cells unused, resetting the stamps when they wrap.
+      void
+      new_stamp()
+      {
+        _used = 0;
+        if (++_stamp == 0)
+          {
+            for (size_type c = 0; c < _cells.size(); ++c)
+              { _cells[c].stamp = 0; }
+            _stamp = 1;
+          }
+      }
+
+      void
+      link(size_type i, size_type cell)
+      {
+        Link& l = _links[i];
+        l.cell = cell;
+        l.prev = npos();
+        l.next = _cells[cell].head;
+        if (l.next != npos()) { _links[l.next].prev = i; }
+        _cells[cell].head = i;
+      }
+
+      void
+      unlink(size_type i)
+      {
+        const Link& l = _links[i];
+        if (l.prev == npos()) { _cells[l.cell].head = l.next; }
+        else { _links[l.prev].next = l.next; }
+        if (l.next != npos()) { _links[l.next].prev = l.prev; }
+      }
+
+      key_compare _compare;
+      double _cell_size;
+      Value_vector _values;
+      Link_vector _links;
+      Cell_vector _cells;
+      unsigned int _stamp;
+      size_type _used;
+    };
+
+    //! The iterator of a \ref Uniform_grid on which \c Ct iterates.
+    ///@{
+    template <typename Ct>
+    struct Grid_iterator
+    { typedef typename Ct::iterator type; };
+
+    template <typename Ct>
+    struct Grid_iterator<const Ct>
+    { typedef typename Ct::const_iterator type; };
+    ///@}
+  } // namespace details
+
+  /**
+   *  Iterates over the values of a grid_multimap whose keys are in the
+   *  region <tt>lower <= x < upper</tt>, one cell after the other.
+   *
+   *  When the region covers more cells than there are values, the values
+   *  are read in the order of the container instead.
+   *
+   *  \tparam Ct The container type, const-qualified for constant iterators.
+   */
+  template <typename Ct>
+  class grid_region_iterator
+  {
+    typedef typename details::Grid_iterator<Ct>::type base_iterator;
+    typedef typename Ct::size_type size_type;
+    enum { rank = Ct::static_rank };
+
+  public:
+    typedef std::forward_iterator_tag                 iterator_category;
+    typedef typename std::iterator_traits<base_iterator>::value_type
+    value_type;
+    typedef typename std::iterator_traits<base_iterator>::difference_type
+    difference_type;
+    typedef typename std::iterator_traits<base_iterator>::pointer pointer;
+    typedef typename std::iterator_traits<base_iterator>::reference
+    reference;
+    typedef typename Ct::key_type                     key_type;
+
+    //! Uninitialized iterator.
+    grid_region_iterator() { }
+
+    /**
+     *  Build an iterator on the values of \c container with keys in
+     *  <tt>[lower, upper)</tt>, pointing to the first of them if \c first is
+     *  true, or past the last of them otherwise.
+     */
+    grid_region_iterator(Ct& container, const key_type& lower,
+                         const key_type& upper, bool first)
+      : _container(&container), _lower(lower), _upper(upper),
+        _index(container.size()), _scan(false)
+    {
+      except::check_bounds(container, lower, upper);
+      if (!first || container.empty()) return;
+      container.cell_of(lower, _low);
+      container.cell_of(upper, _high);
+      double cells = 1.0;
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          _cell[d] = _low[d];
+          cells *= static_cast<double>(_high[d] - _low[d] + 1);
+        }
+      _scan = cells > static_cast<double>(container.size());
+      if (_scan) { _index = 0; }
+      else { _index = container.cell_head(_cell); }
+      settle();
+    }
+
+    //! Convert a mutable iterator into a constant one.
+    template <typename Other>
+    grid_region_iterator(const grid_region_iterator<Other>& other)
+      : _container(other._container), _lower(other._lower),
+        _upper(other._upper), _index(other._index), _scan(other._scan)
+    {
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          _low[d] = other._low[d];
+          _high[d] = other._high[d];
+          _cell[d] = other._cell[d];
+        }
+    }
+
+    reference operator*() const
+    { return *(base_iterator(_container->begin()) + _index); }
+
+    pointer operator->() const
+    { return &operator*(); }
+
+    grid_region_iterator&
+    operator++()
+    {
+      _index = _scan ? _index + 1 : _container->next(_index);
+      settle();
+      return *this;
+    }
+
+    grid_region_iterator
+    operator++(int)
+    {
+      grid_region_iterator x(*this);
+      ++*this;
+      return x;
+    }
+
+    //! The position of the current value in the container, or its size
+    //! past the end.
+    size_type index() const { return _index; }
+
+    template <typename Other>
+    bool operator==(const grid_region_iterator<Other>& other) const
+    { return _index == other.index(); }
+
+    template <typename Other>
+    bool operator!=(const grid_region_iterator<Other>& other) const
+    { return _index != other.index(); }
+
+  private:
+    template <typename> friend class grid_region_iterator;
+
+    bool
+    match(size_type i) const
+    {
+      SPATIAL_STATS_COUNT(nodes_visited);
+      const key_type& key = _container->key(i);
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          if (_container->key_comp()(d, key, _lower)
+              || !_container->key_comp()(d, key, _upper)) return false;
+        }
+      return true;
+    }
+
+    //! Moves to the first match at or after the current value.
+    void
+    settle()
+    {
+      size_type end = _container->size();
+      if (_scan)
+        {
+          while (_index < end && !match(_index)) { ++_index; }
+          return;
+        }
+      for (;;)
+        {
+          for (; _index != Ct::npos(); _index = _container->next(_index))
+            { if (match(_index)) return; }
+          // Next cell of the region, the first dimension moving fastest
+          dimension_type d = 0;
+          for (; d < rank && _cell[d] == _high[d]; ++d)
+            { _cell[d] = _low[d]; }
+          if (d == rank) { _index = end; return; }
+          ++_cell[d];
+          _index = _container->cell_head(_cell);
+        }
+    }
+
+    Ct* _container;
+    key_type _lower;
+    key_type _upper;
+    long _low[rank];
+    long _high[rank];
+    long _cell[rank];
+    size_type _index;
+    bool _scan;
+  };
+
+  /**
+   *  Iterates over the values of a grid_multimap from the nearest to the
+   *  furthest of a target key, by euclidian distance.
+   *
+   *  The cells are visited in rings of growing size around the cell of the
+   *  target. Once a ring has been visited, the values nearer to the target
+   *  than the faces of the ring are all known and are returned, nearest
+   *  first. When a
+   *  ring would cover more cells than the container uses, all the remaining
+   *  values are read at once instead. Values at the same distance are
+   *  returned in the order of the container.
+   *
+   *  \tparam Ct The container type, const-qualified for constant iterators.
+   */
+  template <typename Ct>
+  class grid_neighbor_iterator
+  {
+    typedef typename details::Grid_iterator<Ct>::type base_iterator;
+    typedef typename Ct::size_type size_type;
+    typedef std::pair<double, size_type> candidate;
+    enum { rank = Ct::static_rank };
+
+  public:
+    typedef std::forward_iterator_tag                 iterator_category;
+    typedef typename std::iterator_traits<base_iterator>::value_type
+    value_type;
+    typedef typename std::iterator_traits<base_iterator>::difference_type
+    difference_type;
+    typedef typename std::iterator_traits<base_iterator>::pointer pointer;
+    typedef typename std::iterator_traits<base_iterator>::reference
+    reference;
+    typedef typename Ct::key_type                     key_type;
+    typedef double                                    distance_type;
+
+    //! Uninitialized iterator.
+    grid_neighbor_iterator() { }
+
+    /**
+     *  Build an iterator on the values of \c container from the nearest to
+     *  the furthest of \c target, pointing to the nearest if \c first is
+     *  true, or past the furthest otherwise.
+     */
+    grid_neighbor_iterator(Ct& container, const key_type& target, bool first)
+      : _container(&container), _target(target), _ring(-1), _found(0),
+        _index(container.size()), _distance(0.0)
+    {
+      if (!first) return;
+      container.cell_of(target, _cell);
+      for (dimension_type d = 0; d < rank; ++d)
+        { _coord[d] = container.coordinate(d, target); }
+      increment();
+    }
+
+    //! Convert a mutable iterator into a constant one.
+    template <typename Other>
+    grid_neighbor_iterator(const grid_neighbor_iterator<Other>& other)
+      : _container(other._container), _target(other._target),
+        _ring(other._ring), _found(other._found), _index(other._index),
+        _distance(other._distance), _heap(other._heap)
+    {
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          _coord[d] = other._coord[d];
+          _cell[d] = other._cell[d];
+        }
+    }
+
+    reference operator*() const
+    { return *(base_iterator(_container->begin()) + _index); }
+
+    pointer operator->() const
+    { return &operator*(); }
+
+    grid_neighbor_iterator&
+    operator++()
+    {
+      increment();
+      return *this;
+    }
+
+    grid_neighbor_iterator
+    operator++(int)
+    {
+      grid_neighbor_iterator x(*this);
+      ++*this;
+      return x;
+    }
+
+    //! The distance between the current value and the target.
+    distance_type distance() const { return _distance; }
+
+    //! The target of the iteration.
+    const key_type& target_key() const { return _target; }
+
+    //! The position of the current value in the container, or its size
+    //! past the end.
+    size_type index() const { return _index; }
+
+    template <typename Other>
+    bool operator==(const grid_neighbor_iterator<Other>& other) const
+    { return _index == other.index(); }
+
+    template <typename Other>
+    bool operator!=(const grid_neighbor_iterator<Other>& other) const
+    { return _index != other.index(); }
+
+  private:
+    template <typename> friend class grid_neighbor_iterator;
+
+    //! Returns the square of the distance between the value \c i and the
+    //! target; values are sorted by it to spare the square roots.
+    double
+    quadrance_to(size_type i) const
+    {
+      SPATIAL_STATS_COUNT(nodes_visited);
+      SPATIAL_STATS_COUNT(distance_evaluations);
+      const key_type& key = _container->key(i);
+      double sum = 0.0;
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          double diff = _container->coordinate(d, key) - _coord[d];
+          sum += diff * diff;
+        }
+      return sum;
+    }
+
+    void
+    push(size_type i)
+    {
+      _heap.push_back(candidate(quadrance_to(i), i));
+      ++_found;
+    }
+
+    //! Pushes the values of the cell at \c cell.
+    void
+    gather_cell(const long* cell)
+    {
+      for (size_type i = _container->cell_head(cell); i != Ct::npos();
+           i = _container->next(i)) { push(i); }
+    }
+
+    //! Pushes the values of the cells \c ring cells away from the target.
+    void
+    gather_ring()
+    {
+      double side = 2.0 * static_cast<double>(_ring) + 1.0;
+      double cells = 1.0;
+      for (dimension_type d = 0; d < rank; ++d) { cells *= side; }
+      if (cells > 2.0 * static_cast<double>(_container->cell_count()))
+        {
+          // Cheaper to read the values that remain
+          for (size_type i = 0; i < _container->size(); ++i)
+            {
+              const long* at = _container->cell_coord(i);
+              long away = 0;
+              for (dimension_type d = 0; d < rank; ++d)
+                {
+                  long diff = at[d] > _cell[d] ? at[d] - _cell[d]
+                    : _cell[d] - at[d];
+                  if (diff > away) away = diff;
+                }
+              if (away >= _ring) { push(i); }
+            }
+          return;
+        }
+      // Walk the cube of cells around the target; along the last dimension,
+      // only the cells on its faces unless another dimension is on a face.
+      long cell[rank];
+      for (dimension_type d = 0; d < rank; ++d)
+        { cell[d] = _cell[d] - _ring; }
+      for (;;)
+        {
+          bool face = false;
+          for (dimension_type d = 0; d + 1 < rank; ++d)
+            {
+              if (cell[d] == _cell[d] - _ring || cell[d] == _cell[d] + _ring)
+                { face = true; }
+            }
+          long step = (face || _ring == 0) ? 1 : 2 * _ring;
+          for (cell[rank - 1] = _cell[rank - 1] - _ring;
+               cell[rank - 1] <= _cell[rank - 1] + _ring;
+               cell[rank - 1] += step) { gather_cell(cell); }
+          dimension_type d = 0;
+          for (; d + 1 < rank && cell[d] == _cell[d] + _ring; ++d)
+            { cell[d] = _cell[d] - _ring; }
+          if (d + 1 >= rank) return;
+          ++cell[d];
+        }
+    }
+
+    /**
+     *  Returns the distance from the target to the nearest face of the cube
+     *  of cells visited so far: all the values nearer than that are known.
+     */
+    double
+    reach() const
+    {
+      if (_ring < 0) return -1.0;
+      double size = _container->cell_size();
+      double reach = 0.0;
+      for (dimension_type d = 0; d < rank; ++d)
+        {
+          double below = _coord[d]
+            - size * static_cast<double>(_cell[d] - _ring);
+          double above = size * static_cast<double>(_cell[d] + _ring + 1)
+            - _coord[d];
+          double near = below < above ? below : above;
+          if (d == 0 || near < reach) reach = near;
+        }
+      return reach;
+    }
+
+    void
+    increment()
+    {
+      double reach = this->reach();
+      while (_heap.empty() || (_found < _container->size()
+                               && _heap.front().first > reach * reach))
+        {
+          if (_found == _container->size())
+            {
+              _index = _container->size();
+              return;
+            }
+          ++_ring;
+          gather_ring();
+          std::make_heap(_heap.begin(), _heap.end(),
+                         std::greater<candidate>());
+          reach = this->reach();
+        }
+      std::pop_heap(_heap.begin(), _heap.end(), std::greater<candidate>());
+      _distance = std::sqrt(_heap.back().first);
+      _index = _heap.back().second;
+      _heap.pop_back();
+    }
+
+    Ct* _container;
+    key_type _target;
+    double _coord[rank];
+    long _cell[rank];
+    long _ring;
+    size_type _found;
+    size_type _index;
+    double _distance;
+    std::vector<candidate> _heap;
+  };
+
+  //! Returns the distance between the value pointed to by \c iter and the
+  //! target of the iteration.
+  template <typename Ct>
+  inline double
+  distance(const grid_neighbor_iterator<Ct>& iter)
+  { return iter.distance(); }
+
+  //! Returns the target of the iteration of \c iter.
+  template <typename Ct>
+  inline const typename Ct::key_type&
+  target_key(const grid_neighbor_iterator<Ct>& iter)
+  { return iter.target_key(); }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  class grid_multimap;
+
+  /**
+   *  Region and neighbor iterators for grid_multimap, with the same
+   *  interface as those of the other containers. Regions are given by their
+   *  bounds: the keys \c x such that <tt>lower <= x < upper</tt> along all
+   *  dimensions. Neighbors are sorted by euclidian distance.
+   */
+  ///@{
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_begin(grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+               const Key& lower, const Key& upper)
+  {
+    return grid_region_iterator
+      <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, lower, upper, true);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_begin
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  {
+    return grid_region_iterator
+      <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, lower, upper, true);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_cbegin
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return region_begin(container, lower, upper); }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_end(grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+             const Key& lower, const Key& upper)
+  {
+    return grid_region_iterator
+      <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, lower, upper, false);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_end
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  {
+    return grid_region_iterator
+      <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, lower, upper, false);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_region_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  region_cend
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& lower, const Key& upper)
+  { return region_end(container, lower, upper); }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_begin(grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+                 const Key& target)
+  {
+    return grid_neighbor_iterator
+      <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, target, true);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_begin
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return grid_neighbor_iterator
+      <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, target, true);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_cbegin
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  { return neighbor_begin(container, target); }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_end(grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+               const Key& target)
+  {
+    return grid_neighbor_iterator
+      <grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, target, false);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_end
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  {
+    return grid_neighbor_iterator
+      <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+      (container, target, false);
+  }
+
+  template <dimension_type Rank, typename Key, typename Mapped,
+            typename Compare, typename Alloc>
+  inline grid_neighbor_iterator
+  <const grid_multimap<Rank, Key, Mapped, Compare, Alloc> >
+  neighbor_cend
+  (const grid_multimap<Rank, Key, Mapped, Compare, Alloc>& container,
+   const Key& target)
+  { return neighbor_end(container, target); }
+  ///@}
+} // namespace spatial
+
+#endif // SPATIAL_UNIFORM_GRID_HPP
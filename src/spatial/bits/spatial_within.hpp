@@ -0,0 +1,494 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   spatial_within.hpp
+ *  Provides the fixed-radius searches, that find all the elements of a
+ *  container within a distance of a target.
+ */
+
+#ifndef SPATIAL_WITHIN_HPP
+#define SPATIAL_WITHIN_HPP
+
+#include <algorithm> // std::sort
+#include <cmath>     // std::sqrt
+
+#include "spatial_import_tuple.hpp"
+#include "../metric.hpp"
+#include "../traits.hpp"
+#include "spatial_node.hpp"
+#include "spatial_assert.hpp"
+#include "spatial_stats.hpp"
+
+namespace spatial
+{
+  namespace details
+  {
+    /**
+     *  The ball of all the keys within \c radius of a target, according to
+     *  any \metric.
+     *
+     *  A key is tested with contains(), which also returns a measure of its
+     *  distance that distance() converts into the distance of the metric.
+     *  The specializations for the built-in metrics compare squared or
+     *  partial distances instead, so that most keys are rejected before their
+     *  distance is fully computed.
+     */
+    template <typename Metric>
+    struct Ball
+    {
+      typedef typename Metric::distance_type distance_type;
+      typedef typename Metric::distance_type measure_type;
+
+      Ball(const Metric& metric_, distance_type radius_)
+        : metric(metric_), radius(radius_) { }
+
+      template <typename Key>
+      bool
+      reaches_plane(dimension_type rank, dimension_type dim,
+                    const Key& target, const Key& key) const
+      { return !(radius < metric.distance_to_plane(rank, dim, target, key)); }
+
+      template <typename Key>
+      bool
+      contains(dimension_type rank, const Key& target, const Key& key,
+               measure_type& measure) const
+      {
+        measure = metric.distance_to_key(rank, target, key);
+        return !(radius < measure);
+      }
+
+      distance_type
+      distance(measure_type measure) const { return measure; }
+
+      Metric metric;
+      distance_type radius;
+    };
+
+    /**
+     *  The ball of an \ref euclidian metric compares squared distances, and
+     *  only takes a square root for the keys it contains.
+     */
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Ball<euclidian<Ct, DistanceType, Diff> >
+    {
+      typedef DistanceType distance_type;
+      typedef DistanceType measure_type;
+
+      Ball(const euclidian<Ct, DistanceType, Diff>& metric_,
+           distance_type radius_)
+        : diff(metric_.difference()), radius(radius_),
+          square(radius_ * radius_) { }
+
+      template <typename Key>
+      bool
+      reaches_plane(dimension_type, dimension_type dim,
+                    const Key& target, const Key& key) const
+      {
+        distance_type d = diff(dim, target, key);
+        return !(square < d * d);
+      }
+
+      template <typename Key>
+      bool
+      contains(dimension_type rank, const Key& target, const Key& key,
+               measure_type& measure) const
+      {
+        measure = distance_type();
+        for (dimension_type i = 0; i < rank; ++i)
+          {
+            distance_type d = diff(i, target, key);
+            measure += d * d;
+            if (square < measure) return false;
+          }
+        return true;
+      }
+
+      distance_type
+      distance(measure_type measure) const { return std::sqrt(measure); }
+
+      typename euclidian<Ct, DistanceType, Diff>::difference_type diff;
+      distance_type radius;
+      distance_type square;
+    };
+
+    /**
+     *  The ball of a \ref quadrance metric stops adding up the squares of the
+     *  differences as soon as their sum is out of the ball.
+     */
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Ball<quadrance<Ct, DistanceType, Diff> >
+    {
+      typedef DistanceType distance_type;
+      typedef DistanceType measure_type;
+      typedef typename quadrance<Ct, DistanceType, Diff>::difference_type
+      difference_type;
+
+      Ball(const quadrance<Ct, DistanceType, Diff>& metric_,
+           distance_type radius_)
+        : diff(metric_.difference()), radius(radius_) { }
+
+      template <typename Key>
+      bool
+      reaches_plane(dimension_type, dimension_type dim,
+                    const Key& target, const Key& key) const
+      {
+        return !(radius < math::square_euclid_distance_to_plane
+                 <Key, difference_type, DistanceType>(dim, target, key, diff));
+      }
+
+      template <typename Key>
+      bool
+      contains(dimension_type rank, const Key& target, const Key& key,
+               measure_type& measure) const
+      {
+        measure = distance_type();
+        for (dimension_type i = 0; i < rank; ++i)
+          {
+            measure += math::square_euclid_distance_to_plane
+              <Key, difference_type, DistanceType>(i, target, key, diff);
+            if (radius < measure) return false;
+          }
+        return true;
+      }
+
+      distance_type
+      distance(measure_type measure) const { return measure; }
+
+      difference_type diff;
+      distance_type radius;
+    };
+
+    /**
+     *  The ball of a \ref manhattan metric stops adding up the differences as
+     *  soon as their sum is out of the ball.
+     */
+    template <typename Ct, typename DistanceType, typename Diff>
+    struct Ball<manhattan<Ct, DistanceType, Diff> >
+    {
+      typedef DistanceType distance_type;
+      typedef DistanceType measure_type;
+      typedef typename manhattan<Ct, DistanceType, Diff>::difference_type
+      difference_type;
+
+      Ball(const manhattan<Ct, DistanceType, Diff>& metric_,
+           distance_type radius_)
+        : diff(metric_.difference()), radius(radius_) { }
+
+      template <typename Key>
+      bool
+      reaches_plane(dimension_type, dimension_type dim,
+                    const Key& target, const Key& key) const
+      {
+        return !(radius < math::manhattan_distance_to_plane
+                 <Key, difference_type, DistanceType>(dim, target, key, diff));
+      }
+
+      template <typename Key>
+      bool
+      contains(dimension_type rank, const Key& target, const Key& key,
+               measure_type& measure) const
+      {
+        measure = distance_type();
+        for (dimension_type i = 0; i < rank; ++i)
+          {
+            measure += math::manhattan_distance_to_plane
+              <Key, difference_type, DistanceType>(i, target, key, diff);
+            if (radius < measure) return false;
+          }
+        return true;
+      }
+
+      distance_type
+      distance(measure_type measure) const { return measure; }
+
+      difference_type diff;
+      distance_type radius;
+    };
+
+    //! Writes the iterator on each node found into an output iterator.
+    template <typename Iterator, typename OutputIterator>
+    struct Within_output
+    {
+      explicit Within_output(OutputIterator out_) : out(out_) { }
+
+      template <typename NodePtr, typename Distance>
+      void
+      operator()(NodePtr node, Distance)
+      { *out = Iterator(node); ++out; }
+
+      OutputIterator out;
+    };
+
+    //! Appends each node found, along with its distance, to a sequence.
+    template <typename Iterator, typename Ball, typename Sequence>
+    struct Within_append
+    {
+      Within_append(const Ball& ball_, Sequence& out_)
+        : ball(ball_), out(out_) { }
+
+      template <typename NodePtr, typename Measure>
+      void
+      operator()(NodePtr node, Measure measure)
+      {
+        out.push_back(typename Sequence::value_type
+                      (ball.distance(measure), Iterator(node)));
+      }
+
+      const Ball& ball;
+      Sequence& out;
+    };
+
+    //! Orders the results of a sorted search by distance only.
+    struct Within_closer
+    {
+      template <typename Result>
+      bool
+      operator()(const Result& x, const Result& y) const
+      { return x.first < y.first; }
+    };
+
+    /**
+     *  Visits all the nodes in the sub-tree under \c node that are in \c
+     *  ball, in no particular order. The far side of a node is skipped when
+     *  its splitting plane is out of the ball.
+     */
+    template <typename NodePtr, typename Rank, typename KeyCompare,
+              typename Key, typename Ball, typename Visitor>
+    inline void
+    within_sub(NodePtr node, dimension_type dim, const Rank& rank,
+               const KeyCompare& key_comp, const Key& target,
+               const Ball& ball, Visitor& visitor)
+    {
+      SPATIAL_ASSERT_CHECK(dim < rank());
+      SPATIAL_ASSERT_CHECK(node != 0);
+      SPATIAL_ASSERT_CHECK(!header(node));
+      for (;;)
+        {
+          const Key& key = const_key(node);
+          typename Ball::measure_type measure;
+          SPATIAL_STATS_COUNT(nodes_visited);
+          SPATIAL_STATS_COUNT(distance_evaluations);
+          if (ball.contains(rank(), target, key, measure))
+            { visitor(node, measure); }
+          NodePtr near, far;
+          import::tie(near, far) = key_comp(dim, key, target)
+            ? import::make_tuple(node->right, node->left)
+            : import::make_tuple(node->left, node->right);
+          dimension_type child_dim = incr_dim(rank, dim);
+          if (far != 0 && ball.reaches_plane(rank(), dim, target, key))
+            {
+              if (near == 0) { node = far; dim = child_dim; continue; }
+              SPATIAL_STATS_COUNT(backtracks);
+              within_sub(far, child_dim, rank, key_comp, target, ball,
+                         visitor);
+            }
+          if (near == 0) return;
+          node = near; dim = child_dim;
+        }
+    }
+
+    template <typename NodePtr, typename Ct, typename Metric,
+              typename Visitor>
+    inline void
+    within(NodePtr root, const Ct& container, const Ball<Metric>& ball,
+           const typename container_traits<Ct>::key_type& target,
+           Visitor& visitor)
+    {
+      if (header(root)
+          || ball.radius < typename Metric::distance_type()) return;
+      within_sub(root, 0, container.rank(), container.key_comp(), target,
+                 ball, visitor);
+    }
+  } // namespace details
+
+  /**
+   *  Finds all the elements of \c container within \c radius of \c target,
+   *  according to a user-defined \metric, and writes an iterator on each of
+   *  them to \c out, in no particular order.
+   *
+   *  The search walks the tree once, skipping every part of it that lies
+   *  beyond \c radius. It is much faster than walking from neighbor_begin()
+   *  to neighbor_upper_bound(), since the results need not be sorted. With
+   *  the \euclidian, \quadrance and \manhattan metrics, distances are
+   *  compared squared or dimension by dimension, so that most elements are
+   *  rejected early.
+   *
+   *  \param container The container to search.
+   *  \param metric The metric used to measure distances.
+   *  \param target The center of the search.
+   *  \param radius The largest distance at which an element is found.
+   *  \param out An output iterator receiving \c Ct::iterator values, or \c
+   *  Ct::const_iterator values when the container is constant.
+   *  \return The output iterator past the last element written.
+   */
+  ///@{
+  template <typename Ct, typename Metric, typename OutputIterator>
+  inline OutputIterator
+  within_radius(Ct& container, const Metric& metric,
+                const typename container_traits<Ct>::key_type& target,
+                typename Metric::distance_type radius, OutputIterator out)
+  {
+    typedef typename container_traits<Ct>::iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    details::Within_output<iterator, OutputIterator> visitor(out);
+    details::within(root, container, details::Ball<Metric>(metric, radius),
+                    target, visitor);
+    return visitor.out;
+  }
+
+  template <typename Ct, typename Metric, typename OutputIterator>
+  inline OutputIterator
+  within_radius(const Ct& container, const Metric& metric,
+                const typename container_traits<Ct>::key_type& target,
+                typename Metric::distance_type radius, OutputIterator out)
+  {
+    typedef typename container_traits<Ct>::const_iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    details::Within_output<iterator, OutputIterator> visitor(out);
+    details::within(root, container, details::Ball<Metric>(metric, radius),
+                    target, visitor);
+    return visitor.out;
+  }
+  ///@}
+
+  /**
+   *  Finds all the elements of \c container within \c radius of \c target,
+   *  assuming an euclidian metric with distances expressed in double. It
+   *  requires that the container used was defined with a built-in key
+   *  compare functor.
+   *
+   *  \see within_radius(Ct&, const Metric&, const typename
+   *  container_traits<Ct>::key_type&, typename Metric::distance_type,
+   *  OutputIterator)
+   */
+  ///@{
+  template <typename Ct, typename OutputIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            OutputIterator>::type
+  within_radius(Ct& container,
+                const typename container_traits<Ct>::key_type& target,
+                double radius, OutputIterator out)
+  {
+    return within_radius
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, radius, out);
+  }
+
+  template <typename Ct, typename OutputIterator>
+  inline typename enable_if<details::is_compare_builtin<Ct>,
+                            OutputIterator>::type
+  within_radius(const Ct& container,
+                const typename container_traits<Ct>::key_type& target,
+                double radius, OutputIterator out)
+  {
+    return within_radius
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, radius, out);
+  }
+  ///@}
+
+  /**
+   *  Finds all the elements of \c container within \c radius of \c target,
+   *  according to a user-defined \metric, and appends them to \c out from
+   *  the closest to the furthest.
+   *
+   *  \param container The container to search.
+   *  \param metric The metric used to measure distances.
+   *  \param target The center of the search.
+   *  \param radius The largest distance at which an element is found.
+   *  \param out A sequence with random access iterators, such as a \c
+   *  std::vector, of <tt>std::pair<distance_type, iterator></tt>, where \c
+   *  distance_type is the distance type of \c Metric and \c iterator the
+   *  iterator type of the container: <tt>Ct::const_iterator</tt> when the
+   *  container is constant. Elements already in \c out are left untouched.
+   *  \see within_radius
+   */
+  ///@{
+  template <typename Ct, typename Metric, typename Sequence>
+  inline void
+  within_radius_sorted(Ct& container, const Metric& metric,
+                       const typename container_traits<Ct>::key_type& target,
+                       typename Metric::distance_type radius, Sequence& out)
+  {
+    typedef typename container_traits<Ct>::iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    typename Sequence::size_type size = out.size();
+    details::Ball<Metric> ball(metric, radius);
+    details::Within_append<iterator, details::Ball<Metric>, Sequence>
+      visitor(ball, out);
+    details::within(root, container, ball, target, visitor);
+    std::sort(out.begin() + size, out.end(), details::Within_closer());
+  }
+
+  template <typename Ct, typename Metric, typename Sequence>
+  inline void
+  within_radius_sorted(const Ct& container, const Metric& metric,
+                       const typename container_traits<Ct>::key_type& target,
+                       typename Metric::distance_type radius, Sequence& out)
+  {
+    typedef typename container_traits<Ct>::const_iterator iterator;
+    typename iterator::node_ptr root = container.end().node->parent;
+    typename Sequence::size_type size = out.size();
+    details::Ball<Metric> ball(metric, radius);
+    details::Within_append<iterator, details::Ball<Metric>, Sequence>
+      visitor(ball, out);
+    details::within(root, container, ball, target, visitor);
+    std::sort(out.begin() + size, out.end(), details::Within_closer());
+  }
+  ///@}
+
+  /**
+   *  Finds all the elements of \c container within \c radius of \c target
+   *  and appends them to \c out from the closest to the furthest, assuming
+   *  an euclidian metric with distances expressed in double. It requires
+   *  that the container used was defined with a built-in key compare
+   *  functor.
+   *
+   *  \see within_radius_sorted(Ct&, const Metric&, const typename
+   *  container_traits<Ct>::key_type&, typename Metric::distance_type,
+   *  Sequence&)
+   */
+  ///@{
+  template <typename Ct, typename Sequence>
+  inline typename enable_if<details::is_compare_builtin<Ct> >::type
+  within_radius_sorted(Ct& container,
+                       const typename container_traits<Ct>::key_type& target,
+                       double radius, Sequence& out)
+  {
+    within_radius_sorted
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, radius, out);
+  }
+
+  template <typename Ct, typename Sequence>
+  inline typename enable_if<details::is_compare_builtin<Ct> >::type
+  within_radius_sorted(const Ct& container,
+                       const typename container_traits<Ct>::key_type& target,
+                       double radius, Sequence& out)
+  {
+    within_radius_sorted
+      (container,
+       euclidian<Ct, double,
+                 typename details::with_builtin_difference<Ct>::type>
+         (details::with_builtin_difference<Ct>()(container)),
+       target, radius, out);
+  }
+  ///@}
+
+} // namespace spatial
+
+#endif // SPATIAL_WITHIN_HPP
@@ -0,0 +1,147 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   compact_box_multiset.hpp
+ *  Contains the definition of the compact_box_multiset containers.
+ */
+
+#ifndef SPATIAL_COMPACT_BOX_MULTISET_HPP
+#define SPATIAL_COMPACT_BOX_MULTISET_HPP
+
+#include <memory>  // std::allocator
+#include "function.hpp"
+#include "bits/spatial_check_concept.hpp"
+#include "bits/spatial_compact_kdtree.hpp"
+
+namespace spatial
+{
+  /**
+   *  Non-associative containers that store values in space that can be
+   *  represented as boxes, like the \box_multiset, in a single array of nodes
+   *  linked by 32 bits indices instead of pointers.
+   *
+   *  The nodes take about half the memory of the nodes of a \box_multiset,
+   *  and no pointer is stored in the container. Inserting values never
+   *  invalidates iterators, and erasing a value only invalidates the
+   *  iterators to that value. The container holds at most 2^32 - 3 values.
+   *
+   *  Unlike iterators, references and pointers to the values are
+   *  invalidated by any insertion that grows the array of nodes, as in a
+   *  \c std::vector. Call reserve() first to keep them valid.
+   */
+  template<dimension_type Rank, typename Key,
+           typename Compare = bracket_less<Key>,
+           typename BalancingPolicy = loose_balancing,
+           typename Alloc = std::allocator<Key> >
+  class compact_box_multiset
+    : public details::Compact_kdtree<details::Static_rank<Rank>, const Key,
+                                     const Key,
+                                     Compare, BalancingPolicy, Alloc>
+  {
+  private:
+    typedef typename
+    enable_if_c<(Rank & 1u) == 0>::type check_concept_dimension_is_even;
+
+    typedef details::Compact_kdtree
+    <details::Static_rank<Rank>, const Key, const Key,
+     Compare, BalancingPolicy, Alloc>         base_type;
+    typedef compact_box_multiset<Rank, Key, Compare,
+                   BalancingPolicy, Alloc>    Self;
+
+  public:
+    compact_box_multiset() { }
+
+    explicit compact_box_multiset(const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { }
+
+    compact_box_multiset(const Compare& compare,
+                         const BalancingPolicy& balancing)
+      : base_type(details::Static_rank<Rank>(), compare, balancing)
+    { }
+
+    compact_box_multiset(const Compare& compare,
+                         const BalancingPolicy& balancing, const Alloc& alloc)
+      : base_type(details::Static_rank<Rank>(), compare, balancing, alloc)
+    { }
+
+    compact_box_multiset(const compact_box_multiset& other)
+      : base_type(other)
+    { }
+
+    compact_box_multiset&
+    operator=(const compact_box_multiset& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+
+  /**
+   *  When specified with a null dimension, the rank of the
+   *  compact_box_multiset can be determined at run time and does not need to
+   *  be fixed at compile time. If no rank is given, it defaults to 2.
+   */
+  template<typename Key, typename Compare,
+           typename BalancingPolicy, typename Alloc>
+  class compact_box_multiset<0, Key, Compare, BalancingPolicy, Alloc>
+    : public details::Compact_kdtree<details::Dynamic_rank, const Key,
+                                     const Key,
+                                     Compare, BalancingPolicy, Alloc>
+  {
+  private:
+    typedef details::Compact_kdtree
+    <details::Dynamic_rank, const Key, const Key,
+     Compare, BalancingPolicy, Alloc>         base_type;
+    typedef compact_box_multiset<0, Key, Compare,
+                   BalancingPolicy, Alloc>    Self;
+
+  public:
+    compact_box_multiset() : base_type(details::Dynamic_rank(2)) { }
+
+    explicit compact_box_multiset(dimension_type dim)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_even_rank(dim); }
+
+    compact_box_multiset(dimension_type dim, const Compare& compare)
+      : base_type(details::Dynamic_rank(dim), compare)
+    { except::check_even_rank(dim); }
+
+    compact_box_multiset(dimension_type dim, const Compare& compare,
+                         const BalancingPolicy& policy)
+      : base_type(details::Dynamic_rank(dim), compare, policy)
+    { except::check_even_rank(dim); }
+
+    compact_box_multiset(dimension_type dim, const Compare& compare,
+                         const BalancingPolicy& policy, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(dim), compare, policy, alloc)
+    { except::check_even_rank(dim); }
+
+    explicit compact_box_multiset(const Compare& compare)
+      : base_type(details::Dynamic_rank(2), compare)
+    { }
+
+    compact_box_multiset(const Compare& compare,
+                         const BalancingPolicy& policy)
+      : base_type(details::Dynamic_rank(2), compare, policy)
+    { }
+
+    compact_box_multiset(const Compare& compare,
+                         const BalancingPolicy& policy, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(2), compare, policy, alloc)
+    { }
+
+    compact_box_multiset(const compact_box_multiset& other)
+      : base_type(other)
+    { }
+
+    compact_box_multiset&
+    operator=(const compact_box_multiset& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+
+}
+
+#endif // SPATIAL_COMPACT_BOX_MULTISET_HPP
@@ -0,0 +1,148 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   compact_point_multimap.hpp
+ *  Contains the definition of the compact_point_multimap containers.
+ */
+
+#ifndef SPATIAL_COMPACT_POINT_MULTIMAP_HPP
+#define SPATIAL_COMPACT_POINT_MULTIMAP_HPP
+
+#include <memory>  // std::allocator
+#include <utility> // std::pair
+#include "function.hpp"
+#include "bits/spatial_compact_kdtree.hpp"
+
+namespace spatial
+{
+  /**
+   *  Mapped containers that store values in space that can be represented as
+   *  points, like the \point_multimap, in a single array of nodes linked by 32
+   *  bits indices instead of pointers.
+   *
+   *  The nodes take about half the memory of the nodes of a \point_multimap,
+   *  and no pointer is stored in the container. Inserting values never
+   *  invalidates iterators, and erasing a value only invalidates the
+   *  iterators to that value. The container holds at most 2^32 - 3 values.
+   *
+   *  Unlike iterators, references and pointers to the values are
+   *  invalidated by any insertion that grows the array of nodes, as in a
+   *  \c std::vector. Call reserve() first to keep them valid.
+   */
+  template<dimension_type Rank, typename Key, typename Mapped,
+           typename Compare = bracket_less<Key>,
+           typename BalancingPolicy = loose_balancing,
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+  class compact_point_multimap
+    : public details::Compact_kdtree<details::Static_rank<Rank>, const Key,
+                                     std::pair<const Key, Mapped>,
+                                     Compare, BalancingPolicy, Alloc>
+  {
+  private:
+    typedef details::Compact_kdtree
+    <details::Static_rank<Rank>, const Key, std::pair<const Key, Mapped>,
+     Compare, BalancingPolicy, Alloc>         base_type;
+    typedef compact_point_multimap<Rank, Key, Mapped, Compare,
+                   BalancingPolicy, Alloc>    Self;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    compact_point_multimap() { }
+
+    explicit compact_point_multimap(const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { }
+
+    compact_point_multimap(const Compare& compare,
+                           const BalancingPolicy& balancing)
+      : base_type(details::Static_rank<Rank>(), compare, balancing)
+    { }
+
+    compact_point_multimap(const Compare& compare,
+                           const BalancingPolicy& balancing, const Alloc& alloc)
+      : base_type(details::Static_rank<Rank>(), compare, balancing, alloc)
+    { }
+
+    compact_point_multimap(const compact_point_multimap& other)
+      : base_type(other)
+    { }
+
+    compact_point_multimap&
+    operator=(const compact_point_multimap& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+
+  /**
+   *  When specified with a null dimension, the rank of the
+   *  compact_point_multimap can be determined at run time and does not need to
+   *  be fixed at compile time.
+   */
+  template<typename Key, typename Mapped, typename Compare,
+           typename BalancingPolicy, typename Alloc>
+  class compact_point_multimap<0, Key, Mapped, Compare, BalancingPolicy, Alloc>
+    : public details::Compact_kdtree<details::Dynamic_rank, const Key,
+                                     std::pair<const Key, Mapped>,
+                                     Compare, BalancingPolicy, Alloc>
+  {
+  private:
+    typedef details::Compact_kdtree
+    <details::Dynamic_rank, const Key, std::pair<const Key, Mapped>,
+     Compare, BalancingPolicy, Alloc>         base_type;
+    typedef compact_point_multimap<0, Key, Mapped, Compare,
+                   BalancingPolicy, Alloc>    Self;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    compact_point_multimap() : base_type(details::Dynamic_rank()) { }
+
+    explicit compact_point_multimap(dimension_type dim)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_rank(dim); }
+
+    compact_point_multimap(dimension_type dim, const Compare& compare)
+      : base_type(details::Dynamic_rank(dim), compare)
+    { except::check_rank(dim); }
+
+    compact_point_multimap(dimension_type dim, const Compare& compare,
+                           const BalancingPolicy& policy)
+      : base_type(details::Dynamic_rank(dim), compare, policy)
+    { except::check_rank(dim); }
+
+    compact_point_multimap(dimension_type dim, const Compare& compare,
+                           const BalancingPolicy& policy, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(dim), compare, policy, alloc)
+    { except::check_rank(dim); }
+
+    explicit compact_point_multimap(const Compare& compare)
+      : base_type(details::Dynamic_rank(), compare)
+    { }
+
+    compact_point_multimap(const Compare& compare,
+                           const BalancingPolicy& policy)
+      : base_type(details::Dynamic_rank(), compare, policy)
+    { }
+
+    compact_point_multimap(const Compare& compare,
+                           const BalancingPolicy& policy, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(), compare, policy, alloc)
+    { }
+
+    compact_point_multimap(const compact_point_multimap& other)
+      : base_type(other)
+    { }
+
+    compact_point_multimap&
+    operator=(const compact_point_multimap& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+
+}
+
+#endif // SPATIAL_COMPACT_POINT_MULTIMAP_HPP
@@ -126,6 +126,17 @@ namespace spatial
       : std::logic_error(arg) { }
   };
 
+  /**
+   *  Thrown to report that the image of a container being loaded or mapped
+   *  is truncated, or was saved from a container of another type or by a
+   *  program with another memory representation.
+   */
+  struct invalid_image : std::runtime_error
+  {
+    explicit invalid_image(const std::string& arg)
+      : std::runtime_error(arg) { }
+  };
+
 } // namespace spatial
 
 #endif // SPATIAL_EXCEPTION_HPP
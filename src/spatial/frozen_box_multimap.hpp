@@ -0,0 +1,135 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   frozen_box_multimap.hpp
+ *  Contains the definition of the frozen_box_multimap containers.
+ */
+
+#ifndef SPATIAL_FROZEN_BOX_MULTIMAP_HPP
+#define SPATIAL_FROZEN_BOX_MULTIMAP_HPP
+
+#include <memory>  // std::allocator
+#include <utility> // std::pair
+#include "function.hpp"
+#include "bits/spatial_check_concept.hpp"
+#include "bits/spatial_frozen_kdtree.hpp"
+
+namespace spatial
+{
+  /**
+   *  Read-only mapped containers that store values in space that can be
+   *  represented as boxes, without any pointer between their nodes.
+   *
+   *  The container is built at once from a range of values, usually taken
+   *  from a \box_multimap or an \idle_box_multimap, and can only be
+   *  rebuilt afterwards, with insert_rebalance(). In exchange it takes a
+   *  fraction of the memory of these containers and is faster to search. All
+   *  iterators of the library work on it.
+   *
+   *  Keys are stored twice: packed in their own array, which searches walk
+   *  through, and in the values, which iterators refer to.
+   */
+  template<dimension_type Rank, typename Key, typename Mapped,
+           typename Compare = bracket_less<Key>,
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+  class frozen_box_multimap
+    : public details::Frozen_kdtree<details::Static_rank<Rank>, const Key,
+                                    std::pair<const Key, Mapped>,
+                                    Compare,
+                                    details::Breadth_first_layout, Alloc>
+  {
+  private:
+    typedef typename
+    enable_if_c<(Rank & 1u) == 0>::type check_concept_dimension_is_even;
+
+    typedef details::Frozen_kdtree<details::Static_rank<Rank>, const Key,
+                                   std::pair<const Key, Mapped>, Compare,
+                                   details::Breadth_first_layout,
+                                   Alloc>     base_type;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    frozen_box_multimap() { }
+
+    explicit frozen_box_multimap(const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { }
+
+    frozen_box_multimap(const Compare& compare, const Alloc& alloc)
+      : base_type(details::Static_rank<Rank>(), compare, alloc)
+    { }
+
+    /**
+     *  Build the container from the values in \c [first, last), which must
+     *  be a model of \c ForwardIterator.
+     */
+    template<typename ForwardIterator>
+    frozen_box_multimap(ForwardIterator first, ForwardIterator last)
+    { base_type::insert_rebalance(first, last); }
+
+    template<typename ForwardIterator>
+    frozen_box_multimap(ForwardIterator first, ForwardIterator last,
+                        const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { base_type::insert_rebalance(first, last); }
+  };
+
+  /**
+   *  When specified with a null dimension, the rank of the frozen_box_multimap
+   *  can be determined at run time and is not fixed at compile time.
+   */
+  template<typename Key, typename Mapped, typename Compare, typename Alloc>
+  class frozen_box_multimap<0, Key, Mapped, Compare, Alloc>
+    : public details::Frozen_kdtree<details::Dynamic_rank, const Key,
+                                    std::pair<const Key, Mapped>,
+                                    Compare,
+                                    details::Breadth_first_layout, Alloc>
+  {
+  private:
+    typedef details::Frozen_kdtree<details::Dynamic_rank, const Key,
+                                   std::pair<const Key, Mapped>, Compare,
+                                   details::Breadth_first_layout,
+                                   Alloc>     base_type;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    frozen_box_multimap() : base_type(details::Dynamic_rank(2)) { }
+
+    explicit frozen_box_multimap(dimension_type dim)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_even_rank(dim); }
+
+    frozen_box_multimap(dimension_type dim, const Compare& compare)
+      : base_type(details::Dynamic_rank(dim), compare)
+    { except::check_even_rank(dim); }
+
+    frozen_box_multimap(dimension_type dim, const Compare& compare,
+                        const Alloc& alloc)
+      : base_type(details::Dynamic_rank(dim), compare, alloc)
+    { except::check_even_rank(dim); }
+
+    frozen_box_multimap(const Compare& compare, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(2), compare, alloc)
+    { }
+
+    /**
+     *  Build the container of rank \c dim from the values in \c [first,
+     *  last), which must be a model of \c ForwardIterator.
+     */
+    template<typename ForwardIterator>
+    frozen_box_multimap(dimension_type dim, ForwardIterator first,
+                        ForwardIterator last)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_even_rank(dim); base_type::insert_rebalance(first, last); }
+  };
+
+}
+
+#endif // SPATIAL_FROZEN_BOX_MULTIMAP_HPP
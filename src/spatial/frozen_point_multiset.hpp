@@ -0,0 +1,122 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   frozen_point_multiset.hpp
+ *  Contains the definition of the frozen_point_multiset containers.
+ */
+
+#ifndef SPATIAL_FROZEN_POINT_MULTISET_HPP
+#define SPATIAL_FROZEN_POINT_MULTISET_HPP
+
+#include <memory>  // std::allocator
+#include "function.hpp"
+#include "bits/spatial_frozen_kdtree.hpp"
+
+namespace spatial
+{
+  /**
+   *  Read-only non-associative containers that store values in space that can
+   *  be represented as points, without any pointer between their nodes.
+   *
+   *  The container is built at once from a range of values, usually taken
+   *  from a \point_multiset or an \idle_point_multiset, and can only be
+   *  rebuilt afterwards, with insert_rebalance(). In exchange it takes a
+   *  fraction of the memory of these containers and is faster to search. All
+   *  iterators of the library work on it.
+   */
+  template<dimension_type Rank, typename Key,
+           typename Compare = bracket_less<Key>,
+           typename Alloc = std::allocator<Key> >
+  class frozen_point_multiset
+    : public details::Frozen_kdtree<details::Static_rank<Rank>, const Key,
+                                    const Key, Compare,
+                                    details::Breadth_first_layout, Alloc>
+  {
+  private:
+    typedef details::Frozen_kdtree<details::Static_rank<Rank>, const Key,
+                                   const Key, Compare,
+                                   details::Breadth_first_layout,
+                                   Alloc>     base_type;
+
+  public:
+    frozen_point_multiset() { }
+
+    explicit frozen_point_multiset(const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { }
+
+    frozen_point_multiset(const Compare& compare, const Alloc& alloc)
+      : base_type(details::Static_rank<Rank>(), compare, alloc)
+    { }
+
+    /**
+     *  Build the container from the values in \c [first, last), which must
+     *  be a model of \c ForwardIterator.
+     */
+    template<typename ForwardIterator>
+    frozen_point_multiset(ForwardIterator first, ForwardIterator last)
+    { base_type::insert_rebalance(first, last); }
+
+    template<typename ForwardIterator>
+    frozen_point_multiset(ForwardIterator first, ForwardIterator last,
+                          const Compare& compare)
+      : base_type(details::Static_rank<Rank>(), compare)
+    { base_type::insert_rebalance(first, last); }
+  };
+
+  /**
+   *  When specified with a null dimension, the rank of the
+   *  frozen_point_multiset can be determined at run time and is not fixed at
+   *  compile time.
+   */
+  template<typename Key, typename Compare, typename Alloc>
+  class frozen_point_multiset<0, Key, Compare, Alloc>
+    : public details::Frozen_kdtree<details::Dynamic_rank, const Key,
+                                    const Key, Compare,
+                                    details::Breadth_first_layout, Alloc>
+  {
+  private:
+    typedef details::Frozen_kdtree<details::Dynamic_rank, const Key,
+                                   const Key, Compare,
+                                   details::Breadth_first_layout,
+                                   Alloc>     base_type;
+
+  public:
+    frozen_point_multiset() { }
+
+    explicit frozen_point_multiset(dimension_type dim)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_rank(dim); }
+
+    frozen_point_multiset(dimension_type dim, const Compare& compare)
+      : base_type(details::Dynamic_rank(dim), compare)
+    { except::check_rank(dim); }
+
+    frozen_point_multiset(dimension_type dim, const Compare& compare,
+                          const Alloc& alloc)
+      : base_type(details::Dynamic_rank(dim), compare, alloc)
+    { except::check_rank(dim); }
+
+    frozen_point_multiset(const Compare& compare, const Alloc& alloc)
+      : base_type(details::Dynamic_rank(), compare, alloc)
+    { }
+
+    /**
+     *  Build the container of rank \c dim from the values in \c [first,
+     *  last), which must be a model of \c ForwardIterator.
+     */
+    template<typename ForwardIterator>
+    frozen_point_multiset(dimension_type dim, ForwardIterator first,
+                          ForwardIterator last)
+      : base_type(details::Dynamic_rank(dim))
+    { except::check_rank(dim); base_type::insert_rebalance(first, last); }
+  };
+
+}
+
+#endif // SPATIAL_FROZEN_POINT_MULTISET_HPP
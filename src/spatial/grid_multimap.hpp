@@ -0,0 +1,84 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   grid_multimap.hpp
+ *  Contains the definition of the grid_multimap containers.
+ */
+
+#ifndef SPATIAL_GRID_MULTIMAP_HPP
+#define SPATIAL_GRID_MULTIMAP_HPP
+
+#include <memory>  // std::allocator
+#include <utility> // std::pair
+#include "function.hpp"
+#include "bits/spatial_uniform_grid.hpp"
+
+namespace spatial
+{
+  /**
+   *  Mapped containers that store values in space that can be represented as
+   *  points, sorted into the cells of a uniform grid rather than in a tree.
+   *
+   *  Inserting, erasing and moving a value with relocate() take constant
+   *  time, and clearing the container keeps its memory: a container that is
+   *  filled again every frame, such as the positions of moving objects, no
+   *  longer allocates memory after a few frames. Region and neighbor
+   *  iterators are obtained with region_begin() and neighbor_begin(), like
+   *  for the other containers, and only visit the cells near the region or
+   *  the target.
+   *
+   *  The cell size should be about the size of the regions searched: a
+   *  radius search then visits a handful of cells.
+   *
+   *  \tparam Compare One of the builtin comparators of the library, whose
+   *  accessor gives the coordinates of a key.
+   */
+  template<dimension_type Rank, typename Key, typename Mapped,
+           typename Compare = bracket_less<Key>,
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+  class grid_multimap
+    : public details::Uniform_grid<Rank, const Key,
+                                   std::pair<const Key, Mapped>,
+                                   Compare, Alloc>
+  {
+  private:
+    typedef details::Uniform_grid
+    <Rank, const Key, std::pair<const Key, Mapped>, Compare, Alloc>
+    base_type;
+    typedef grid_multimap<Rank, Key, Mapped, Compare, Alloc> Self;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    //! Build a container with cells of size 1.
+    grid_multimap() { }
+
+    explicit grid_multimap(double cell_size)
+      : base_type(cell_size)
+    { }
+
+    grid_multimap(double cell_size, const Compare& compare)
+      : base_type(cell_size, compare)
+    { }
+
+    grid_multimap(double cell_size, const Compare& compare,
+                  const Alloc& alloc)
+      : base_type(cell_size, compare, alloc)
+    { }
+
+    grid_multimap(const grid_multimap& other)
+      : base_type(other)
+    { }
+
+    grid_multimap&
+    operator=(const grid_multimap& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+}
+
+#endif // SPATIAL_GRID_MULTIMAP_HPP
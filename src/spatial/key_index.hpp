@@ -0,0 +1,20 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   key_index.hpp
+ *  Provides key_index, which finds the elements of a container by key in
+ *  constant time.
+ */
+
+#ifndef SPATIAL_KEY_INDEX_HPP
+#define SPATIAL_KEY_INDEX_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_key_hash.hpp"
+
+#endif // SPATIAL_KEY_INDEX_HPP
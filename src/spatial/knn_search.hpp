@@ -0,0 +1,20 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   knn_search.hpp
+ *  Provides the k-nearest neighbor searches, that find several neighbors of
+ *  a target in one walk through the tree.
+ */
+
+#ifndef SPATIAL_KNN_SEARCH_HPP
+#define SPATIAL_KNN_SEARCH_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_knn.hpp"
+
+#endif // SPATIAL_KNN_SEARCH_HPP
@@ -295,6 +295,92 @@ namespace spatial
     { return *static_cast<const Diff*>(this); }
   };
 
+  /**
+   *  Wraps any \c Metric into a metric that makes the neighbor iterators
+   *  return approximate results, in exchange for visiting fewer nodes.
+   *
+   *  \concept_metric
+   *
+   *  The distances to the keys are those of \c Metric, but the distances to
+   *  the planes are inflated by a factor <tt>(1 + epsilon)</tt>. During a
+   *  search, the neighbor iterators therefore prune any sub-tree whose lower
+   *  bound distance is greater than the best distance found so far divided by
+   *  <tt>(1 + epsilon)</tt>. With an \c epsilon of 0, the search is exact.
+   *
+   *  Each value returned by the iterators is at a distance not greater than
+   *  <tt>(1 + epsilon)</tt> times the distance of the true next neighbor;
+   *  values may be skipped altogether, and the values returned are still
+   *  ordered by increasing distance. When \c Metric is \ref quadrance, the
+   *  bound applies to the squared distances, so use <tt>(1 + epsilon)</tt>
+   *  squared if the bound is expected on Euclidian distances.
+   *
+   *  \code
+   *  typedef point_multiset<2, point> container_type;
+   *  typedef approximate<euclidian<container_type, double,
+   *                                accessor_minus<point_x, point, double> > >
+   *    metric_type;
+   *  neighbor_iterator<container_type, metric_type> it
+   *    = neighbor_begin(container, metric_type(.5), target);
+   *  \endcode
+   *
+   *  \attention This metric works with floating point distance types only,
+   *  since the factor <tt>(1 + epsilon)</tt> cannot be represented otherwise.
+   */
+  template<typename Metric>
+  class approximate : Metric
+  {
+    // Check that the distance type is a fundamental floating point type
+    typedef typename enable_if
+    <import::is_floating_point<typename Metric::distance_type> >::type
+    check_concept_distance_type_is_floating_point;
+
+  public:
+    typedef typename Metric::distance_type distance_type;
+
+    //! The metric wrapped by this metric.
+    typedef Metric metric_type;
+
+    /**
+     *  Builds the metric with the approximation factor \c epsilon.
+     *  \throws invalid_distance if \c epsilon is negative.
+     */
+    explicit approximate(distance_type epsilon,
+                         const Metric& metric = Metric())
+      : Metric(metric), _factor(distance_type(1) + epsilon)
+    { except::check_positive_distance(epsilon); }
+
+    /**
+     *  Compute the distance between the point of \c origin and the \c key,
+     *  with \c Metric.
+     */
+    template <typename Key>
+    distance_type
+    distance_to_key(dimension_type rank,
+                    const Key& origin, const Key& key) const
+    { return Metric::distance_to_key(rank, origin, key); }
+
+    /**
+     *  The distance given by \c Metric between the point of \c origin and
+     *  the plane orthogonal to the axis of dimension \c dim and crossing \c
+     *  key, multiplied by <tt>(1 + epsilon)</tt>.
+     */
+    template <typename Key>
+    distance_type
+    distance_to_plane(dimension_type rank, dimension_type dim,
+                      const Key& origin, const Key& key) const
+    { return Metric::distance_to_plane(rank, dim, origin, key) * _factor; }
+
+    //! Returns the approximation factor of this metric.
+    distance_type epsilon() const { return _factor - distance_type(1); }
+
+    //! Returns the metric wrapped by this metric.
+    const Metric& metric() const { return *static_cast<const Metric*>(this); }
+
+  private:
+    //! The factor <tt>(1 + epsilon)</tt> applied to the plane distances.
+    distance_type _factor;
+  };
+
 } // namespace spatial
 
 #endif // SPATIAL_METRIC_HPP
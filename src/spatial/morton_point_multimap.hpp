@@ -0,0 +1,73 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   morton_point_multimap.hpp
+ *  Contains the definition of the morton_point_multimap containers.
+ */
+
+#ifndef SPATIAL_MORTON_POINT_MULTIMAP_HPP
+#define SPATIAL_MORTON_POINT_MULTIMAP_HPP
+
+#include <memory>  // std::allocator
+#include <utility> // std::pair
+#include "function.hpp"
+#include "bits/spatial_morton.hpp"
+
+namespace spatial
+{
+  /**
+   *  Mapped containers that store values in a 2 dimensional grid, whose keys
+   *  have integer coordinates in <tt>[0, 65535]</tt>, sorted by Morton code
+   *  in a single array.
+   *
+   *  The values are contiguous in memory and building the container from a
+   *  range of values only takes a sort. Region and neighbor iterators are
+   *  obtained with region_begin() and neighbor_begin(), like for the other
+   *  containers. Inserting or erasing a single value moves all the values
+   *  after it, and invalidates all iterators: the container suits static or
+   *  slowly changing data, inserted in batches.
+   *
+   *  \tparam Compare One of the builtin comparators of the library, whose
+   *  accessor gives the integer coordinates of a key.
+   */
+  template<typename Key, typename Mapped,
+           typename Compare = bracket_less<Key>,
+           typename Alloc = std::allocator<std::pair<const Key, Mapped> > >
+  class morton_point_multimap
+    : public details::Morton_vector<const Key, std::pair<const Key, Mapped>,
+                                    Compare, Alloc>
+  {
+  private:
+    typedef details::Morton_vector
+    <const Key, std::pair<const Key, Mapped>, Compare, Alloc> base_type;
+    typedef morton_point_multimap<Key, Mapped, Compare, Alloc> Self;
+
+  public:
+    typedef Mapped                            mapped_type;
+
+    morton_point_multimap() { }
+
+    explicit morton_point_multimap(const Compare& compare)
+      : base_type(compare)
+    { }
+
+    morton_point_multimap(const Compare& compare, const Alloc& alloc)
+      : base_type(compare, alloc)
+    { }
+
+    morton_point_multimap(const morton_point_multimap& other)
+      : base_type(other)
+    { }
+
+    morton_point_multimap&
+    operator=(const morton_point_multimap& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+}
+
+#endif // SPATIAL_MORTON_POINT_MULTIMAP_HPP
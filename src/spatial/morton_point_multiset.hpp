@@ -0,0 +1,69 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   morton_point_multiset.hpp
+ *  Contains the definition of the morton_point_multiset containers.
+ */
+
+#ifndef SPATIAL_MORTON_POINT_MULTISET_HPP
+#define SPATIAL_MORTON_POINT_MULTISET_HPP
+
+#include <memory>  // std::allocator
+#include "function.hpp"
+#include "bits/spatial_morton.hpp"
+
+namespace spatial
+{
+  /**
+   *  Containers that store keys in a 2 dimensional grid, with integer
+   *  coordinates in <tt>[0, 65535]</tt>, sorted by Morton code in a single
+   *  array.
+   *
+   *  The keys are contiguous in memory and building the container from a
+   *  range of keys only takes a sort. Region and neighbor iterators are
+   *  obtained with region_begin() and neighbor_begin(), like for the other
+   *  containers. Inserting or erasing a single key moves all the keys after
+   *  it, and invalidates all iterators: the container suits static or slowly
+   *  changing data, inserted in batches.
+   *
+   *  \tparam Compare One of the builtin comparators of the library, whose
+   *  accessor gives the integer coordinates of a key.
+   */
+  template<typename Key,
+           typename Compare = bracket_less<Key>,
+           typename Alloc = std::allocator<Key> >
+  class morton_point_multiset
+    : public details::Morton_vector<const Key, const Key, Compare, Alloc>
+  {
+  private:
+    typedef details::Morton_vector
+    <const Key, const Key, Compare, Alloc>    base_type;
+    typedef morton_point_multiset<Key, Compare, Alloc> Self;
+
+  public:
+    morton_point_multiset() { }
+
+    explicit morton_point_multiset(const Compare& compare)
+      : base_type(compare)
+    { }
+
+    morton_point_multiset(const Compare& compare, const Alloc& alloc)
+      : base_type(compare, alloc)
+    { }
+
+    morton_point_multiset(const morton_point_multiset& other)
+      : base_type(other)
+    { }
+
+    morton_point_multiset&
+    operator=(const morton_point_multiset& other)
+    { return static_cast<Self&>(base_type::operator=(other)); }
+  };
+}
+
+#endif // SPATIAL_MORTON_POINT_MULTISET_HPP
@@ -0,0 +1,21 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   region_reduce.hpp
+ *  Provides the functions that visit or reduce all the elements of a
+ *  container within a region in one walk through the tree, possibly across
+ *  several threads.
+ */
+
+#ifndef SPATIAL_REGION_REDUCE_HPP
+#define SPATIAL_REGION_REDUCE_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_region_visit.hpp"
+
+#endif // SPATIAL_REGION_REDUCE_HPP
@@ -0,0 +1,20 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   snapshot_container.hpp
+ *  Provides snapshot_container, which publishes the successive versions of
+ *  a container to threads that query it while it is updated.
+ */
+
+#ifndef SPATIAL_SNAPSHOT_CONTAINER_HPP
+#define SPATIAL_SNAPSHOT_CONTAINER_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_snapshot.hpp"
+
+#endif // SPATIAL_SNAPSHOT_CONTAINER_HPP
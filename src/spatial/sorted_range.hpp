@@ -0,0 +1,21 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   sorted_range.hpp
+ *  Provides the functions that list the elements of a container sorted along
+ *  one or all of its dimensions in one walk through the tree, and the
+ *  mapping_index, which keeps them sorted for repeated sweeps.
+ */
+
+#ifndef SPATIAL_SORTED_RANGE_HPP
+#define SPATIAL_SORTED_RANGE_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_sorted.hpp"
+
+#endif // SPATIAL_SORTED_RANGE_HPP
@@ -0,0 +1,20 @@
+// -*- C++ -*-
+//
+// Copyright Sylvain Bougerel 2009 - 2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file COPYING or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+
+/**
+ *  \file   within_radius.hpp
+ *  Provides the fixed-radius searches, that find all the elements of a
+ *  container within a distance of a target in one walk through the tree.
+ */
+
+#ifndef SPATIAL_WITHIN_RADIUS_HPP
+#define SPATIAL_WITHIN_RADIUS_HPP
+
+#include "spatial.hpp"
+#include "bits/spatial_within.hpp"
+
+#endif // SPATIAL_WITHIN_RADIUS_HPP